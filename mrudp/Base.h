@@ -15,6 +15,7 @@
 #include <thread>
 #include <set>
 #include <optional>
+#include <variant>
 #include <initializer_list>
 #include <queue>
 #include <atomic>
@@ -61,6 +62,9 @@ using Optional = std::optional<T>;
 template<typename ... T>
 using Tuple = std::tuple<T...>;
 
+template<typename ... T>
+using Variant = std::variant<T...>;
+
 template<typename ... T>
 using PriorityQueue = std::priority_queue<T...>;
 
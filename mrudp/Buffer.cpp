@@ -0,0 +1,52 @@
+#include "Buffer.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+Buffer *Buffer::retain(const char *data, size_t size)
+{
+	auto buffer = new Buffer();
+	buffer->size = size;
+	
+	if ((buffer->packet = retainReceived(data, size)))
+	{
+		buffer->data = data;
+	}
+	else
+	if (size <= sizeof(Packet::data))
+	{
+		buffer->packet = newPacket();
+		mem_copy(buffer->packet->data, data, size);
+		buffer->packet->dataSize = size;
+		buffer->data = (const char *)buffer->packet->data;
+	}
+	else
+	{
+		buffer->copy.assign(data, data + size);
+		buffer->data = buffer->copy.data();
+	}
+	
+	return buffer;
+}
+
+// --------------------------------------------------------
+// handles
+// --------------------------------------------------------
+
+BufferHandle newHandle(Buffer *buffer)
+{
+	return (mrudp_buffer_t)buffer;
+}
+
+Buffer *toNative(BufferHandle handle)
+{
+	return (Buffer *)handle;
+}
+
+void deleteHandle (BufferHandle handle)
+{
+	delete toNative(handle);
+}
+
+} // namespace
+} // namespace
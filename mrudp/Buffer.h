@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Base.h"
+#include "Packet.h"
+#include "mrudp.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+// --------------------------------------------------------------------------------
+// Buffer
+//
+// Received data kept past the receive callback.  Data which lies within the
+// received packet holds a reference to that packet, anything else (decompressed
+// data, for instance) is copied.
+// --------------------------------------------------------------------------------
+
+struct Buffer
+{
+	PacketPtr packet;
+	Vector<char> copy;
+	
+	const char *data = nullptr;
+	size_t size = 0;
+	
+	static Buffer *retain(const char *data, size_t size);
+} ;
+
+// --------------------------------------------------------
+// handles
+// --------------------------------------------------------
+
+typedef mrudp_buffer_t BufferHandle;
+
+BufferHandle newHandle(Buffer *buffer);
+Buffer *toNative(BufferHandle handle);
+void deleteHandle (BufferHandle handle);
+
+} // namespace
+} // namespace
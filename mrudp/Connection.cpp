@@ -21,7 +21,8 @@ Connection::Connection(const StrongPtr<Socket> &socket_, LongConnectionID id_, c
 	handshake(this),
 	handshake_options(this),
 	networkPath(this),
-	options(socket->service->imp->options.connection)
+	options(socket->service->imp->options.connection),
+	fec(this)
 {
 	#ifdef MRUDP_ENABLE_CRYPTO
 		crypto = strong<ConnectionCrypto>(socket->service->crypto);
@@ -75,6 +76,8 @@ void Connection::closeUser (mrudp_event_t event)
 		userData = nullptr;
 		closeHandler = nullptr;
 		receiveHandler = nullptr;
+		receiveStreamHandler = nullptr;
+		writableHandler = nullptr;
 
 		if (closeHandler_)
 		{
@@ -135,7 +138,7 @@ void Connection::__debugHook()
 		x++;
 	}
 	
-	if (!receiver.receiveQueue.queue.empty())
+	if (!receiver.streams[0].queue.queue.empty())
 	{
 		int y = 0;
 		y++;
@@ -232,6 +235,22 @@ void Connection::receive(Packet &packet, const Address &remoteAddress)
 	if (handshake_options.onReceive(packet) == Discard)
 		return ;
 
+	// the packets rebuilt by the fec are processed as though they were received
+	Vector<PacketPtr> recovered;
+	if (fec.onReceive(packet, recovered) == Keep)
+		processReceived(packet, remoteAddress);
+
+	for (auto &packet_: recovered)
+	{
+		ReceivedPacket received(packet_);
+		processReceived(*packet_, remoteAddress);
+	}
+	
+	statistics.onRecover(recovered.size());
+}
+
+void Connection::processReceived(Packet &packet, const Address &remoteAddress)
+{
 	xTraceChar(this, packet.header.id, (char)std::tolower((char)packet.header.type));
 	auto now = socket->service->clock.now();
 
@@ -248,8 +267,17 @@ void Connection::receive(Packet &packet, const Address &remoteAddress)
 	receiver.onReceive(packet);
 }
 
-void Connection::receive(char *buffer, int size, Reliability reliability)
+void Connection::receive(char *buffer, int size, Reliability reliability, StreamID stream)
 {
+	if (receiveStreamHandler)
+		receiveStreamHandler(
+			userData,
+			stream,
+			buffer,
+			size,
+			reliability
+		);
+	else
 	if (receiveHandler)
 		receiveHandler(
 			userData,
@@ -261,6 +289,12 @@ void Connection::receive(char *buffer, int size, Reliability reliability)
 	statistics.onReceiveDataFrame(size, reliability);
 }
 
+void Connection::writable ()
+{
+	if (writableHandler)
+		writableHandler(userData);
+}
+
 bool Connection::canSend ()
 {
 #ifdef MRUDP_ENABLE_CRYPTO
@@ -276,8 +310,11 @@ void Connection::send_(const PacketPtr &packet, Address *address)
 	
 	if (packet->header.connection == 0)
 	{
-		auto packet_ = strong<Packet>();
-		*packet_ = *packet;
+		// only the used part of the packet is copied
+		auto packet_ = newPacket();
+		packet_->header = packet->header;
+		memcpy(packet_->data, packet->data, packet->dataSize);
+		packet_->dataSize = packet->dataSize;
 		pushData(*packet_, id);
 		
 		sLogDebug("mrudp::send", logLabelVar("local", toString(socket->getLocalAddress())) << logLabelVar("remote", toString(remoteAddress)) << logVarV(packet_->header.connection) << logVarV(packet_->header.type) << logVarV(packet_->header.id) << logVarV(packet_->dataSize) << " with long ID");
@@ -294,33 +331,80 @@ void Connection::send_(const PacketPtr &packet, Address *address)
 	probe.onSend(socket->service->clock.now());
 }
 
-void Connection::send(const PacketPtr &packet, Address *address)
+PacketDiscard Connection::onSend(Packet &packet)
 {
-	xTraceChar(this, packet->header.id, (char)packet->header.type);
+	xTraceChar(this, packet.header.id, (char)packet.header.type);
 
-	statistics.onSend(*packet);
+	statistics.onSend(packet);
 
 	// the only time we should be using the longID, is when we are sending control packets
 	debug_assert(
-		(remoteID == 0 && (packet->header.type != DATA_RELIABLE && packet->header.type != DATA_UNRELIABLE)) ||
+		(remoteID == 0 && !isData(packet.header.type)) ||
 		(remoteID != 0)
 	);
 
-	if (handshake_options.onSend(*packet) == Discard)
-		return ;
+	if (handshake_options.onSend(packet) == Discard)
+		return Discard;
+
+	if (fec.onSend(packet) == Discard)
+		return Discard;
 
 #ifdef MRUDP_ENABLE_CRYPTO
-	if (crypto->onSend(*packet) == Discard)
+	if (crypto->onSend(packet) == Discard)
 	{
 		sLogDebug("mrudp::send", "encryption failed");
 		
 		debug_assert(false);
 		xDebugLine();
-		return;
+		return Discard;
 	}
 #endif
 
+	return Keep;
+}
+
+void Connection::send(const PacketPtr &packet, Address *address)
+{
+	if (onSend(*packet) == Discard)
+		return ;
+
 	send_(packet, address);
+	fec.sendParities();
+}
+
+void Connection::send(PacketRun &run)
+{
+	run.erase(
+		std::remove_if(
+			run.begin(), run.end(),
+			[this](auto &packet) { return onSend(*packet) == Discard; }
+		),
+		run.end()
+	);
+	
+	if (run.empty())
+		return;
+	
+	// packets which need the long id are sent one at a time
+	if (remoteID == 0)
+	{
+		for (auto &packet: run)
+			send_(packet, nullptr);
+			
+		return;
+	}
+	
+	for (auto &packet: run)
+	{
+		packet->header.connection = remoteID;
+		
+		sLogDebug("mrudp::send", logLabelVar("local", toString(socket->getLocalAddress())) << logLabelVar("remote", toString(remoteAddress)) << logVarV(packet->header.connection) << logVarV((char)packet->header.type) << logVarV(packet->header.id) << logVarV(packet->dataSize) << " in run");
+	}
+	
+	socket->send(run, this);
+
+	probe.onSend(socket->service->clock.now());
+	fec.sendParities();
 }
 
 void Connection::resend(const PacketPtr &packet, Address *address)
@@ -331,13 +415,23 @@ void Connection::resend(const PacketPtr &packet, Address *address)
 	statistics.onResend(*packet);
 }
 
-ErrorCode Connection::send(const char *buffer, int size, Reliability reliability)
+ErrorCode Connection::send(const char *buffer, int size, Reliability reliability, StreamID stream, const Optional<Timepoint> &deadline)
 {
 	xLogDebug(logOfThis(this));
 
 	statistics.onSendDataFrame(size, reliability);
 
-	return sender.send((const u8 *)buffer, size, reliability);
+	return sender.send((const u8 *)buffer, size, reliability, stream, deadline);
+}
+
+ErrorCode Connection::send(const mrudp_iovec_t *segments_, int count, Reliability reliability)
+{
+	xLogDebug(logOfThis(this));
+
+	Segments segments(segments_, count);
+	statistics.onSendDataFrame(segments.size, reliability);
+
+	return sender.send(segments, reliability);
 }
 
 void Connection::onRemoteAddressChanged (const Address &remoteAddress_)
@@ -3,6 +3,7 @@
 #include "sender/Sender.h"
 #include "receiver/Receiver.h"
 #include "connection/Probe.h"
+#include "connection/FEC.h"
 #include "Crypto.h"
 #include "Handshake.h"
 #include "Handshake_Options.h"
@@ -50,6 +51,7 @@ struct Connection : StrongThis<Connection>
 	Sender sender;
 	Receiver receiver;
 	Probe probe;
+	FEC fec;
 	ConnectionStatistics statistics;
 	
 #ifdef MRUDP_ENABLE_CRYPTO
@@ -59,6 +61,8 @@ struct Connection : StrongThis<Connection>
 	// data for callbacks
 	void *userData = nullptr;
 	mrudp_receive_callback receiveHandler;
+	mrudp_receive_stream_callback receiveStreamHandler;
+	mrudp_writable_callback writableHandler;
 	mrudp_close_callback closeHandler;
 	mrudp_event_t closeReason = MRUDP_EVENT_CLOSED;
 
@@ -74,7 +78,8 @@ struct Connection : StrongThis<Connection>
 	);
 	~Connection ();
 
-	ErrorCode send(const char *buffer, int size, Reliability reliable);
+	ErrorCode send(const char *buffer, int size, Reliability reliable, StreamID stream = 0, const Optional<Timepoint> &deadline = {});
+	ErrorCode send(const mrudp_iovec_t *segments, int count, Reliability reliable);
 
 	void openUser(const ConnectionOptions *options, void *userData_, mrudp_receive_callback &&receiveHandler_, mrudp_close_callback &&closeHandler_);
 	void closeUser (mrudp_event_t event);
@@ -83,11 +88,17 @@ struct Connection : StrongThis<Connection>
 
 	bool canSend ();
 	void send(const PacketPtr &packet, Address *address=nullptr);
+	void send(PacketRun &run);
 	void resend(const PacketPtr &packet, Address *address=nullptr);
 	void send_(const PacketPtr &packet, Address *address);
+	PacketDiscard onSend(Packet &packet);
 	
 	void receive(Packet &p, const Address &remoteAddress);
-	void receive(char *buffer, int size, Reliability reliable);
+	void processReceived(Packet &p, const Address &remoteAddress);
+	void receive(char *buffer, int size, Reliability reliable, StreamID stream = 0);
+	
+	// tells the user a refused send may be tried again, see Sender::possiblyWritable
+	void writable ();
 	
 	void possiblyClose ();
 	void close ();
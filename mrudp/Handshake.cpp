@@ -14,7 +14,7 @@ void Handshake::initiate()
 {
 	auto lock = lock_of(mutex);
 	
-	auto packet = strong<Packet>();
+	auto packet = newPacket();
 	packet->header.type = H0;
 	connection->sender.sendReliably(packet);
 
@@ -38,7 +38,7 @@ void Handshake::handlePacket(Packet &packet)
 	auto received = packet.header.type;
 	if (received == H0)
 	{
-		auto ack = strong<Packet>();
+		auto ack = newPacket();
 		ack->header.type = H1;
 		ack->header.id = packet.header.id;
 	
@@ -60,7 +60,7 @@ void Handshake::handlePacket(Packet &packet)
 		{
 			waitingFor = next;
 			
-			auto packet = strong<Packet>();
+			auto packet = newPacket();
 			packet->header.type = H2;
 			pushData(*packet, connection->localID);
 			connection->sender.sendReliably(packet);
@@ -71,7 +71,7 @@ void Handshake::handlePacket(Packet &packet)
 	{
 		auto remoteID = readRemoteID(packet);
 	
-		auto ack = strong<Packet>();
+		auto ack = newPacket();
 		ack->header.type = H3;
 		ack->header.id = packet.header.id;
 		pushData(*ack, connection->localID);
@@ -5,30 +5,108 @@
 namespace timprepscius {
 namespace mrudp {
 
+// the options which both ends must use the same of
+PACK (
+	struct HandshakeNegotiatedData {
+		int8_t packet_numbers;
+		int8_t fec_mode;
+		int8_t fec_data_packets;
+		int8_t fec_parity_packets;
+	}
+);
+
 PACK (
 	struct HandshakeOptionsData {
 		uint32_t probe_delay_ms;
 		int16_t maximum_retry_attempts;
+		HandshakeNegotiatedData negotiated;
 	}
 );
 
+static HandshakeNegotiatedData negotiatedOf (const ConnectionOptions &options)
+{
+	return HandshakeNegotiatedData {
+		.packet_numbers = options.packet_numbers,
+		.fec_mode = options.fec.mode,
+		.fec_data_packets = options.fec.data_packets,
+		.fec_parity_packets = options.fec.parity_packets
+	} ;
+}
+
+static HandshakeNegotiatedData narrower (const HandshakeNegotiatedData &lhs, const HandshakeNegotiatedData &rhs)
+{
+	return HandshakeNegotiatedData {
+		.packet_numbers = std::min(lhs.packet_numbers, rhs.packet_numbers),
+		.fec_mode = std::min(lhs.fec_mode, rhs.fec_mode),
+		.fec_data_packets = std::max(lhs.fec_data_packets, rhs.fec_data_packets),
+		.fec_parity_packets = std::min(lhs.fec_parity_packets, rhs.fec_parity_packets)
+	} ;
+}
+
+static void useNegotiated (Handshake_Options &handshake_options, const HandshakeNegotiatedData &negotiated)
+{
+	handshake_options.agree(negotiated.packet_numbers);
+	
+	handshake_options.connection->fec.agree(FECParameters {
+		.mode = negotiated.fec_mode,
+		.dataPackets = (u8)std::max(negotiated.fec_data_packets, (int8_t)0),
+		.parityPackets = (u8)std::max(negotiated.fec_parity_packets, (int8_t)0)
+	});
+}
+
 Handshake_Options::Handshake_Options(Connection *connection_) :
 	connection(connection_)
 {
 }
 
+void Handshake_Options::agree(s8 packetNumbers_)
+{
+	packetNumbers =
+		packetNumbers_ == MRUDP_PACKET_NUMBERS_32 ?
+			MRUDP_PACKET_NUMBERS_32 :
+			MRUDP_PACKET_NUMBERS_16;
+			
+	// so that the agreed width is what the options of the connection report
+	connection->options.packet_numbers = packetNumbers;
+	
+	connection->sender.congestion.setMaximum(
+		isExtended() ?
+			CongestionWindow::extendedMaximum :
+			CongestionWindow::standardMaximum
+	);
+}
+
 PacketDiscard Handshake_Options::onSend (Packet &packet)
 {
+	if (packet.header.type == H2)
+	{
+		if (!pushData(packet, negotiatedOf(connection->options)))
+			return Discard;
+			
+		if (!pushData(packet, Sender::toAckFrequency(connection->options.ack)))
+			return Discard;
+			
+		if (!pushData(packet, connection->receiver.credit()))
+			return Discard;
+	}
+	else
 	if (packet.header.type == H3)
 	{
 		HandshakeOptionsData o {
 			.probe_delay_ms = (uint32_t)std::max(connection->options.probe_delay_ms, 0),
 			.maximum_retry_attempts =
-				connection->options.maximum_retry_attempts
+				connection->options.maximum_retry_attempts,
+			.negotiated = negotiatedOf(connection->options)
 		};
 		
 		if (!pushData(packet, o))
 			return Discard;
+			
+		if (!pushData(packet, Sender::toAckFrequency(connection->options.ack)))
+			return Discard;
+			
+		if (!pushData(packet, connection->receiver.credit()))
+			return Discard;
 	}
 
 	return Keep;
@@ -36,14 +114,46 @@ PacketDiscard Handshake_Options::onSend (Packet &packet)
 
 PacketDiscard Handshake_Options::onReceive (Packet &packet)
 {
+	if (packet.header.type == H2)
+	{
+		u16 credit;
+		if (!popData(packet, credit))
+			return Discard;
+			
+		AckFrequency ackFrequency;
+		if (!popData(packet, ackFrequency))
+			return Discard;
+			
+		HandshakeNegotiatedData negotiated;
+		if (!popData(packet, negotiated))
+			return Discard;
+			
+		connection->sender.onAckFrequency(ackFrequency);
+		connection->sender.onCredit(credit);
+			
+		useNegotiated(*this, narrower(negotiated, negotiatedOf(connection->options)));
+	}
+	else
 	if (packet.header.type == H3)
 	{
+		u16 credit;
+		if (!popData(packet, credit))
+			return Discard;
+			
+		AckFrequency ackFrequency;
+		if (!popData(packet, ackFrequency))
+			return Discard;
+			
 		HandshakeOptionsData o;
 		if (!popData(packet, o))
 			return Discard;
 			
+		connection->sender.onAckFrequency(ackFrequency);
+		connection->sender.onCredit(credit);
+			
 		connection->options.probe_delay_ms = o.probe_delay_ms;
 		connection->options.maximum_retry_attempts = o.maximum_retry_attempts;
+		useNegotiated(*this, o.negotiated);
 	}
 
 	return Keep;
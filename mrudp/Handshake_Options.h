@@ -11,12 +11,30 @@ struct Connection;
 // Handshake_Options
 //
 // Sends the options along with the handshake
+//
+// The width of the packet numbers and the fec are
+// negotiated: H2 carries what the connecting end wants, and
+// H3 the narrower of it and what the accepting end wants,
+// which both then use.
+//
+// H2 and H3 also carry how often each end asks the other
+// to ack, see AckFrequency, and the credit each end starts
+// with, see Receiver::credit.
 // --------------------------------------------------------
 struct Handshake_Options
 {
 	Handshake_Options(Connection *connection);
 	Connection *connection;
 	
+	// the agreed mrudp_packet_numbers_t, kept apart from the
+	// options so that setting the options does not change it
+	s8 packetNumbers = MRUDP_PACKET_NUMBERS_16;
+	
+	bool isExtended () { return packetNumbers == MRUDP_PACKET_NUMBERS_32; }
+	
+	// uses the agreed width
+	void agree(s8 packetNumbers);
+	
 	PacketDiscard onReceive (Packet &packet);
 	PacketDiscard onSend (Packet &packet);
 } ;
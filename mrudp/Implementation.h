@@ -1,5 +1,9 @@
 #pragma once
 
-#include "imp/Asio.h"
+#if defined(MRUDP_ENABLE_URING)
+	#include "imp/Uring.h"
+#else
+	#include "imp/Asio.h"
+#endif
 //#include "imp/UVW.h"
 
@@ -32,7 +32,7 @@ bool NetworkPath::sendChallenge(const Address &address)
 		
 	for (auto &packetPath: packets)
 	{
-		packetPath.packet = strong<Packet>();
+		packetPath.packet = newPacket();
 		packetPath.packet->header.type = AUTHENTICATE_CHALLENGE;
 		
 		Address address = {0};
@@ -70,7 +70,7 @@ bool NetworkPath::sendChallenge(const Address &address)
 
 bool NetworkPath::sendChallengeResponse(Packet &packet)
 {
-	auto ack = strong<Packet>();
+	auto ack = newPacket();
 	ack->header.type = AUTHENTICATE_RESPONSE;
 	ack->header.id = packet.header.id;
 
@@ -10,6 +10,257 @@ bool operator==(const Packet &lhs, const Packet &rhs)
 		(memcmp(&lhs, &rhs, lhs.dataSize + sizeof(lhs.header)) == 0);
 }
 
+// --------------------------------------------------------------------------------
+// PacketPool
+//
+// Each thread owns a pool, and each packet remembers the pool which created it.
+// A packet released on the owning thread goes onto the free list without a lock.
+// A packet released on another thread is pushed onto the returned list of its
+// pool, which the owner takes all at once when its free list runs dry.  On the
+// send path the user thread creates packets and the io thread releases them, so
+// they find their way back to the user thread.
+//
+// Pools are never deleted.  When a thread exits its pool frees what it holds and
+// waits to be adopted by the next new thread, packets still outstanding return
+// to it as before.
+// --------------------------------------------------------------------------------
+
+// the number of free packets a pool holds before returning them to the heap
+const size_t MAX_POOLED_PACKETS = 1024;
+
+struct PacketPool
+{
+	// only touched by the owning thread
+	PooledPacket *free = nullptr;
+	
+	// pushed by other threads, taken by the owning thread
+	Atomic<PooledPacket *> returned = nullptr;
+	
+	Atomic<u64> allocated = 0;
+	Atomic<u64> reused = 0;
+	Atomic<u64> recycled = 0;
+	Atomic<u64> freed = 0;
+	Atomic<u64> pooled = 0;
+	
+	PooledPacket *take();
+	void give(PooledPacket *packet);
+	void giveFromOtherThread(PooledPacket *packet);
+	void freeAll();
+	
+	void increment(Atomic<u64> &counter)
+	{
+		counter.fetch_add(1, std::memory_order_relaxed);
+	}
+	
+	void decrement(Atomic<u64> &counter)
+	{
+		counter.fetch_sub(1, std::memory_order_relaxed);
+	}
+} ;
+
+PooledPacket *PacketPool::take()
+{
+	if (!free)
+		free = returned.exchange(nullptr, std::memory_order_acquire);
+		
+	if (!free)
+		return nullptr;
+		
+	auto *packet = free;
+	free = packet->next;
+	
+	decrement(pooled);
+	return packet;
+}
+
+void PacketPool::give(PooledPacket *packet)
+{
+	packet->next = free;
+	free = packet;
+}
+
+void PacketPool::giveFromOtherThread(PooledPacket *packet)
+{
+	auto *head = returned.load(std::memory_order_relaxed);
+	do
+	{
+		packet->next = head;
+	}
+	while (!returned.compare_exchange_weak(head, packet, std::memory_order_release, std::memory_order_relaxed));
+}
+
+void PacketPool::freeAll()
+{
+	while (auto *packet = take())
+	{
+		delete packet;
+		increment(freed);
+	}
+}
+
+struct PacketPoolRegistry
+{
+	Mutex mutex;
+	
+	// every pool which has been created
+	Set<PacketPool *> pools;
+	
+	// the pools of threads which have exited
+	Vector<PacketPool *> idle;
+} ;
+
+PacketPoolRegistry &packetPoolRegistry()
+{
+	static PacketPoolRegistry *registry = new PacketPoolRegistry();
+	return *registry;
+}
+
+// the pool is released with its thread, packets created after that come from
+// and go straight back to the heap
+thread_local bool packetPoolDestroyed = false;
+thread_local PacketPool *packetPoolOfThisThread = nullptr;
+
+struct PacketPoolOfThread
+{
+	PacketPool *pool = nullptr;
+	
+	PacketPoolOfThread()
+	{
+		auto &registry = packetPoolRegistry();
+		auto lock = lock_of(registry.mutex);
+		
+		if (!registry.idle.empty())
+		{
+			pool = registry.idle.back();
+			registry.idle.pop_back();
+		}
+		else
+		{
+			pool = new PacketPool();
+			registry.pools.insert(pool);
+		}
+		
+		packetPoolOfThisThread = pool;
+	}
+	
+	~PacketPoolOfThread()
+	{
+		packetPoolDestroyed = true;
+		packetPoolOfThisThread = nullptr;
+
+		pool->freeAll();
+		
+		auto &registry = packetPoolRegistry();
+		auto lock = lock_of(registry.mutex);
+		registry.idle.push_back(pool);
+	}
+} ;
+
+thread_local PacketPoolOfThread packetPoolOfThread;
+
+PacketPtr newPacket()
+{
+	PooledPacket *packet = nullptr;
+	PacketPool *pool = nullptr;
+	
+	if (!packetPoolDestroyed)
+	{
+		pool = packetPoolOfThread.pool;
+		packet = pool->take();
+		
+		if (packet)
+		{
+			pool->increment(pool->reused);
+			
+			packet->packet.header = Header();
+			packet->packet.dataSize = 0;
+		}
+		else
+		{
+			pool->increment(pool->allocated);
+		}
+	}
+	
+	if (!packet)
+	{
+		packet = new PooledPacket();
+		packet->pool = pool;
+	}
+
+	packet->references.store(1, std::memory_order_relaxed);
+	return PacketPtr(packet);
+}
+
+void recycle(PooledPacket *packet)
+{
+	auto *pool = packet->pool;
+	if (pool)
+	{
+		if (pool->pooled.load(std::memory_order_relaxed) < MAX_POOLED_PACKETS)
+		{
+			pool->increment(pool->pooled);
+			pool->increment(pool->recycled);
+
+			if (pool == packetPoolOfThisThread)
+				pool->give(packet);
+			else
+				pool->giveFromOtherThread(packet);
+			
+			return;
+		}
+		
+		pool->increment(pool->freed);
+	}
+	
+	delete packet;
+}
+
+thread_local const PacketPtr *receivedPacket = nullptr;
+
+ReceivedPacket::ReceivedPacket(const PacketPtr &packet) :
+	previous(receivedPacket)
+{
+	receivedPacket = &packet;
+}
+
+ReceivedPacket::~ReceivedPacket()
+{
+	receivedPacket = previous;
+}
+
+PacketPtr retainReceived(const char *data, size_t size)
+{
+	if (!receivedPacket || !*receivedPacket)
+		return nullptr;
+		
+	auto *packet = ptr_of(*receivedPacket);
+	auto *begin = (const char *)packet->data;
+	auto *end = begin + packet->dataSize;
+	
+	if (data >= begin && data + size <= end)
+		return *receivedPacket;
+		
+	return nullptr;
+}
+
+mrudp_packet_pool_statistics_t getPacketPoolStatistics()
+{
+	auto &registry = packetPoolRegistry();
+	auto lock = lock_of(registry.mutex);
+	
+	mrudp_packet_pool_statistics_t statistics = {};
+	for (auto *pool : registry.pools)
+	{
+		statistics.allocated += pool->allocated.load(std::memory_order_relaxed);
+		statistics.reused += pool->reused.load(std::memory_order_relaxed);
+		statistics.recycled += pool->recycled.load(std::memory_order_relaxed);
+		statistics.freed += pool->freed.load(std::memory_order_relaxed);
+		statistics.pooled += pool->pooled.load(std::memory_order_relaxed);
+	}
+	
+	return statistics;
+}
+
 
 } // namespace
 } // namespace
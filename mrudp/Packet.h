@@ -15,9 +15,12 @@ enum TypeID : uint8_t {
 	
 	ACK = 'K',
 	DATA_RELIABLE = 'R',
+	DATA_RELIABLE_WITH_ACKS = 'Q',
+	DATA_RELIABLE_UNORDERED = 'O',
 	DATA_UNRELIABLE = 'U',
 	PROBE = 'P',
 	CLOSE_READ = 'I',
+	FEC_PARITY = 'F',
 
 	AUTHENTICATE_CHALLENGE = 'M',
 	AUTHENTICATE_RESPONSE = 'W',
@@ -42,11 +45,45 @@ bool isAck(TypeID typeID)
 	return typeID == ACK || typeID == H1 || typeID == H3 || typeID == AUTHENTICATE_RESPONSE;
 }
 
+// a DATA_RELIABLE_WITH_ACKS packet is a DATA_RELIABLE packet which carries acks
+// in its trailer, see Sender::piggybackAcks
+inline
+bool isReliableData(TypeID typeID)
+{
+	return typeID == DATA_RELIABLE || typeID == DATA_RELIABLE_WITH_ACKS;
+}
+
+// a DATA_RELIABLE_UNORDERED packet is acked and resent as the reliable packets are,
+// but its frames are processed as it arrives, see UnorderedReceiveQueue
+inline
+bool isAckedData(TypeID typeID)
+{
+	return isReliableData(typeID) || typeID == DATA_RELIABLE_UNORDERED;
+}
+
+inline
+bool isData(TypeID typeID)
+{
+	return isAckedData(typeID) || typeID == DATA_UNRELIABLE;
+}
+
 enum FrameTypeID : uint8_t {
+	// ACK_FRAMEs are understood, but only SACK_FRAMEs are sent since version 2,
+	// see MRUDP_VERSION
 	ACK_FRAME = 'A',
+	SACK_FRAME = 'S',
+	ACK_FREQUENCY_FRAME = 'F',
 	DATA = 'T',
 	CLOSE_WRITE = 'W',
-	DATA_COMPRESSED = 'Z'
+	DATA_COMPRESSED = 'Z',
+	
+	// the credit of the receiver, sent when it has grown without an ack to carry
+	// it, see Receiver::resume
+	CREDIT_FRAME = 'C',
+	
+	// a frame whose data was dropped when its deadline passed, which only moves
+	// the receiver past it
+	SKIPPED = 'X'
 } ;
 
 const int MAX_PACKET_SIZE = 1500;
@@ -56,6 +93,17 @@ const int MAX_PACKET_SIZE = 1500;
 typedef uint16_t PacketID;
 typedef uint16_t FrameID;
 
+// the full number of a frame, of which the FrameID on the wire is the low bits
+typedef uint32_t FrameNumber;
+
+// the reliable stream a packet is sent on, each has its own frame numbers
+typedef uint8_t StreamID;
+const int MAX_STREAMS = MRUDP_MAX_STREAMS;
+
+// the stream a StreamEnd gives for the reliable unordered frames, which are
+// counted rather than numbered
+const StreamID UNORDERED_STREAM = MAX_STREAMS;
+
 // --------------------------------------------------------------------------------
 // Header
 //
@@ -108,17 +156,139 @@ PACK(
 	}
 );
 
-typedef StrongPtr<Packet> PacketPtr;
+// --------------------------------------------------------------------------------
+// PacketPtr
+//
+// PacketPtr is an intrusively reference counted pointer to a pooled Packet.
+//
+// Packets are created with newPacket.  When the last reference is released the
+// storage goes back to the pool of the thread which created it, whichever thread
+// releases it, and is reused by a later newPacket on that thread.  A reused
+// packet has its header and dataSize reset, its data is not cleared.
+// --------------------------------------------------------------------------------
+
+struct PacketPool;
+
+struct PooledPacket
+{
+	Atomic<u32> references;
+	PooledPacket *next;
+	
+	// the pool which created the packet, null if it came from the heap
+	PacketPool *pool;
+	Packet packet;
+} ;
+
+// returns the packet to the pool which created it
+void recycle(PooledPacket *pooled);
+
+struct PacketPtr
+{
+	PooledPacket *pooled = nullptr;
+	
+	PacketPtr () {}
+	PacketPtr (std::nullptr_t) {}
+	
+	explicit PacketPtr (PooledPacket *pooled_) :
+		pooled(pooled_)
+	{
+	}
+	
+	PacketPtr (const PacketPtr &rhs) :
+		pooled(rhs.pooled)
+	{
+		if (pooled)
+			pooled->references.fetch_add(1, std::memory_order_relaxed);
+	}
+	
+	PacketPtr (PacketPtr &&rhs) :
+		pooled(rhs.pooled)
+	{
+		rhs.pooled = nullptr;
+	}
+	
+	~PacketPtr ()
+	{
+		reset();
+	}
+	
+	PacketPtr &operator =(const PacketPtr &rhs)
+	{
+		PacketPtr copy(rhs);
+		std::swap(pooled, copy.pooled);
+		return *this;
+	}
+
+	PacketPtr &operator =(PacketPtr &&rhs)
+	{
+		std::swap(pooled, rhs.pooled);
+		rhs.reset();
+		return *this;
+	}
+	
+	void reset ()
+	{
+		if (pooled && pooled->references.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			recycle(pooled);
+			
+		pooled = nullptr;
+	}
+	
+	Packet *get () const { return pooled ? &pooled->packet : nullptr; }
+	Packet *operator ->() const { return &pooled->packet; }
+	Packet &operator *() const { return pooled->packet; }
+	
+	explicit operator bool () const { return pooled != nullptr; }
+	bool operator ==(std::nullptr_t) const { return pooled == nullptr; }
+	bool operator !=(std::nullptr_t) const { return pooled != nullptr; }
+} ;
+
+inline
+Packet *ptr_of(const PacketPtr &packet)
+{
+	return packet.get();
+}
+
+// takes a packet from the pool of this thread, or allocates one
+PacketPtr newPacket();
+
+// the statistics of the pools of all threads
+mrudp_packet_pool_statistics_t getPacketPoolStatistics();
+
+// --------------------------------------------------------------------------------
+// ReceivedPacket
+//
+// While a pooled packet is handed up from the socket, it is the received packet
+// of the thread.  Data which lies within it can be kept past the receive by
+// retaining the packet instead of copying the data.
+//
+// ReceivedPackets nest, the innermost is the current one.
+// --------------------------------------------------------------------------------
+
+struct ReceivedPacket
+{
+	ReceivedPacket(const PacketPtr &packet);
+	~ReceivedPacket();
+	
+	const PacketPtr *previous;
+} ;
+
+// returns the received packet of this thread if the data lies within it
+PacketPtr retainReceived(const char *data, size_t size);
 
 bool operator==(const Packet &lhs, const Packet &rhs);
 
 struct PacketPath {
 	PacketPtr packet;
-	Optional<Address> address;
+	Optional<Address> address = {};
 } ;
 
 using MultiPacketPath = InPlaceArray<PacketPath, 2>;
 
+// a run of packets sent one after another to the same destination, the socket
+// may hand a run to the kernel as a single segmented datagram
+using PacketRun = Vector<PacketPtr>;
+
 enum PacketDiscard {
 	Keep,
 	Discard
@@ -141,11 +311,73 @@ PACK(
 	}
 );
 
+// --------------------------------------------------------------------------------
+// Sack
+//
+// A SACK_FRAME acks the received packets in ranges of consecutive ids, the Sack
+// is followed by as many AckRanges as fit in the frame.
+//
+// The delay is that of the latest packet received, which is the only packet of
+// the frame the rtt is sampled from.
+//
+// The credit is the packets of data the receiver can yet hold, see
+// Receiver::credit.
+// --------------------------------------------------------------------------------
+
+PACK(
+	struct Sack {
+		PacketID latest;
+		u16 delayedMS;
+		u16 credit;
+	}
+);
+
+PACK(
+	struct AckRange {
+		PacketID first;
+		u16 count;
+	}
+);
+
+// --------------------------------------------------------------------------------
+// AckFrequency
+//
+// How often an end asks the remote to ack the reliable packets it sends, carried
+// in the handshake and in an ACK_FREQUENCY_FRAME.  The remote acks once as many
+// packets have arrived, or once the first has waited the delay.
+// --------------------------------------------------------------------------------
+
+PACK(
+	struct AckFrequency {
+		u16 packets;
+		u16 delayMS;
+	}
+);
+
+// --------------------------------------------------------------------------------
+// StreamEnd
+//
+// The number after the last frame written on a stream, a CLOSE_WRITE frame on
+// stream 0 carries one for each other stream used, so that the remote closes only
+// once every stream has arrived.  For the UNORDERED_STREAM it is the number of
+// reliable unordered frames written.
+// --------------------------------------------------------------------------------
+
+PACK(
+	struct StreamEnd {
+		StreamID stream;
+		FrameNumber end;
+	}
+);
+
 // TODO: these constants, especially size constants should be located somewhere else
 const int MAX_ROUTE_SIZE = 0;
 const int MAX_PACKET_POST_CRYPTO_SIZE = MAX_PACKET_SIZE - MAX_ROUTE_SIZE;
 const int MAX_CRYPTO_SIZE = 64; // this should call a function in crypto to find out
-const int MAX_PACKET_POST_FRAME_SIZE = MAX_PACKET_POST_CRYPTO_SIZE - MAX_CRYPTO_SIZE;
+const int MAX_PACKET_NUMBER_SIZE = sizeof(u16); // see Handshake_Options
+const int MAX_STREAM_ID_SIZE = sizeof(StreamID); // see Sender::processReliableDataQueue
+const int MAX_FEC_SIZE = 16; // the trailer, and the coding of a parity packet, see FEC
+const int MAX_PACKET_POST_FRAME_SIZE = MAX_PACKET_POST_CRYPTO_SIZE - MAX_CRYPTO_SIZE - MAX_PACKET_NUMBER_SIZE - MAX_STREAM_ID_SIZE - MAX_FEC_SIZE;
 const int MAX_FRAME_HEADER_SIZE = sizeof(FrameHeader);
 const int MAX_PACKET_DATA_SIZE = MAX_PACKET_POST_FRAME_SIZE - MAX_FRAME_HEADER_SIZE;
 static_assert(MRUDP_MAX_PACKET_SIZE < MAX_PACKET_DATA_SIZE);
@@ -8,7 +8,7 @@ template<typename T>
 inline
 bool id_greater_than(T lhs, T rhs)
 {
-	static const T top_bit = (1 << (sizeof(T) * 8 - 1));
+	static const T top_bit = (T(1) << (sizeof(T) * 8 - 1));
 
 	auto lhs_gtr_rhs = lhs > rhs;
 	auto diff = lhs_gtr_rhs ? (lhs - rhs) : (rhs - lhs);
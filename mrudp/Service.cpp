@@ -1,14 +1,16 @@
 #include "Service.h"
 #include "Implementation.h"
+#include "Connection.h"
 
 namespace timprepscius {
 namespace mrudp {
 
 Service::Service (mrudp_imp_selector imp_, void *options)
 {
-	debug_assert(imp_ == MRUDP_IMP_ASIO);
+	debug_assert(imp_ == imp::SELECTOR);
 	
-	imp = strong_thread(strong<imp::ServiceImp>(this, (mrudp_options_asio_t *)options));
+	imp = strong_thread(strong<imp::ServiceImp>(this, (imp::OptionsImp *)options));
+	sendBuffer.limit = (size_t)std::max(imp->options.send_buffer, (int64_t)0);
 	
 	scheduler = strong<Scheduler>(this);
 	scheduler->open();
@@ -40,6 +42,32 @@ Service::~Service ()
 	}
 }
 
+void Service::block (const WeakPtr<Connection> &connection)
+{
+	auto lock = lock_of(blockedMutex);
+	blocked.push_back(connection);
+	hasBlocked = true;
+}
+
+void Service::possiblyWritable ()
+{
+	if (!hasBlocked || !sendBuffer.drained())
+		return;
+		
+	Vector<WeakPtr<Connection>> blocked_;
+	
+	{
+		auto lock = lock_of(blockedMutex);
+		std::swap(blocked, blocked_);
+		hasBlocked = false;
+	}
+	
+	// a connection whose own buffer has not drained is told when it has
+	for (auto &connection_: blocked_)
+		if (auto connection = strong(connection_))
+			connection->sender.possiblyWritable();
+}
+
 // ---------------
 
 ServiceHandle newHandle(const StrongPtr<Service> &service)
@@ -4,6 +4,7 @@
 #include "mrudp.h"
 #include "Crypto.h"
 #include "Scheduler.h"
+#include "sender/SendBuffer.h"
 
 namespace timprepscius {
 namespace mrudp {
@@ -13,12 +14,18 @@ struct ServiceImp;
 struct SchedulerImp;
 }
 
+struct Connection;
+
 // --------------------------------------------------------------------------------
 // Service
 //
 // Service serves to house the Clock, the Random number generator, and ServiceImp.
 //
 // The ServiceImp is generally responsible for scheduling events.
+//
+// The service counts the bytes waiting to be sent on all of its connections, a
+// connection refused a send as it is full waits for it to drain, see
+// Service::possiblyWritable.
 // --------------------------------------------------------------------------------
 
 struct Service : StrongThis<Service>
@@ -44,6 +51,20 @@ struct Service : StrongThis<Service>
 	StrongPtr<Scheduler> scheduler;
 
 	StrongPtr<imp::ServiceImp> imp;
+	
+	SendBuffer sendBuffer;
+	
+	// the connections which have been refused a send, the service may have been
+	// what was full
+	Mutex blockedMutex;
+	Vector<WeakPtr<Connection>> blocked;
+	Atomic<bool> hasBlocked = false;
+	
+	void block (const WeakPtr<Connection> &connection);
+	
+	// tells the connections blocked they may be writable, once the service has
+	// drained
+	void possiblyWritable ();
 
 #ifdef MRUDP_ENABLE_CRYPTO
 	StrongPtr<HostCrypto> crypto;
@@ -0,0 +1,74 @@
+#include "Shards.h"
+#include "Implementation.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+bool Shards::open(mrudp_imp_selector imp, void *options_, const mrudp_addr_t &address, int quantity)
+{
+	if (imp != imp::SELECTOR)
+		return false;
+		
+	if (quantity <= 0)
+		quantity = std::max(1u, std::thread::hardware_concurrency());
+
+	// the first socket may be given an ephemeral port, the rest join it
+	auto shardAddress = address;
+	
+	for (auto i=0; i<quantity; ++i)
+	{
+		auto options = imp::getShardOptions((imp::OptionsImp *)options_, i);
+		auto service = mrudp_service_ex(imp, &options);
+		services.push_back(service);
+		
+		auto socket = mrudp_socket(service, &shardAddress);
+		sockets.push_back(socket);
+		
+		mrudp_addr_t boundAddress;
+		mrudp_socket_addr(socket, &boundAddress);
+		
+		if (boundAddress.v4.sin_port == 0)
+		{
+			sLogRelease("mrudp::shards", "failed to bind shard " << i);
+			
+			close(false);
+			return false;
+		}
+		
+		shardAddress = boundAddress;
+	}
+	
+	return true;
+}
+
+void Shards::close(bool waitForFinish)
+{
+	for (auto socket : sockets)
+		mrudp_close_socket(socket);
+		
+	for (auto service : services)
+		mrudp_close_service(service, waitForFinish);
+	
+	sockets.clear();
+	services.clear();
+}
+
+// ---------------
+
+ShardsHandle newHandle(Shards *shards)
+{
+	return (mrudp_shards_t)shards;
+}
+
+Shards *toNative(ShardsHandle handle)
+{
+	return (Shards *)handle;
+}
+
+void deleteHandle (ShardsHandle handle)
+{
+	delete toNative(handle);
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "Base.h"
+#include "mrudp.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+// --------------------------------------------------------------------------------
+// Shards
+//
+// Shards is a listener spread over several services, each with its own thread,
+// io context, scheduler and connections.  Each service has one socket, and the
+// sockets share an address with SO_REUSEPORT.
+//
+// Linux chooses the socket of a datagram by the hash of its source address, so
+// every datagram of a connection arrives on the shard which accepted it, and the
+// shards share no locks.
+// --------------------------------------------------------------------------------
+
+struct Shards
+{
+	Vector<mrudp_service_t> services;
+	Vector<mrudp_socket_t> sockets;
+
+	// returns false if any of the sockets could not be bound, in which case the
+	// shards which were opened are closed
+	bool open(mrudp_imp_selector imp, void *options, const mrudp_addr_t &address, int quantity);
+	void close(bool waitForFinish);
+} ;
+
+// --------------------------------------------------------
+// handles
+// --------------------------------------------------------
+
+typedef mrudp_shards_t ShardsHandle;
+
+ShardsHandle newHandle(Shards *shards);
+Shards *toNative(ShardsHandle handle);
+void deleteHandle (ShardsHandle handle);
+
+} // namespace
+} // namespace
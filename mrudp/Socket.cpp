@@ -189,6 +189,24 @@ void Socket::send(const PacketPtr &packet_, Connection *connection, const Addres
 	imp->send(packet, connection, to);
 }
 
+void Socket::send(PacketRun &run, Connection *connection)
+{
+	PROFILE_FUNCTION(this);
+
+	run.erase(
+		std::remove_if(
+			run.begin(), run.end(),
+			[this](auto &packet) { return drop.shouldDrop(); }
+		),
+		run.end()
+	);
+	
+	if (run.empty())
+		return;
+
+	imp->send(run, connection);
+}
+
 Socket::LookUp Socket::getLookUp(Packet &packet)
 {
 	LookUp lookup;
@@ -336,6 +354,14 @@ void Socket::receive(Packet &packet, const Address &remoteAddress)
 
 	xLogDebug(logOfThis(this) << logLabel("begin") << logLabelVar("local", toString(getLocalAddress())) << logLabelVar("remote", toString(remoteAddress)) << logVarV(packet.header.connection) << logVarV((char)packet.header.type) << logVarV(packet.header.id));
 
+	// a peer of another version would misread the packets of this one, so is not
+	// answered at all
+	if (packet.header.version != MRUDP_VERSION)
+	{
+		xLogDebug(logOfThis(this) << "DISCARD version " << (int)packet.header.version);
+		return;
+	}
+	
 	auto lookup = getLookUp(packet);
 	
 	if (auto connection = findOrGenerateConnection(lookup, packet, remoteAddress))
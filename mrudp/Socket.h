@@ -70,6 +70,7 @@ struct Socket : StrongThis<Socket>
 
 	[[no_unique_address]] Drop drop;
 	void send(const PacketPtr &packet, Connection *connection, const Address *to);
+	void send(PacketRun &run, Connection *connection);
 	void receive(Packet &packet, const Address &from);
 	
 	void listen(
@@ -4,13 +4,13 @@ namespace timprepscius {
 namespace mrudp {
 
 ConnectionStatistics::ConnectionStatistics () :
-	statistics({0})
+	statistics({})
 {
 }
 
 void ConnectionStatistics::onReceive (Packet &packet)
 {
-	if (packet.header.type == DATA_RELIABLE)
+	if (isAckedData(packet.header.type))
 		statistics.reliable.packets.received++;
 
 	if (packet.header.type == DATA_UNRELIABLE)
@@ -21,7 +21,7 @@ void ConnectionStatistics::onReceive (Packet &packet)
 
 void ConnectionStatistics::onSend (Packet &packet)
 {
-	if (packet.header.type == DATA_RELIABLE)
+	if (isAckedData(packet.header.type))
 		statistics.reliable.packets.sent++;
 
 	if (packet.header.type == DATA_UNRELIABLE)
@@ -32,7 +32,7 @@ void ConnectionStatistics::onSend (Packet &packet)
 
 void ConnectionStatistics::onReceiveDataFrame (int size, Reliability reliability)
 {
-	if (reliability == RELIABLE)
+	if (reliability != UNRELIABLE)
 	{
 		statistics.reliable.frames.received++;
 		statistics.reliable.bytes.received += size;
@@ -46,7 +46,7 @@ void ConnectionStatistics::onReceiveDataFrame (int size, Reliability reliability
 
 void ConnectionStatistics::onSendDataFrame (int size, Reliability reliability)
 {
-	if (reliability == RELIABLE)
+	if (reliability != UNRELIABLE)
 	{
 		statistics.reliable.frames.sent++;
 		statistics.reliable.bytes.sent += size;
@@ -58,11 +58,51 @@ void ConnectionStatistics::onSendDataFrame (int size, Reliability reliability)
 	}
 }
 
+void ConnectionStatistics::onSendAck()
+{
+	statistics.acks_sent++;
+}
+
+void ConnectionStatistics::onPiggybackAck()
+{
+	statistics.acks_piggybacked++;
+}
+
 void ConnectionStatistics::onResend(Packet &packet)
 {
 	statistics.packets_resent++;
 }
 
+void ConnectionStatistics::onFastResend(size_t packets)
+{
+	statistics.packets_fast_resent += packets;
+}
+
+void ConnectionStatistics::onProbe(size_t packets)
+{
+	statistics.packets_probed += packets;
+}
+
+void ConnectionStatistics::onExpire(size_t packets)
+{
+	statistics.packets_expired += packets;
+}
+
+void ConnectionStatistics::onRecover(size_t packets)
+{
+	statistics.packets_recovered += packets;
+}
+
+void ConnectionStatistics::onRtt(const RTT &rtt)
+{
+	auto us = [](float seconds) { return uint32_t(seconds * 1000000); };
+	
+	statistics.rtt_smoothed_us = us(rtt.duration);
+	statistics.rtt_variance_us = us(rtt.variance);
+	statistics.rtt_minimum_us = us(rtt.lowest);
+	statistics.retry_timeout_us = us(rtt.timeout());
+}
+
 const mrudp_connection_statistics_t &ConnectionStatistics::query()
 {
 	return statistics;
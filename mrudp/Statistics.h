@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Packet.h"
+#include "sender/RTT.h"
 
 namespace timprepscius {
 namespace mrudp {
@@ -20,7 +21,14 @@ struct ConnectionStatistics
 	void onReceiveDataFrame (int size, Reliability reliability);
 	void onSendDataFrame (int size, Reliability reliability);
 	
+	void onSendAck ();
+	void onPiggybackAck ();
 	void onResend (Packet &packet);
+	void onFastResend (size_t packets);
+	void onProbe (size_t packets);
+	void onRecover (size_t packets);
+	void onExpire (size_t packets);
+	void onRtt (const RTT &rtt);
 } ;
 
 } // namespace
@@ -68,6 +68,36 @@ ConnectionOptions merge(const ConnectionOptions &lhs, const ConnectionOptions &r
 	if (merged.maximum_retry_attempts == -1)
 		merged.maximum_retry_attempts = rhs.maximum_retry_attempts;
 
+	if (merged.congestion_control == -1)
+		merged.congestion_control = rhs.congestion_control;
+
+	if (merged.packet_numbers == -1)
+		merged.packet_numbers = rhs.packet_numbers;
+
+	if (merged.fec.mode == -1)
+		merged.fec.mode = rhs.fec.mode;
+
+	if (merged.fec.data_packets == -1)
+		merged.fec.data_packets = rhs.fec.data_packets;
+
+	if (merged.fec.parity_packets == -1)
+		merged.fec.parity_packets = rhs.fec.parity_packets;
+
+	if (merged.fec.delay_ms == -1)
+		merged.fec.delay_ms = rhs.fec.delay_ms;
+
+	if (merged.ack.packets == -1)
+		merged.ack.packets = rhs.ack.packets;
+
+	if (merged.ack.delay_ms == -1)
+		merged.ack.delay_ms = rhs.ack.delay_ms;
+
+	if (merged.receive_window == -1)
+		merged.receive_window = rhs.receive_window;
+
+	if (merged.send_buffer == -1)
+		merged.send_buffer = rhs.send_buffer;
+
 	return merged;
 }
 
@@ -10,18 +10,37 @@ namespace mrudp {
 typedef uint8_t VersionID;
 typedef uint16_t ShortConnectionID;
 
-const VersionID MRUDP_VERSION = 1;
+// the version of the packets, a packet of another version is discarded, see
+// Socket::receive.  Version 2 acks with SACK_FRAMEs rather than ACK_FRAMEs, and
+// in the trailers of DATA_RELIABLE_WITH_ACKS packets, and adds the stream trailer
+// of the reliable packets.
+const VersionID MRUDP_VERSION = 2;
 
 enum Reliability {
-	UNRELIABLE,
-	RELIABLE
+	UNRELIABLE = MRUDP_UNRELIABLE,
+	RELIABLE = MRUDP_RELIABLE,
+	RELIABLE_UNORDERED = MRUDP_RELIABLE_UNORDERED
 } ;
 
+// the reliability given to the api, any other which is not zero is reliable
+inline
+Reliability toReliability(int reliable)
+{
+	if (reliable == MRUDP_UNRELIABLE)
+		return UNRELIABLE;
+		
+	if (reliable == MRUDP_RELIABLE_UNORDERED)
+		return RELIABLE_UNORDERED;
+		
+	return RELIABLE;
+}
+
 enum ErrorCode {
 	OK,
 	ERROR_GENERAL_FAILURE = MRUDP_ERROR_GENERAL_FAILURE,
 	ERROR_PACKET_SIZE_TOO_LARGE = MRUDP_ERROR_PACKET_SIZE_TOO_LARGE,
 	ERROR_CONNECTION_CLOSED = MRUDP_ERROR_PACKET_SIZE_TOO_LARGE,
+	ERROR_WOULD_BLOCK = MRUDP_ERROR_WOULD_BLOCK,
 } ;
 
 struct LongConnectionID {
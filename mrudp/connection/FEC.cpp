@@ -0,0 +1,550 @@
+#include "FEC.h"
+
+#include "../Connection.h"
+#include "../Socket.h"
+#include "../Service.h"
+
+#include "../Implementation.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+// --------------------------------------------------------------------------------
+// GF(256)
+//
+// The field of the Reed-Solomon code, with the polynomial 0x11d.  Addition is xor,
+// multiplication goes through the log and exp tables.
+// --------------------------------------------------------------------------------
+
+struct GF256
+{
+	u8 exp[512], log[256];
+
+	GF256 ()
+	{
+		unsigned x = 1;
+		for (auto i=0; i<255; ++i)
+		{
+			exp[i] = (u8)x;
+			log[x] = (u8)i;
+
+			x <<= 1;
+			if (x & 0x100)
+				x ^= 0x11d;
+		}
+
+		for (auto i=255; i<512; ++i)
+			exp[i] = exp[i - 255];
+
+		log[0] = 0;
+	}
+
+	u8 mul (u8 a, u8 b) const
+	{
+		if (a == 0 || b == 0)
+			return 0;
+
+		return exp[log[a] + log[b]];
+	}
+
+	u8 inv (u8 a) const
+	{
+		debug_assert(a != 0);
+		return exp[255 - log[a]];
+	}
+
+	// dst += c * src
+	void addScaled (u8 *dst, const u8 *src, size_t size, u8 c) const
+	{
+		if (c == 0)
+			return;
+
+		if (c == 1)
+		{
+			for (size_t i=0; i<size; ++i)
+				dst[i] ^= src[i];
+
+			return;
+		}
+
+		auto logC = log[c];
+		for (size_t i=0; i<size; ++i)
+			if (src[i])
+				dst[i] ^= exp[log[src[i]] + logC];
+	}
+} ;
+
+static const GF256 &gf256 ()
+{
+	static const GF256 field;
+	return field;
+}
+
+// the weight of data packet i in parity j, the rows of the Cauchy matrix are
+// 1 / (x_j + y_i) with x_j = 32 + j and y_i = i, which are all distinct
+static u8 coefficient (s8 mode, size_t j, size_t i)
+{
+	if (mode == MRUDP_FEC_XOR)
+		return 1;
+
+	static_assert(FECParameters::maximumDataPackets <= 32);
+	return gf256().inv(u8((32 + j) ^ i));
+}
+
+static size_t toSymbol (const Packet &packet, u8 *symbol)
+{
+	auto *p = (char *)symbol;
+	small_copy(p, (const char *)&packet.header.type, sizeof(packet.header.type));
+	p += sizeof(packet.header.type);
+	small_copy(p, (const char *)&packet.header.id, sizeof(packet.header.id));
+	p += sizeof(packet.header.id);
+	small_copy(p, (const char *)&packet.dataSize, sizeof(packet.dataSize));
+	p += sizeof(packet.dataSize);
+	mem_copy(p, packet.data, packet.dataSize);
+
+	return FEC_SYMBOL_HEADER_SIZE + packet.dataSize;
+}
+
+static PacketPtr fromSymbol (const u8 *symbol, size_t size)
+{
+	auto packet = newPacket();
+
+	auto *p = (const char *)symbol;
+	small_copy((char *)&packet->header.type, p, sizeof(packet->header.type));
+	p += sizeof(packet->header.type);
+	small_copy((char *)&packet->header.id, p, sizeof(packet->header.id));
+	p += sizeof(packet->header.id);
+	small_copy((char *)&packet->dataSize, p, sizeof(packet->dataSize));
+	p += sizeof(packet->dataSize);
+
+	if (!isData(packet->header.type))
+		return nullptr;
+
+	if (packet->dataSize > size - FEC_SYMBOL_HEADER_SIZE)
+		return nullptr;
+
+	mem_copy(packet->data, p, packet->dataSize);
+	return packet;
+}
+
+static PacketPtr copyOf (const Packet &packet)
+{
+	auto copy = newPacket();
+	copy->header = packet.header;
+	mem_copy(copy->data, packet.data, packet.dataSize);
+	copy->dataSize = packet.dataSize;
+
+	return copy;
+}
+
+// inverts the matrix in place, returns false if it is singular
+static bool invert (u8 (&m)[FECParameters::maximumParityPackets][FECParameters::maximumParityPackets], size_t n)
+{
+	auto &gf = gf256();
+
+	u8 inverse[FECParameters::maximumParityPackets][FECParameters::maximumParityPackets] = { 0 };
+	for (size_t i=0; i<n; ++i)
+		inverse[i][i] = 1;
+
+	for (size_t column=0; column<n; ++column)
+	{
+		auto pivot = column;
+		while (pivot < n && m[pivot][column] == 0)
+			++pivot;
+
+		if (pivot == n)
+			return false;
+
+		std::swap(m[pivot], m[column]);
+		std::swap(inverse[pivot], inverse[column]);
+
+		auto scale = gf.inv(m[column][column]);
+		for (size_t k=0; k<n; ++k)
+		{
+			m[column][k] = gf.mul(m[column][k], scale);
+			inverse[column][k] = gf.mul(inverse[column][k], scale);
+		}
+
+		for (size_t row=0; row<n; ++row)
+		{
+			if (row == column || m[row][column] == 0)
+				continue;
+
+			auto factor = m[row][column];
+			gf.addScaled(m[row], m[column], n, factor);
+			gf.addScaled(inverse[row], inverse[column], n, factor);
+		}
+	}
+
+	mem_copy((char *)m, (char *)inverse, sizeof(inverse));
+	return true;
+}
+
+// --------------------------------------------------------------------------------
+
+FECParameters FECParameters::clamped () const
+{
+	if (mode != MRUDP_FEC_XOR && mode != MRUDP_FEC_REED_SOLOMON)
+		return FECParameters();
+
+	auto clamp = [](int v, int lo, int hi) { return (u8)std::min(std::max(v, lo), hi); };
+
+	return FECParameters {
+		.mode = mode,
+		.dataPackets = clamp(dataPackets, 1, maximumDataPackets),
+		.parityPackets = mode == MRUDP_FEC_XOR ? (u8)1 : clamp(parityPackets, 1, maximumParityPackets)
+	} ;
+}
+
+// --------------------------------------------------------------------------------
+
+void FECEncoder::open (const FECParameters &parameters_)
+{
+	parameters = parameters_;
+
+	count = 0;
+	size = 0;
+	parities.assign(parameters.parityPackets, Vector<u8>(MAX_FEC_SYMBOL_SIZE, 0));
+}
+
+FECTrailer FECEncoder::add (const Packet &packet)
+{
+	debug_assert(!full());
+
+	u8 symbol[MAX_FEC_SYMBOL_SIZE];
+	auto symbolSize = toSymbol(packet, symbol);
+	size = std::max(size, symbolSize);
+
+	for (size_t j=0; j<parities.size(); ++j)
+		gf256().addScaled(parities[j].data(), symbol, symbolSize, coefficient(parameters.mode, j, count));
+
+	return FECTrailer { .group = group, .index = count++ };
+}
+
+void FECEncoder::close (Vector<PacketPtr> &packets)
+{
+	if (empty())
+		return;
+
+	for (size_t j=0; j<parities.size(); ++j)
+	{
+		auto &parity = parities[j];
+
+		auto packet = newPacket();
+		packet->header.type = FEC_PARITY;
+		mem_copy(packet->data, (char *)parity.data(), size);
+		packet->dataSize = (Packet::Size)size;
+
+		pushData(*packet, FECParityTrailer { .group = group, .index = (u8)j, .count = count });
+		packets.push_back(std::move(packet));
+
+		std::fill(parity.begin(), parity.begin() + size, 0);
+	}
+
+	group++;
+	count = 0;
+	size = 0;
+}
+
+// --------------------------------------------------------------------------------
+
+void FECDecoder::open (const FECParameters &parameters_)
+{
+	parameters = parameters_;
+	groups.assign(capacity, Group());
+}
+
+FECDecoder::Group *FECDecoder::find (u16 id)
+{
+	if (groups.empty())
+		return nullptr;
+
+	auto &group = groups[id % capacity];
+	if (group.used)
+	{
+		if (group.id == id)
+			return &group;
+
+		if (!id_greater_than(id, group.id))
+			return nullptr;
+	}
+
+	group.id = id;
+	group.used = true;
+	group.count = 0;
+	group.received = 0;
+	group.data.assign(parameters.dataPackets, nullptr);
+	group.parities.assign(parameters.parityPackets, nullptr);
+	group.recovered.assign(parameters.dataPackets, false);
+
+	return &group;
+}
+
+PacketDiscard FECDecoder::onData (const FECTrailer &trailer, const Packet &packet, Vector<PacketPtr> &recovered)
+{
+	if (trailer.index >= parameters.dataPackets)
+		return Keep;
+
+	auto *group = find(trailer.group);
+	if (!group)
+		return Keep;
+
+	// a reliable packet which was rebuilt is still acked when it is retried
+	if (group->recovered[trailer.index])
+		return packet.header.type == DATA_UNRELIABLE ? Discard : Keep;
+
+	auto &data = group->data[trailer.index];
+	if (data)
+		return Keep;
+
+	data = copyOf(packet);
+	group->received++;
+
+	recover(*group, recovered);
+	return Keep;
+}
+
+void FECDecoder::onParity (const Packet &packet_, Vector<PacketPtr> &recovered)
+{
+	auto packet = copyOf(packet_);
+
+	FECParityTrailer trailer;
+	if (!popData(*packet, trailer))
+		return;
+
+	if (trailer.index >= parameters.parityPackets ||
+		trailer.count == 0 ||
+		trailer.count > parameters.dataPackets ||
+		packet->dataSize < FEC_SYMBOL_HEADER_SIZE
+	)
+		return;
+
+	auto *group = find(trailer.group);
+	if (!group)
+		return;
+
+	auto &parity = group->parities[trailer.index];
+	if (parity)
+		return;
+
+	parity = std::move(packet);
+	group->count = trailer.count;
+
+	recover(*group, recovered);
+}
+
+void FECDecoder::recover (Group &group, Vector<PacketPtr> &recovered)
+{
+	if (group.count == 0 || group.received == group.count)
+		return;
+
+	const auto maximum = FECParameters::maximumParityPackets;
+
+	size_t missing[maximum], numMissing = 0;
+	for (size_t i=0; i<group.count; ++i)
+	{
+		if (group.data[i])
+			continue;
+
+		if (numMissing == group.parities.size())
+			return;
+
+		missing[numMissing++] = i;
+	}
+
+	size_t rows[maximum], numRows = 0;
+	for (size_t j=0; j<group.parities.size() && numRows < numMissing; ++j)
+		if (group.parities[j])
+			rows[numRows++] = j;
+
+	if (numMissing == 0 || numRows < numMissing)
+		return;
+
+	auto &gf = gf256();
+	auto size = (size_t)group.parities[rows[0]]->dataSize;
+
+	// each parity less the packets which arrived leaves the sum of the missing
+	Vector<u8> sums(numRows * size);
+	for (size_t r=0; r<numRows; ++r)
+	{
+		auto &parity = *group.parities[rows[r]];
+		if (parity.dataSize != size)
+			return;
+
+		mem_copy((char *)sums.data() + r * size, parity.data, size);
+	}
+
+	u8 symbol[MAX_FEC_SYMBOL_SIZE];
+	for (size_t i=0; i<group.count; ++i)
+	{
+		if (!group.data[i])
+			continue;
+
+		auto symbolSize = toSymbol(*group.data[i], symbol);
+		if (symbolSize > size)
+			return;
+
+		for (size_t r=0; r<numRows; ++r)
+			gf.addScaled(sums.data() + r * size, symbol, symbolSize, coefficient(parameters.mode, rows[r], i));
+	}
+
+	u8 m[maximum][maximum];
+	for (size_t r=0; r<numRows; ++r)
+		for (size_t t=0; t<numMissing; ++t)
+			m[r][t] = coefficient(parameters.mode, rows[r], missing[t]);
+
+	if (!invert(m, numMissing))
+		return;
+
+	for (size_t t=0; t<numMissing; ++t)
+	{
+		std::fill(symbol, symbol + size, 0);
+		for (size_t r=0; r<numRows; ++r)
+			gf.addScaled(symbol, sums.data() + r * size, size, m[t][r]);
+
+		auto packet = fromSymbol(symbol, size);
+		if (!packet)
+			continue;
+
+		auto i = missing[t];
+		group.data[i] = packet;
+		group.recovered[i] = true;
+		group.received++;
+
+		recovered.push_back(std::move(packet));
+	}
+}
+
+// --------------------------------------------------------------------------------
+
+FEC::FEC (Connection *connection_) :
+	connection(connection_)
+{
+	connection->socket->service->scheduler->allocate(
+		timeout,
+		[this]() { this->onTimeout(); }
+	);
+}
+
+void FEC::agree (const FECParameters &parameters_)
+{
+	auto agreed = parameters_.clamped();
+	
+	// a retried handshake must not reset the groups in flight
+	if (agreed == parameters)
+		return;
+
+	{
+		auto lock = lock_of(sendMutex);
+		encoder.open(agreed);
+	}
+
+	{
+		auto lock = lock_of(receiveMutex);
+		decoder.open(agreed);
+	}
+
+	parameters = agreed;
+
+	// so that the agreed parameters are what the options of the connection report
+	connection->options.fec.mode = agreed.mode;
+	connection->options.fec.data_packets = agreed.dataPackets;
+	connection->options.fec.parity_packets = agreed.parityPackets;
+}
+
+PacketDiscard FEC::onSend (Packet &packet)
+{
+	if (!isEnabled())
+		return Keep;
+
+	if (!isData(packet.header.type))
+		return Keep;
+
+	auto now = connection->socket->service->clock.now();
+	bool opening = false;
+
+	{
+		auto lock = lock_of(sendMutex);
+
+		if (encoder.empty())
+		{
+			opened = now;
+			opening = true;
+		}
+
+		// the trailer is not part of the coded packet
+		auto trailer = encoder.add(packet);
+		if (!pushData(packet, trailer))
+			return Discard;
+
+		if (encoder.full())
+		{
+			encoder.close(parities);
+			opening = false;
+		}
+	}
+
+	if (opening)
+		timeout.schedule(opened + Duration(std::max(connection->options.fec.delay_ms, 0)));
+
+	return Keep;
+}
+
+void FEC::onTimeout ()
+{
+	{
+		auto lock = lock_of(sendMutex);
+		if (encoder.empty())
+			return;
+
+		encoder.close(parities);
+	}
+
+	sendParities();
+}
+
+void FEC::sendParities ()
+{
+	if (!isEnabled())
+		return;
+
+	Vector<PacketPtr> packets;
+
+	{
+		auto lock = lock_of(sendMutex);
+		std::swap(packets, parities);
+	}
+
+	for (auto &packet: packets)
+		connection->send(packet);
+}
+
+PacketDiscard FEC::onReceive (Packet &packet, Vector<PacketPtr> &recovered)
+{
+	if (packet.header.type == FEC_PARITY)
+	{
+		if (isEnabled())
+		{
+			auto lock = lock_of(receiveMutex);
+			decoder.onParity(packet, recovered);
+		}
+
+		return Discard;
+	}
+
+	if (!isEnabled())
+		return Keep;
+
+	if (!isData(packet.header.type))
+		return Keep;
+
+	FECTrailer trailer;
+	if (!popData(packet, trailer))
+		return Discard;
+
+	auto lock = lock_of(receiveMutex);
+	return decoder.onData(trailer, packet, recovered);
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "../Packet.h"
+#include "../Scheduler.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+struct Connection;
+
+// --------------------------------------------------------------------------------
+// FEC
+//
+// FEC sends parity packets over groups of data packets, so that the receiver may
+// rebuild the packets of a group which were lost without waiting on a retry.
+//
+// Each data packet carries a FECTrailer with its group and its index in the group.
+// A group is closed when it has filled, or when it has waited the delay, and its
+// parity packets are then sent.
+//
+// A packet is coded as its type, id, size and data, padded with zeros to the
+// longest packet of the group.  With XOR the single parity is the xor of the coded
+// packets.  With Reed-Solomon each parity is the sum of the coded packets weighted
+// by a row of a Cauchy matrix over GF(256), so that as many lost packets as there
+// are parities received can be rebuilt.
+// --------------------------------------------------------------------------------
+
+PACK(
+	struct FECTrailer {
+		u16 group;
+		u8 index;
+	}
+);
+
+PACK(
+	struct FECParityTrailer {
+		u16 group;
+		u8 index;
+
+		// the number of data packets in the group
+		u8 count;
+	}
+);
+
+struct FECParameters
+{
+	static constexpr size_t maximumDataPackets = 32, maximumParityPackets = 8;
+
+	s8 mode = MRUDP_FEC_NONE;
+	u8 dataPackets = 0, parityPackets = 0;
+
+	// the parameters within the limits, XOR has one parity
+	FECParameters clamped () const;
+	
+	bool operator ==(const FECParameters &rhs) const
+	{
+		return mode == rhs.mode && dataPackets == rhs.dataPackets && parityPackets == rhs.parityPackets;
+	}
+} ;
+
+// the type, id and size which precede the data of a coded packet
+const int FEC_SYMBOL_HEADER_SIZE = sizeof(TypeID) + sizeof(PacketID) + sizeof(Packet::Size);
+const int MAX_FEC_SYMBOL_SIZE = FEC_SYMBOL_HEADER_SIZE + MAX_PACKET_SIZE;
+
+struct FECEncoder
+{
+	FECParameters parameters;
+
+	u16 group = 0;
+	u8 count = 0;
+
+	// the longest coded packet of the group
+	size_t size = 0;
+	Vector<Vector<u8>> parities;
+
+	void open (const FECParameters &parameters);
+
+	bool empty () const { return count == 0; }
+	bool full () const { return count == parameters.dataPackets; }
+
+	// codes the packet into the parities of the group, returns its trailer
+	FECTrailer add (const Packet &packet);
+
+	// appends the parity packets of the group and begins the next
+	void close (Vector<PacketPtr> &packets);
+} ;
+
+struct FECDecoder
+{
+	// the groups kept at once, a group older than these is ignored
+	static constexpr size_t capacity = 64;
+
+	FECParameters parameters;
+
+	struct Group
+	{
+		u16 id = 0;
+		bool used = false;
+
+		// the number of data packets, known once a parity has arrived
+		u8 count = 0;
+		size_t received = 0;
+
+		Vector<PacketPtr> data, parities;
+		Vector<bool> recovered;
+	} ;
+
+	Vector<Group> groups;
+
+	void open (const FECParameters &parameters);
+
+	// the group of the id, or nullptr if it is older than those kept
+	Group *find (u16 id);
+
+	// keeps the packet, returns Discard if it is an unreliable packet which has
+	// already been rebuilt
+	PacketDiscard onData (const FECTrailer &trailer, const Packet &packet, Vector<PacketPtr> &recovered);
+	void onParity (const Packet &packet, Vector<PacketPtr> &recovered);
+
+	// rebuilds the missing packets of the group if there are enough parities
+	void recover (Group &group, Vector<PacketPtr> &recovered);
+} ;
+
+struct FEC
+{
+	FEC (Connection *connection);
+	Connection *connection;
+
+	// the agreed parameters, kept apart from the options so that setting the
+	// options does not change them
+	FECParameters parameters;
+
+	bool isEnabled () const { return parameters.mode != MRUDP_FEC_NONE; }
+
+	// uses the agreed parameters
+	void agree (const FECParameters &parameters);
+
+	Mutex sendMutex;
+	FECEncoder encoder;
+	Timepoint opened;
+
+	// the parity packets of the closed groups, waiting to be sent
+	Vector<PacketPtr> parities;
+
+	Timeout timeout;
+	void onTimeout ();
+
+	Mutex receiveMutex;
+	FECDecoder decoder;
+
+	// adds the trailer to a data packet, and closes the group if it has filled
+	PacketDiscard onSend (Packet &packet);
+	void sendParities ();
+
+	// pops the trailer of a data packet, or takes a parity, appends the packets
+	// which could be rebuilt
+	PacketDiscard onReceive (Packet &packet, Vector<PacketPtr> &recovered);
+} ;
+
+} // namespace
+} // namespace
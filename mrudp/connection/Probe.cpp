@@ -80,7 +80,7 @@ void Probe::onTimeout()
 		
 		if (sender.status == Sender::OPEN)
 		{
-			auto packet = strong<Packet>();
+			auto packet = newPacket();
 			packet->header.type = PROBE;
 			
 			sender.sendReliably(packet);
@@ -103,20 +103,12 @@ void Probe::onTimeout()
 
 void Probe::recalculateProbeTimeout ()
 {
-	auto &rtt_ = connection->sender.rtt;
-	auto &retrier = connection->sender.retrier;
-	
-	// we don't know what they other side thinks rtt is, so we have to assume the worst
-	// maybe rtt could be included in acks
-	auto rtt = rtt_.minimum;
-	
-	auto timeout = retrier.calculateRetryDuration(rtt);
+	// we don't know what they other side thinks rtt is, so we have to assume the worst,
+	// its quickest retries; maybe rtt could be included in acks
+	auto timeout = 0.0f;
 	auto numAttemptsBeforeProbe = (connection->sender.retrier.maximumAttempts + 1) / 2;
-	for (auto i=0; i<numAttemptsBeforeProbe; ++i)
-	{
-		rtt = rtt_.calculate(rtt, rtt_.maximum);
-		timeout += retrier.calculateRetryDuration(rtt);
-	}
+	for (auto i=0; i<=numAttemptsBeforeProbe; ++i)
+		timeout += RTT::backoff(RTT::minimumTimeout, i);
 
 	if (connection->options.probe_delay_ms > 0)
 		timeout += connection->options.probe_delay_ms / 1000.0;
@@ -5,6 +5,12 @@
 #include <boost/asio.hpp>
 #include <iostream>
 
+#ifdef SYS_LINUX
+	#include <netinet/udp.h>
+	#include <pthread.h>
+	#include <sched.h>
+#endif
+
 #include "AsioTesting.h"
 
 namespace timprepscius {
@@ -29,7 +35,24 @@ ConnectionOptions getDefaultConnectionOptions ()
 		},
 		
 		.probe_delay_ms = -1,
-		.maximum_retry_attempts = 5
+		.maximum_retry_attempts = 5,
+		.congestion_control = MRUDP_CONGESTION_SIMPLE,
+		.packet_numbers = MRUDP_PACKET_NUMBERS_16,
+		
+		.fec = {
+			.mode = MRUDP_FEC_NONE,
+			.data_packets = 8,
+			.parity_packets = 1,
+			.delay_ms = 10
+		},
+		
+		.ack = {
+			.packets = 16,
+			.delay_ms = 5
+		},
+		
+		.receive_window = 16384,
+		.send_buffer = 0
 	} ;
 }
 
@@ -40,6 +63,15 @@ OptionsImp systemDefaultOptions {
 	.overlapped_io = 0,
 	.send_via_queue = 1,
 	.thread_quantity = 1,
+	.batch_size = 0,
+	.segmentation_offload = 0,
+	.receive_offload = 0,
+	.reuse_port = 0,
+	.receive_depth = 1,
+	.busy_poll = 0,
+	.busy_poll_us = 0,
+	.cpu_affinity = 0,
+	.send_buffer = 0,
 } ;
 #else
 OptionsImp systemDefaultOptions {
@@ -48,6 +80,15 @@ OptionsImp systemDefaultOptions {
 	.overlapped_io = 1,
 	.send_via_queue = 0,
 	.thread_quantity = int8_t(std::thread::hardware_concurrency() - 1),
+	.batch_size = 0,
+	.segmentation_offload = 0,
+	.receive_offload = 0,
+	.reuse_port = 0,
+	.receive_depth = 1,
+	.busy_poll = 0,
+	.busy_poll_us = 0,
+	.cpu_affinity = 0,
+	.send_buffer = 0,
 } ;
 #endif
 
@@ -56,6 +97,32 @@ OptionsImp getDefaultOptions()
 	return systemDefaultOptions;
 }
 
+// the index-th cpu of the mask, wrapping
+int nthCpu(int64_t mask, int index)
+{
+	Vector<int> cpus;
+	for (auto cpu=0; cpu<64; ++cpu)
+		if (mask & (int64_t(1) << cpu))
+			cpus.push_back(cpu);
+
+	return cpus[index % cpus.size()];
+}
+
+OptionsImp getShardOptions(const OptionsImp *options, int index)
+{
+	auto shard = options ? *options : systemDefaultOptions;
+	
+	// each shard is served by its own thread
+	shard.thread_quantity = 1;
+	shard.reuse_port = 1;
+	
+	// which is given its own cpu of the mask
+	if (shard.cpu_affinity != 0 && shard.cpu_affinity != -1)
+		shard.cpu_affinity = int64_t(1) << nthCpu(shard.cpu_affinity, index);
+	
+	return shard;
+}
+
 void merge(OptionsImp &lhs, const OptionsImp &rhs)
 {
 	lhs.connection = mrudp::merge(lhs.connection, rhs.connection);
@@ -68,6 +135,30 @@ void merge(OptionsImp &lhs, const OptionsImp &rhs)
 
 	if (lhs.thread_quantity == -1)
 		lhs.thread_quantity = rhs.thread_quantity;
+
+	if (lhs.batch_size == -1)
+		lhs.batch_size = rhs.batch_size;
+
+	if (lhs.segmentation_offload == -1)
+		lhs.segmentation_offload = rhs.segmentation_offload;
+
+	if (lhs.receive_offload == -1)
+		lhs.receive_offload = rhs.receive_offload;
+
+	if (lhs.reuse_port == -1)
+		lhs.reuse_port = rhs.reuse_port;
+
+	if (lhs.receive_depth == -1)
+		lhs.receive_depth = rhs.receive_depth;
+
+	if (lhs.busy_poll == -1)
+		lhs.busy_poll = rhs.busy_poll;
+
+	if (lhs.busy_poll_us == -1)
+		lhs.busy_poll_us = rhs.busy_poll_us;
+
+	if (lhs.cpu_affinity == -1)
+		lhs.cpu_affinity = rhs.cpu_affinity;
 }
 
 // --------------------------
@@ -110,6 +201,15 @@ mrudp_addr_t toAddr(const udp::endpoint &endpoint)
 	return address_;
 }
 
+mrudp_addr_t toAddr(const sockaddr *address, size_t size)
+{
+	udp::endpoint endpoint;
+	memcpy(endpoint.data(), address, std::min(size, (size_t)endpoint.capacity()));
+	endpoint.resize(std::min(size, (size_t)endpoint.capacity()));
+	
+	return toAddr(endpoint);
+}
+
 udp::endpoint toEndpoint(const mrudp_addr_t &addr)
 {
 	if (addr.v4.sin_family == AF_INET)
@@ -132,13 +232,40 @@ udp::endpoint toEndpoint(const mrudp_addr_t &addr)
 
 // --------------------------
 
+// pins the calling thread to the index-th cpu of the mask, wrapping
+void pinToCpu(int64_t mask, int index)
+{
+	if (mask == 0 || mask == -1)
+		return;
+		
+#ifdef SYS_LINUX
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(nthCpu(mask, index), &set);
+	
+	auto result = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	if (result != 0)
+	{
+		std::cerr << "mrudp::asio could not pin runner " << index << ", error " << result << std::endl;
+	}
+#endif
+}
+
 SchedulerImp::SchedulerImp(io_service &io, const OptionsImp *options) :
-	timer(io)
+	timer(io),
+	isPolled(options->busy_poll == 1)
 {
 }
 
 void SchedulerImp::update(const Timepoint &next, bool isRequired)
 {
+	if (isPolled)
+	{
+		auto lock = lock_of(mutex);
+		deadline = next;
+		return;
+	}
+	
 	timer.expires_at(next);
 	
 	timer.async_wait([this](auto ec) {
@@ -155,6 +282,20 @@ void SchedulerImp::update(const Timepoint &next, bool isRequired)
 	});
 }
 
+void SchedulerImp::process(const Timepoint &now)
+{
+	{
+		auto lock = lock_of(mutex);
+		if (!deadline || *deadline > now)
+			return;
+
+		deadline.reset();
+	}
+
+	if (scheduler)
+		scheduler->process();
+}
+
 // --------------------------
 
 ServiceImp::ServiceImp (Service *parent_, const OptionsImp *options_) :
@@ -165,7 +306,7 @@ ServiceImp::ServiceImp (Service *parent_, const OptionsImp *options_) :
 
 	service = strong<io_service>();
 	resolver = strong<udp::resolver>(*service);
-	scheduler = strong<SchedulerImp>(*service, options_);
+	scheduler = strong<SchedulerImp>(*service, &options);
 }
 
 ServiceImp::~ServiceImp ()
@@ -212,13 +353,29 @@ void ServiceImp::start ()
 		
 		for (auto i=0; i<processor_count; ++i)
 		{
-			runners.emplace_back([this, service=this->service]() {
-				service->run();
+			runners.emplace_back([this, i, service=this->service]() {
+				pinToCpu(options.cpu_affinity, i);
+				
+				if (options.busy_poll == 1)
+					poll();
+				else
+					service->run();
 			});
 		}
 	}
 }
 
+void ServiceImp::poll ()
+{
+	// each poll runs the handlers which are ready, the reactor is checked
+	// without blocking, so a packet is handled as soon as it is readable
+	while (!service->stopped())
+	{
+		service->poll();
+		scheduler->process(Clock::now());
+	}
+}
+
 void ServiceImp::stop ()
 {
 	if (working)
@@ -391,6 +548,11 @@ void ConnectionImp::reacquireOverlappedSocket ()
 
 void SocketNative::send(const Send &send, Function<void (const error_code &)> &&f)
 {
+#ifdef SYS_LINUX
+	if (!send.segments.empty())
+		return sendSegmented(send, std::move(f));
+#endif
+
 	auto lock = shared_lock_of(handleMutex);
 	
 	if (!handle.is_open())
@@ -452,7 +614,7 @@ void SocketNative::receive(Receive &receive, Function<void (const error_code &)>
 		return;
 	}
 
-	auto *buffer_ = (char *)&receive.packet;
+	auto *buffer_ = (char *)ptr_of(receive.packet);
 	auto size = sizeof(Packet) - sizeof(Packet::dataSize);
 	
 	if (isOverlapped)
@@ -484,14 +646,14 @@ void SocketNative::receive(Receive &receive, Function<void (const error_code &)>
 				{
 					if (receive.endpoint != remoteEndpoint)
 					{
-						xTraceChar(this, receive.packet.header.id, '?', (char)receive.packet.header.type);
+						xTraceChar(this, receive.packet->header.id, '?', (char)receive.packet->header.type);
 						sLogDebug("mrudp::overlap_io", "remoteReceived isn't as expected!" << logVar(receive.endpoint) << " != " << logVar(remoteEndpoint));
 					}
 					
 					if (bytesTransferred < sizeof(Header))
 						error = errc::make_error_code(errc::illegal_byte_sequence);
 					else
-						receive.packet.dataSize = bytesTransferred - sizeof(Header);
+						receive.packet->dataSize = bytesTransferred - sizeof(Header);
 				}
 
 				f(error);
@@ -514,7 +676,7 @@ void SocketNative::receive(Receive &receive, Function<void (const error_code &)>
 					if (bytesTransferred < sizeof(Header))
 						error = errc::make_error_code(errc::illegal_byte_sequence);
 					else
-						receive.packet.dataSize = bytesTransferred - sizeof(Header);
+						receive.packet->dataSize = bytesTransferred - sizeof(Header);
 				}
 
 				f(error);
@@ -526,6 +688,336 @@ void SocketNative::receive(Receive &receive, Function<void (const error_code &)>
 
 // -------------------------------------
 
+#ifdef SYS_LINUX
+
+ReceiveBatch::ReceiveBatch(size_t size) :
+	packets(size),
+	addresses(size),
+	buffers(size),
+	messages(size)
+{
+	reset();
+}
+
+void ReceiveBatch::reset()
+{
+	for (size_t i=0; i<messages.size(); ++i)
+	{
+		buffers[i].iov_base = &packets[i];
+		buffers[i].iov_len = sizeof(Packet) - sizeof(Packet::dataSize);
+		
+		auto &message = messages[i];
+		memset(&message, 0, sizeof(message));
+		message.msg_hdr.msg_name = &addresses[i];
+		message.msg_hdr.msg_namelen = sizeof(addresses[i]);
+		message.msg_hdr.msg_iov = &buffers[i];
+		message.msg_hdr.msg_iovlen = 1;
+	}
+}
+
+void prepare(msghdr &message, const Send &send, iovec *buffers, SegmentControl &control, bool isConnected)
+{
+	memset(&message, 0, sizeof(message));
+	
+	auto *buffer = buffers;
+	buffer->iov_base = ptr_of(send.packet);
+	buffer->iov_len = send.packet->dataSize + sizeof(Header);
+	
+	for (auto &packet: send.segments)
+	{
+		++buffer;
+		buffer->iov_base = ptr_of(packet);
+		buffer->iov_len = packet->dataSize + sizeof(Header);
+	}
+	
+	message.msg_iov = buffers;
+	message.msg_iovlen = 1 + send.segments.size();
+	
+	if (!send.segments.empty())
+	{
+		memset(&control, 0, sizeof(control));
+		message.msg_control = control.buffer;
+		message.msg_controllen = sizeof(control.buffer);
+		
+		auto *header = CMSG_FIRSTHDR(&message);
+		header->cmsg_level = SOL_UDP;
+		header->cmsg_type = UDP_SEGMENT;
+		header->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+		
+		uint16_t segmentSize = buffers[0].iov_len;
+		memcpy(CMSG_DATA(header), &segmentSize, sizeof(segmentSize));
+	}
+	
+	if (!isConnected)
+	{
+		message.msg_name = (void *)&send.address.ip;
+		message.msg_namelen =
+			send.address.ip.sa_family == AF_INET ?
+				sizeof(send.address.v4) : sizeof(send.address.v6);
+	}
+}
+
+bool isSegmentationUnavailable(const error_code &error)
+{
+	if (error.category() != boost::system::system_category())
+		return false;
+		
+	auto value = error.value();
+	return value == EIO || value == EINVAL || value == ENOPROTOOPT || value == EOPNOTSUPP;
+}
+
+void SendBatch::prepare(bool isConnected)
+{
+	size_t numBuffers = 0;
+	for (auto *send: sends)
+		numBuffers += 1 + send->segments.size();
+		
+	buffers.resize(numBuffers);
+	controls.resize(sends.size());
+	messages.resize(sends.size());
+	
+	auto *buffer = buffers.data();
+	for (size_t i=0; i<sends.size(); ++i)
+	{
+		auto &send = *sends[i];
+		auto &message = messages[i];
+		
+		imp::prepare(message.msg_hdr, send, buffer, controls[i], isConnected);
+		message.msg_len = 0;
+		
+		buffer += message.msg_hdr.msg_iovlen;
+	}
+}
+
+size_t SocketNative::send(SendBatch &batch, error_code &error)
+{
+	auto lock = shared_lock_of(handleMutex);
+	
+	if (!handle.is_open())
+	{
+		error = boost::asio::error::bad_descriptor;
+		return 0;
+	}
+
+	batch.prepare(isOverlapped);
+	
+	auto result = ::sendmmsg(handle.native_handle(), batch.messages.data(), (unsigned int)batch.messages.size(), MSG_DONTWAIT);
+	if (result < 0)
+	{
+		error = error_code(errno, boost::system::system_category());
+		sLogDebug("mrudp::send", logOfThis(this) << "sendmmsg failed " << logVar(error));
+		
+		return 0;
+	}
+	
+	return (size_t)result;
+}
+
+void SocketNative::sendSegmented(const Send &send, Function<void (const error_code &)> &&f)
+{
+	auto lock = shared_lock_of(handleMutex);
+	
+	if (!handle.is_open())
+	{
+		return;
+	}
+	
+	debug_assert(1 + send.segments.size() <= MAX_SEGMENTS);
+	
+	iovec buffers[MAX_SEGMENTS];
+	SegmentControl control;
+	msghdr message;
+	prepare(message, send, buffers, control, isOverlapped);
+	
+	error_code error;
+	if (::sendmsg(handle.native_handle(), &message, MSG_DONTWAIT) < 0)
+	{
+		error = error_code(errno, boost::system::system_category());
+		sLogDebug("mrudp::send", logOfThis(this) << "segmented sendmsg failed " << logVar(error));
+	}
+	
+	if (error == boost::asio::error::would_block || error == boost::asio::error::try_again)
+	{
+		handle.async_wait(
+			udp::socket::wait_write,
+			[this, send, f=std::move(f)](auto error) mutable {
+				if (error)
+					return f(error);
+					
+				sendSegmented(send, std::move(f));
+			}
+		);
+		
+		return;
+	}
+
+	// the completion is posted, just as the completion of async_send_to
+	post(
+		handle.get_executor(),
+		[error, f=std::move(f)]() {
+			f(error);
+		}
+	);
+}
+
+size_t SocketNative::receive_(ReceiveBatch &batch, error_code &error)
+{
+	if (!handle.is_open())
+	{
+		error = boost::asio::error::bad_descriptor;
+		return 0;
+	}
+
+	batch.reset();
+	
+	auto result = ::recvmmsg(handle.native_handle(), batch.messages.data(), (unsigned int)batch.messages.size(), MSG_DONTWAIT, nullptr);
+	if (result < 0)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			error = error_code(errno, boost::system::system_category());
+			
+		return 0;
+	}
+	
+	return (size_t)result;
+}
+
+void SocketNative::receive(ReceiveBatch &batch, Function<void (const error_code &, size_t)> &&f)
+{
+	receiveNonBlocking(batch, std::move(f));
+}
+
+ReceiveCoalesced::ReceiveCoalesced() :
+	buffer(std::numeric_limits<u16>::max() + sizeof(Packet))
+{
+	reset();
+}
+
+void ReceiveCoalesced::reset()
+{
+	iov.iov_base = buffer.data();
+	iov.iov_len = std::numeric_limits<u16>::max();
+	
+	memset(&message, 0, sizeof(message));
+	message.msg_name = &address;
+	message.msg_namelen = sizeof(address);
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control.buffer;
+	message.msg_controllen = sizeof(control.buffer);
+	
+	segmentSize = 0;
+}
+
+bool SocketNative::enableReceiveOffload()
+{
+	auto lock = shared_lock_of(handleMutex);
+
+	int enable = 1;
+	return ::setsockopt(handle.native_handle(), SOL_UDP, UDP_GRO, &enable, sizeof(enable)) == 0;
+}
+
+bool SocketNative::enableBusyPoll(int microseconds)
+{
+#ifdef SO_BUSY_POLL
+	auto lock = shared_lock_of(handleMutex);
+
+	return ::setsockopt(handle.native_handle(), SOL_SOCKET, SO_BUSY_POLL, &microseconds, sizeof(microseconds)) == 0;
+#else
+	return false;
+#endif
+}
+
+size_t SocketNative::receive_(ReceiveCoalesced &coalesced, error_code &error)
+{
+	if (!handle.is_open())
+	{
+		error = boost::asio::error::bad_descriptor;
+		return 0;
+	}
+
+	coalesced.reset();
+	
+	auto result = ::recvmsg(handle.native_handle(), &coalesced.message, MSG_DONTWAIT);
+	if (result < 0)
+	{
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			error = error_code(errno, boost::system::system_category());
+			
+		return 0;
+	}
+	
+	for (auto *header = CMSG_FIRSTHDR(&coalesced.message); header; header = CMSG_NXTHDR(&coalesced.message, header))
+	{
+		if (header->cmsg_level == SOL_UDP && header->cmsg_type == UDP_GRO)
+		{
+			int segmentSize;
+			memcpy(&segmentSize, CMSG_DATA(header), sizeof(segmentSize));
+			coalesced.segmentSize = segmentSize;
+		}
+	}
+	
+	// a buffer without the control message is a single datagram
+	if (coalesced.segmentSize == 0)
+		coalesced.segmentSize = result;
+	
+	return (size_t)result;
+}
+
+void SocketNative::receive(ReceiveCoalesced &coalesced, Function<void (const error_code &, size_t)> &&f)
+{
+	receiveNonBlocking(coalesced, std::move(f));
+}
+
+template<typename T>
+void SocketNative::receiveNonBlocking(T &receiver, Function<void (const error_code &, size_t)> &&f)
+{
+	auto lock = shared_lock_of(handleMutex);
+	
+	if (!handle.is_open())
+	{
+		return;
+	}
+	
+	// just as async_receive_from, the read is attempted before waiting on the reactor
+	error_code error;
+	auto received = receive_(receiver, error);
+	
+	if (error || received > 0)
+	{
+		post(
+			handle.get_executor(),
+			[error, received, f=std::move(f)]() {
+				f(error, received);
+			}
+		);
+		
+		return;
+	}
+
+	handle.async_wait(
+		udp::socket::wait_read,
+		[this, &receiver, f=std::move(f)](auto error) {
+			size_t received = 0;
+			
+			if (!error)
+			{
+				auto lock = shared_lock_of(handleMutex);
+				received = receive_(receiver, error);
+			}
+			
+			if (error)
+			{
+				xDebugLine();
+			}
+			
+			f(error, received);
+		}
+	);
+}
+
+#endif
+
 SocketNative::~SocketNative()
 {
 	if (auto socket_ = strong(socket))
@@ -568,6 +1060,17 @@ void SocketImp::acquireAddress(const Address &address)
 		if (error)
 			return handleError(error);
 
+		// a specific port is shared from the start, an ephemeral port is first
+		// bound exclusively below, for the reasons given there
+		auto isReusingPort = options.reuse_port == 1 && endpoint.port() != 0;
+		if (isReusingPort)
+		{
+			socket->handle.set_option(overlap_socket(true), error);
+			
+			if (error)
+				return handleError(error);
+		}
+
 		socket->handle.bind(endpoint);
 		MRUDP_ASIO_TEST_GENERATE_FAILURE(acquireAddress__socket_handle_bind, error);
 
@@ -581,7 +1084,7 @@ void SocketImp::acquireAddress(const Address &address)
 		
 		acquiredAddress = parent_->service->imp->insertEndpoint(localEndpoint);
 		
-		if (options.overlapped_io == 1)
+		if ((options.overlapped_io == 1 || options.reuse_port == 1) && !isReusingPort)
 		{
 			// when you look at the following code, you will probably say to yourself
 			// "WTF is this? Is this really necessary?"  The answer is: yes, yes it is.
@@ -707,7 +1210,7 @@ StrongPtr<SocketNative> SocketImp::getOverlappedSocket(const Address &remoteAddr
 			
 			overlappedSocket_ = weak(overlappedSocket);
 			
-			doReceive(overlappedSocket, strong<Receive>());
+			beginReceive(overlappedSocket);
 			
 			return overlappedSocket;
 		}
@@ -745,7 +1248,58 @@ void SocketImp::open()
 	debug_assert(running == false);
 	running = true;
 	
-	doReceive(socket, strong<Receive>());
+	beginReceive(socket);
+}
+
+bool SocketImp::isBatched()
+{
+#ifdef SYS_LINUX
+	return options.batch_size > 1;
+#else
+	return false;
+#endif
+}
+
+void SocketImp::beginReceive(const StrongPtr<SocketNative> &socket)
+{
+	// each outstanding receive owns its buffers for the life of the socket, the
+	// receive queue of each connection puts the packets back in order.  An
+	// overlapped socket serves a single connection, so it keeps one.
+	auto depth = socket->isOverlapped ? 1 : std::max(1, (int)options.receive_depth);
+	
+#ifdef SYS_LINUX
+	if (options.busy_poll_us > 0)
+	{
+		if (!socket->enableBusyPoll(options.busy_poll_us))
+		{
+			std::cerr << "mrudp::asio busy poll is unavailable, errno " << errno << std::endl;
+		}
+	}
+	
+	if (options.receive_offload == 1)
+	{
+		if (socket->enableReceiveOffload())
+		{
+			for (auto i=0; i<depth; ++i)
+				doReceiveCoalesced(socket, strong<ReceiveCoalesced>());
+				
+			return;
+		}
+			
+		sLogRelease("mrudp::asio", logOfThis(this) << "receive offload is unavailable, falling back");
+	}
+	
+	if (isBatched())
+	{
+		for (auto i=0; i<depth; ++i)
+			doReceiveBatch(socket, strong<ReceiveBatch>(options.batch_size));
+			
+		return;
+	}
+#endif
+
+	for (auto i=0; i<depth; ++i)
+		doReceive(socket, strong<Receive>());
 }
 
 void SocketImp::doReceive(const StrongPtr<SocketNative> &socket, const StrongPtr<Receive> &receive)
@@ -761,9 +1315,13 @@ void SocketImp::doReceive(const StrongPtr<SocketNative> &socket, const StrongPtr
 			{
 				if (!error)
 				{
-					this->handleReceiveFrom(toAddr(receive->endpoint), receive->packet);
+					ReceivedPacket received(receive->packet);
+					this->handleReceiveFrom(toAddr(receive->endpoint), *receive->packet);
 				}
 				
+				if (receive->packet.pooled->references > 1)
+					receive->packet = newPacket();
+				
 				if (auto socket = strong(socket_))
 				{
 					doReceive(socket, receive);
@@ -777,44 +1335,323 @@ void SocketImp::doReceive(const StrongPtr<SocketNative> &socket, const StrongPtr
 	);
 }
 
-mrudp_error_code_t SocketImp::send(const PacketPtr &packet, Connection *connection, const Address *address_)
+#ifdef SYS_LINUX
+
+void SocketImp::doReceiveBatch(const StrongPtr<SocketNative> &socket, const StrongPtr<ReceiveBatch> &batch)
+{
+	if (!running)
+		return;
+		
+	socket->receive(
+		*batch,
+		[this, weak_self=weak_this(this), socket_=weak(socket), batch](auto &error, auto received)
+		{
+			if (auto self = strong(weak_self))
+			{
+				if (!error)
+				{
+					// packets are handed up in the order they were read from the socket
+					for (size_t i=0; i<received; ++i)
+					{
+						auto &message = batch->messages[i];
+						auto &packet = batch->packets[i];
+						
+						if (message.msg_len < sizeof(Header))
+							continue;
+							
+						packet.dataSize = message.msg_len - sizeof(Header);
+						
+						auto remoteAddress = toAddr((sockaddr *)&batch->addresses[i], message.msg_hdr.msg_namelen);
+						this->handleReceiveFrom(remoteAddress, packet);
+					}
+				}
+				
+				if (auto socket = strong(socket_))
+				{
+					doReceiveBatch(socket, batch);
+				}
+				else
+				{
+					sLogRelease("mrudp::asio", "doReceiveBatch ending");
+				}
+			}
+		}
+	);
+}
+
+void SocketImp::doReceiveCoalesced(const StrongPtr<SocketNative> &socket, const StrongPtr<ReceiveCoalesced> &coalesced)
+{
+	if (!running)
+		return;
+		
+	socket->receive(
+		*coalesced,
+		[this, weak_self=weak_this(this), socket_=weak(socket), coalesced](auto &error, auto received)
+		{
+			if (auto self = strong(weak_self))
+			{
+				if (!error && received > 0)
+				{
+					auto remoteAddress = toAddr((sockaddr *)&coalesced->address, coalesced->message.msg_namelen);
+					auto segmentSize = coalesced->segmentSize;
+					
+					auto *begin = coalesced->buffer.data();
+					auto *end = begin + received;
+					
+					char saved[sizeof(Packet)];
+					
+					for (auto *segment = begin; segment < end; segment += segmentSize)
+					{
+						auto size = std::min(segmentSize, size_t(end - segment));
+						if (size < sizeof(Header) || size > sizeof(Packet) - sizeof(Packet::dataSize))
+							continue;
+						
+						// the bytes of the following segments which the view overlaps
+						auto *overlap = segment + size;
+						auto overlapSize = std::min(sizeof(Packet) - size, size_t(std::max(end - overlap, (ptrdiff_t)0)));
+						memcpy(saved, overlap, overlapSize);
+						
+						auto &packet = *(Packet *)segment;
+						packet.dataSize = size - sizeof(Header);
+						
+						this->handleReceiveFrom(remoteAddress, packet);
+						
+						memcpy(overlap, saved, overlapSize);
+					}
+				}
+				
+				if (auto socket = strong(socket_))
+				{
+					doReceiveCoalesced(socket, coalesced);
+				}
+				else
+				{
+					sLogRelease("mrudp::asio", "doReceiveCoalesced ending");
+				}
+			}
+		}
+	);
+}
+
+void SocketImp::postSendBatch(const StrongPtr<SocketNative> &socket)
+{
+	post(
+		socket->handle.get_executor(),
+		[this, weak_self=weak_this(this), socket]() {
+			if (auto self = strong(weak_self))
+				doSendBatch(socket);
+		}
+	);
+}
+
+void SocketImp::doSendBatch(const StrongPtr<SocketNative> &socket)
+{
+	auto &batch = socket->sendBatch;
+	
+	if (socket->queue.front(batch.sends, options.batch_size) == 0)
+		return;
+		
+	error_code error;
+	auto sent = socket->send(batch, error);
+	
+	if (error == boost::asio::error::would_block || error == boost::asio::error::try_again)
+	{
+		socket->handle.async_wait(
+			udp::socket::wait_write,
+			[this, weak_self=weak_this(this), socket](auto error) {
+				if (error)
+					return;
+					
+				if (auto self = strong(weak_self))
+					doSendBatch(socket);
+			}
+		);
+		
+		return;
+	}
+	
+	if (error == boost::asio::error::bad_descriptor)
+		return;
+	
+	if (sent == 0 && !batch.sends.front()->segments.empty() && isSegmentationUnavailable(error))
+	{
+		onSegmentationUnavailable(error);
+		socket->queue.split_front();
+		
+		return postSendBatch(socket);
+	}
+	
+	// a datagram which fails is dropped, just as with async_send_to
+	if (sent == 0)
+		sent = 1;
+	
+	// the next batch is posted, rather than sent immediately, so that the io threads
+	// interleave sending with receiving, just as the completion handlers of doSend do
+	if (socket->queue.pop_front(sent) > 0)
+		postSendBatch(socket);
+}
+
+#endif
+
+StrongPtr<SocketNative> *SocketImp::socketFor(Connection *connection, const Address *address)
 {
 	auto *socket = &this->socket;
 	
-	if (options.overlapped_io == 1 && !address_)
+	if (options.overlapped_io == 1 && !address)
 		socket = &connection->imp->overlappedSocket;
 
 	if (!*socket)
+		return nullptr;
+		
+	return socket;
+}
+
+mrudp_error_code_t SocketImp::send(const PacketPtr &packet, Connection *connection, const Address *address_)
+{
+	auto *socket = socketFor(connection, address_);
+	if (!socket)
 		return MRUDP_ERROR_GENERAL_FAILURE;
 
 	auto *address = address_ ? address_ : &connection->remoteAddress;
 	
-	
 	if (options.send_via_queue == 1)
-		sendViaQueue(*socket, *address, packet, connection);
+		sendViaQueue(*socket, Send { *address, packet });
 	else
-		sendDirect(*socket, *address, packet, connection);
+		sendDirect(*socket, Send { *address, packet });
+		
+	return MRUDP_OK;
+}
+
+mrudp_error_code_t SocketImp::send(PacketRun &run, Connection *connection)
+{
+	if (!isSegmented() || run.size() == 1)
+	{
+		for (auto &packet: run)
+			send(packet, connection, nullptr);
+			
+		return MRUDP_OK;
+	}
+
+	auto *socket = socketFor(connection, nullptr);
+	if (!socket)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	// linux requires every segment but the last to be of the same size
+	auto sizeOf = [](auto &packet) {
+		return packet->dataSize + sizeof(Header);
+	};
+	
+	for (auto i = run.begin(); i != run.end(); )
+	{
+		Send send { connection->remoteAddress, *i };
+		auto segmentSize = sizeOf(*i);
+		auto size = segmentSize;
 		
+		for (++i; i != run.end(); ++i)
+		{
+			auto nextSize = sizeOf(*i);
+			if (nextSize > segmentSize ||
+				size + nextSize > MAX_SEGMENTED_SIZE ||
+				send.segments.size() + 1 >= MAX_SEGMENTS
+			)
+				break;
+				
+			send.segments.push_back(*i);
+			size += nextSize;
+			
+			// a smaller packet can only be the last segment
+			if (nextSize < segmentSize)
+			{
+				++i;
+				break;
+			}
+		}
+		
+		if (options.send_via_queue == 1)
+			sendViaQueue(*socket, std::move(send));
+		else
+			sendDirect(*socket, std::move(send));
+	}
+	
 	return MRUDP_OK;
 }
 
-void SocketImp::sendDirect(const StrongPtr<SocketNative> &socket, const Address &addr, const PacketPtr &packet, Connection *connection)
+bool SocketImp::isSegmented()
+{
+#ifdef SYS_LINUX
+	return options.segmentation_offload == 1 && segmentationAvailable;
+#else
+	return false;
+#endif
+}
+
+void SocketImp::onSegmentationUnavailable(const error_code &error)
+{
+	if (segmentationAvailable.exchange(false))
+	{
+		sLogRelease("mrudp::asio", logOfThis(this) << "segmentation offload is unavailable, falling back " << logVar(error.message()));
+	}
+}
+
+void SocketImp::sendDirect(const StrongPtr<SocketNative> &socket, Send &&send)
 {
-	Send send { addr, packet };
+#ifdef SYS_LINUX
+	if (!send.segments.empty())
+	{
+		auto send_ = strong<Send>(std::move(send));
+		
+		socket->send(*send_, [this, weak_self=weak_this(this), socket, send_](auto &error) {
+			if (!isSegmentationUnavailable(error))
+				return;
+				
+			if (auto self = strong(weak_self))
+			{
+				onSegmentationUnavailable(error);
+				
+				sendDirect(socket, Send { send_->address, send_->packet });
+				for (auto &packet: send_->segments)
+					sendDirect(socket, Send { send_->address, packet });
+			}
+		});
+		
+		return;
+	}
+#endif
+
+	auto packet = send.packet;
 	socket->send(send, [packet](auto &error) {});
 }
 
-void SocketImp::sendViaQueue(const StrongPtr<SocketNative> &socket, const Address &addr, const PacketPtr &packet, Connection *connection)
+void SocketImp::sendViaQueue(const StrongPtr<SocketNative> &socket, Send &&send)
 {
-	if (socket->queue.push_back(Send { addr, packet }) == 1)
+	if (socket->queue.push_back(std::move(send)) == 1)
+	{
+#ifdef SYS_LINUX
+		// the flush is posted to the io threads, the packets queued in the meantime
+		// go out together with the same sendmmsg
+		if (isBatched())
+			return postSendBatch(socket);
+#endif
+
 		doSend(socket);
+	}
 }
 
 void SocketImp::doSend(const StrongPtr<SocketNative> &socket)
 {
 	auto *send = &socket->queue.front();
 
-	socket->send(*send, [this, socket](auto &error) {
+	socket->send(*send, [this, socket, send](auto &error) {
+#ifdef SYS_LINUX
+		if (!send->segments.empty() && isSegmentationUnavailable(error))
+		{
+			onSegmentationUnavailable(error);
+			socket->queue.split_front();
+			
+			return doSend(socket);
+		}
+#endif
+
 		if (socket->queue.pop_front() > 0)
 			doSend(socket);
 	});
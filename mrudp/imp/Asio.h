@@ -19,7 +19,10 @@ using namespace boost::system;
 
 // --------------------------
 
+const mrudp_imp_selector SELECTOR = MRUDP_IMP_ASIO;
+
 mrudp_addr_t toAddr(const udp::endpoint &endpoint);
+mrudp_addr_t toAddr(const sockaddr *address, size_t size);
 udp::endpoint toEndpoint(const mrudp_addr_t &addr);
 
 typedef mrudp_options_asio_t OptionsImp;
@@ -27,15 +30,23 @@ void merge(OptionsImp &lhs, const OptionsImp &rhs);
 
 OptionsImp getDefaultOptions();
 
+// the options for the index-th shard of a sharded listener
+OptionsImp getShardOptions(const OptionsImp *options, int index);
+
 struct Send
 {
 	Address address;
 	PacketPtr packet;
+	
+	// when not empty, the packets which follow packet in a single segmented datagram
+	PacketRun segments = {};
 } ;
 
 struct Receive
 {
-	Packet packet;
+	// pooled, so the data handed up can be retained; if it is, the next receive
+	// goes into a fresh packet
+	PacketPtr packet = newPacket();
 	udp::endpoint endpoint;
 } ;
 
@@ -50,10 +61,23 @@ struct SendQueue
 		return queue.front();
 	}
 	
-	size_t push_back(const Send &t)
+	// fills sends with pointers to the first maximum entries, the pointers
+	// stay valid until they are popped
+	size_t front(Vector<Send *> &sends, size_t maximum)
+	{
+		auto lk = lock_of(mutex);
+		sends.clear();
+		
+		for (auto i = queue.begin(); i != queue.end() && sends.size() < maximum; ++i)
+			sends.push_back(&*i);
+			
+		return sends.size();
+	}
+	
+	size_t push_back(Send &&t)
 	{
 		auto lk = lock_of(mutex);
-		queue.push_back(t);
+		queue.push_back(std::move(t));
 		return queue.size();
 	}
 
@@ -64,8 +88,121 @@ struct SendQueue
 		queue.pop_front();
 		return queue.size();
 	}
+
+	size_t pop_front(size_t count)
+	{
+		auto lk = lock_of(mutex);
+		debug_assert(queue.size() >= count);
+		while (count-- > 0)
+			queue.pop_front();
+			
+		return queue.size();
+	}
+	
+	// replaces a segmented send at the front with one send per packet
+	void split_front()
+	{
+		auto lk = lock_of(mutex);
+		auto &send = queue.front();
+		auto next = std::next(queue.begin());
+		
+		for (auto &packet: send.segments)
+			queue.insert(next, Send { send.address, packet });
+			
+		send.segments.clear();
+	}
+} ;
+
+// the limits linux places on a segmented datagram
+const size_t MAX_SEGMENTS = 64;
+const size_t MAX_SEGMENTED_SIZE = 65507;
+
+#ifdef SYS_LINUX
+
+// --------------------------------------------------------------------------------
+// ReceiveBatch, SendBatch
+//
+// When the batch_size option is greater than 1, the socket is drained with recvmmsg
+// each time it becomes readable, and the SendQueue is flushed with sendmmsg.
+//
+// The message headers point into the packets, so the batches are allocated once
+// per socket and reused.
+// --------------------------------------------------------------------------------
+
+struct ReceiveBatch
+{
+	ReceiveBatch(size_t size);
+	
+	Vector<Packet> packets;
+	Vector<sockaddr_storage> addresses;
+	Vector<iovec> buffers;
+	Vector<mmsghdr> messages;
+	
+	void reset();
 } ;
 
+// --------------------------------------------------------------------------------
+// SegmentControl
+//
+// A send with segments goes out as one sendmsg, with an iovec per packet and the
+// segment size (the size of the first packet) given in a UDP_SEGMENT control
+// message.  The kernel, or the network card, splits it back into datagrams.
+// --------------------------------------------------------------------------------
+
+union SegmentControl
+{
+	// large enough for the uint16_t of UDP_SEGMENT and the int of UDP_GRO
+	char buffer[CMSG_SPACE(sizeof(int))];
+	size_t align;
+} ;
+
+// the buffers must have space for the packet and each of the segments
+void prepare(msghdr &message, const Send &send, iovec *buffers, SegmentControl &control, bool isConnected);
+
+// the errors with which linux refuses a segmented datagram
+bool isSegmentationUnavailable(const error_code &error);
+
+struct SendBatch
+{
+	Vector<Send *> sends;
+	Vector<iovec> buffers;
+	Vector<SegmentControl> controls;
+	Vector<mmsghdr> messages;
+	
+	void prepare(bool isConnected);
+} ;
+
+// --------------------------------------------------------------------------------
+// ReceiveCoalesced
+//
+// When the receive_offload option is 1, UDP_GRO is enabled on the socket, and the
+// kernel may coalesce consecutive datagrams from one sender into a single buffer,
+// giving the segment size in a control message.
+//
+// The segments are handed up as Packet views into the buffer rather than being
+// copied out.  The tail of a view (its unused data and its dataSize field) overlaps
+// the segments which follow, so those bytes are saved before the view is handed up
+// and restored afterwards.  For full sized segments that is only a few bytes.
+// --------------------------------------------------------------------------------
+
+struct ReceiveCoalesced
+{
+	ReceiveCoalesced();
+	
+	// room for the largest datagram, plus a Packet so the last view stays in bounds
+	Vector<char> buffer;
+	sockaddr_storage address;
+	iovec iov;
+	SegmentControl control;
+	msghdr message;
+	
+	size_t segmentSize;
+	
+	void reset();
+} ;
+
+#endif
+
 struct SocketNative
 {
 	SocketNative(io_service &service) :
@@ -102,10 +239,44 @@ struct SocketNative
 	
 	void send(const Send &send, Function<void(const error_code &)> &&f);
 	void receive(Receive &receive, Function<void(const error_code &)> &&f);
+
+#ifdef SYS_LINUX
+	SendBatch sendBatch;
+
+	// sends the prepared batch without blocking, returns the number of datagrams sent
+	size_t send(SendBatch &batch, error_code &error);
+	
+	void sendSegmented(const Send &send, Function<void(const error_code &)> &&f);
+	
+	// reads as many datagrams as are available, waiting for the socket to become
+	// readable if there are none
+	void receive(ReceiveBatch &batch, Function<void(const error_code &, size_t)> &&f);
+	size_t receive_(ReceiveBatch &batch, error_code &error);
+	
+	// enables UDP_GRO, returns false if the kernel does not support it
+	bool enableReceiveOffload();
+	
+	// sets SO_BUSY_POLL, returns false if the kernel refuses it
+	bool enableBusyPoll(int microseconds);
+	
+	// reads one possibly coalesced buffer, waiting for the socket to become readable
+	void receive(ReceiveCoalesced &coalesced, Function<void(const error_code &, size_t)> &&f);
+	size_t receive_(ReceiveCoalesced &coalesced, error_code &error);
+	
+	template<typename T>
+	void receiveNonBlocking(T &receiver, Function<void(const error_code &, size_t)> &&f);
+#endif
 } ;
 
 // ------------
 
+// --------------------------------------------------------------------------------
+// SchedulerImp
+//
+// Normally the first timeout is waited for with a steady_timer.  With busy_poll
+// the runners check the deadline between polls instead, so nothing is armed.
+// --------------------------------------------------------------------------------
+
 struct SchedulerImp
 {
 	OptionsImp options;
@@ -115,10 +286,15 @@ struct SchedulerImp
 	Scheduler *scheduler = nullptr;
 	uint64_t nextExpiration = 0;
 	steady_timer timer;
+	
+	bool isPolled;
+	Mutex mutex;
+	Optional<Timepoint> deadline;
 
 	void update(const Timepoint &when, bool isRequired);
 	
-	void process();
+	// runs the scheduler if the deadline has passed, used when polled
+	void process(const Timepoint &now);
 } ;
 
 // ---------
@@ -147,6 +323,9 @@ struct ServiceImp : StrongThis<ServiceImp>
 	
 	void start ();
 	void stop ();
+	
+	// the loop of a runner thread with busy_poll
+	void poll ();
 
 	void resolve(const String &host, const String &port, Function<void(Vector<mrudp_addr_t> &&)> &&f);
 	
@@ -187,7 +366,20 @@ struct SocketImp : StrongThis<SocketImp>
 	void releaseOverlappedSocket(const Address &);
 
 	bool running = false;
+	void beginReceive(const StrongPtr<SocketNative> &);
 	void doReceive(const StrongPtr<SocketNative> &, const StrongPtr<Receive> &packet);
+
+	bool isBatched();
+	
+	Atomic<bool> segmentationAvailable = true;
+	bool isSegmented();
+	void onSegmentationUnavailable(const error_code &error);
+#ifdef SYS_LINUX
+	void doReceiveBatch(const StrongPtr<SocketNative> &, const StrongPtr<ReceiveBatch> &batch);
+	void doReceiveCoalesced(const StrongPtr<SocketNative> &, const StrongPtr<ReceiveCoalesced> &coalesced);
+	void postSendBatch(const StrongPtr<SocketNative> &);
+	void doSendBatch(const StrongPtr<SocketNative> &);
+#endif
 	
 	SocketImp(const StrongPtr<Socket> &parent, const Address &address);
 	~SocketImp ();
@@ -198,9 +390,11 @@ struct SocketImp : StrongThis<SocketImp>
 	void connect(const Address &address);
 	void handleReceiveFrom(const Address &remoteAddress, Packet &receivePacket);
 	
+	StrongPtr<SocketNative> *socketFor(Connection *connection, const Address *addr);
 	mrudp_error_code_t send(const PacketPtr &packet, Connection *connection, const Address *addr);
-	void sendDirect(const StrongPtr<SocketNative> &socket, const Address &addr, const PacketPtr &packet, Connection *connection);
-	void sendViaQueue(const StrongPtr<SocketNative> &socket, const Address &addr, const PacketPtr &packet, Connection *connection);
+	mrudp_error_code_t send(PacketRun &run, Connection *connection);
+	void sendDirect(const StrongPtr<SocketNative> &socket, Send &&send);
+	void sendViaQueue(const StrongPtr<SocketNative> &socket, Send &&send);
 	void doSend(const StrongPtr<SocketNative> &);
 	void close ();
 	
@@ -0,0 +1,923 @@
+#include "Uring.h"
+
+#include "../Base.h"
+#include "../Types.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <netdb.h>
+
+namespace timprepscius {
+namespace mrudp {
+namespace imp {
+
+// --------------------------
+
+ConnectionOptions getDefaultConnectionOptions ()
+{
+	return ConnectionOptions {
+		.coalesce_reliable = {
+			.mode = MRUDP_COALESCE_STREAM,
+			.delay_ms = 5,
+			.compression_level = 0
+		},
+
+		.coalesce_unreliable = {
+			.mode = MRUDP_COALESCE_PACKET,
+			.delay_ms = 5,
+			.compression_level = -1
+		},
+
+		.probe_delay_ms = -1,
+		.maximum_retry_attempts = 5,
+		.congestion_control = MRUDP_CONGESTION_SIMPLE,
+		.packet_numbers = MRUDP_PACKET_NUMBERS_16,
+		
+		.fec = {
+			.mode = MRUDP_FEC_NONE,
+			.data_packets = 8,
+			.parity_packets = 1,
+			.delay_ms = 10
+		},
+		
+		.ack = {
+			.packets = 16,
+			.delay_ms = 5
+		},
+		
+		.receive_window = 16384,
+		.send_buffer = 0
+	} ;
+}
+
+OptionsImp systemDefaultOptions {
+	.connection = getDefaultConnectionOptions(),
+
+	.queue_depth = 256,
+	.receive_buffers = 256,
+	.reuse_port = 0,
+	.send_buffer = 0,
+} ;
+
+OptionsImp getDefaultOptions()
+{
+	return systemDefaultOptions;
+}
+
+OptionsImp getShardOptions(const OptionsImp *options, int index)
+{
+	auto shard = options ? *options : systemDefaultOptions;
+	shard.reuse_port = 1;
+
+	return shard;
+}
+
+void merge(OptionsImp &lhs, const OptionsImp &rhs)
+{
+	lhs.connection = mrudp::merge(lhs.connection, rhs.connection);
+
+	if (lhs.queue_depth == -1)
+		lhs.queue_depth = rhs.queue_depth;
+
+	if (lhs.receive_buffers == -1)
+		lhs.receive_buffers = rhs.receive_buffers;
+
+	if (lhs.reuse_port == -1)
+		lhs.reuse_port = rhs.reuse_port;
+}
+
+// --------------------------
+
+mrudp_addr_t toAddr(const sockaddr *address, size_t size)
+{
+	mrudp_addr_t address_;
+	memset(&address_, 0, sizeof(address_));
+	memcpy(&address_, address, std::min(size, sizeof(address_)));
+
+	return address_;
+}
+
+socklen_t sizeOf(const mrudp_addr_t &address)
+{
+	return address.ip.sa_family == AF_INET ?
+		sizeof(address.v4) : sizeof(address.v6);
+}
+
+template<typename T>
+T load_acquire(T *t)
+{
+	return __atomic_load_n(t, __ATOMIC_ACQUIRE);
+}
+
+template<typename T>
+void store_release(T *t, T v)
+{
+	__atomic_store_n(t, v, __ATOMIC_RELEASE);
+}
+
+size_t roundUpToPage(size_t size)
+{
+	auto page = (size_t)sysconf(_SC_PAGESIZE);
+	return (size + page - 1) / page * page;
+}
+
+// --------------------------
+
+Ring::Ring(unsigned entries)
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+
+	// completions are reaped by one thread while many may submit, so the
+	// completion queue is given more room than the submission queue
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = entries * 4;
+
+	fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+	if (fd < 0)
+	{
+		sLogRelease("mrudp::uring", "io_uring_setup failed " << logVar(errno));
+		return;
+	}
+
+	sqMemorySize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	cqMemorySize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		sqMemorySize = cqMemorySize = std::max(sqMemorySize, cqMemorySize);
+
+	sqMemory = mmap(nullptr, sqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		cqMemory = sqMemory;
+	else
+		cqMemory = mmap(nullptr, cqMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+
+	sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+	auto sqes_ = mmap(nullptr, sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+	if (sqMemory == MAP_FAILED || cqMemory == MAP_FAILED || sqes_ == MAP_FAILED)
+	{
+		sLogRelease("mrudp::uring", "mmap failed " << logVar(errno));
+
+		if (sqes_ != MAP_FAILED)
+			munmap(sqes_, sqesSize);
+		if (cqMemory != MAP_FAILED && cqMemory != sqMemory)
+			munmap(cqMemory, cqMemorySize);
+		if (sqMemory != MAP_FAILED)
+			munmap(sqMemory, sqMemorySize);
+
+		sqMemory = cqMemory = nullptr;
+
+		::close(fd);
+		fd = -1;
+		return;
+	}
+
+	sqes = (io_uring_sqe *)sqes_;
+
+	auto *sq = (char *)sqMemory;
+	sqHead = (unsigned *)(sq + params.sq_off.head);
+	sqTail = (unsigned *)(sq + params.sq_off.tail);
+	sqMask = *(unsigned *)(sq + params.sq_off.ring_mask);
+	sqEntries = *(unsigned *)(sq + params.sq_off.ring_entries);
+	sqArray = (unsigned *)(sq + params.sq_off.array);
+	sqLocalTail = *sqTail;
+
+	auto *cq = (char *)cqMemory;
+	cqHead = (unsigned *)(cq + params.cq_off.head);
+	cqTail = (unsigned *)(cq + params.cq_off.tail);
+	cqMask = *(unsigned *)(cq + params.cq_off.ring_mask);
+	cqes = (io_uring_cqe *)(cq + params.cq_off.cqes);
+}
+
+Ring::~Ring()
+{
+	close();
+}
+
+bool Ring::isOpen()
+{
+	return fd >= 0;
+}
+
+void Ring::close()
+{
+	if (!isOpen())
+		return;
+
+	// deleting the outstanding operations releases the sockets they hold, which
+	// unregister their buffers, so the ring must still be open
+	Set<Operation *> operations_;
+	{
+		auto lock = lock_of(operationsMutex);
+		std::swap(operations_, operations);
+	}
+
+	for (auto *operation: operations_)
+		delete operation;
+
+	munmap(sqes, sqesSize);
+	if (cqMemory != sqMemory)
+		munmap(cqMemory, cqMemorySize);
+	munmap(sqMemory, sqMemorySize);
+
+	::close(fd);
+	fd = -1;
+}
+
+io_uring_sqe *Ring::next(Operation *operation)
+{
+	if (!isOpen())
+		return nullptr;
+
+	if (sqLocalTail - load_acquire(sqHead) >= sqEntries)
+	{
+		submit();
+
+		if (sqLocalTail - load_acquire(sqHead) >= sqEntries)
+			return nullptr;
+	}
+
+	auto index = sqLocalTail & sqMask;
+	auto *sqe = &sqes[index];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->user_data = (u64)operation;
+	sqArray[index] = index;
+
+	sqLocalTail++;
+
+	if (operation)
+	{
+		auto lock = lock_of(operationsMutex);
+		operations.insert(operation);
+	}
+
+	return sqe;
+}
+
+int Ring::submit()
+{
+	auto count = sqLocalTail - *sqTail;
+	if (count == 0)
+		return 0;
+
+	store_release(sqTail, sqLocalTail);
+
+	int result;
+	do
+	{
+		result = (int)syscall(__NR_io_uring_enter, fd, count, 0, 0, nullptr, 0);
+	}
+	while (result < 0 && errno == EINTR);
+
+	if (result < 0)
+		sLogRelease("mrudp::uring", "io_uring_enter failed " << logVar(errno));
+
+	return result;
+}
+
+void Ring::wake()
+{
+	auto lock = lock_of(submitMutex);
+
+	if (auto *sqe = next(nullptr))
+	{
+		sqe->opcode = IORING_OP_NOP;
+		submit();
+	}
+}
+
+void Ring::wait(const Optional<Timepoint> &deadline)
+{
+	if (!isOpen())
+		return;
+
+	if (!deadline)
+	{
+		syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+		return;
+	}
+
+	auto duration = *deadline - Clock::now();
+	if (duration <= Clock::duration::zero())
+		return;
+
+	auto nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+
+	__kernel_timespec timeout;
+	timeout.tv_sec = nanoseconds / 1000000000;
+	timeout.tv_nsec = nanoseconds % 1000000000;
+
+	io_uring_getevents_arg arg;
+	memset(&arg, 0, sizeof(arg));
+	arg.ts = (u64)&timeout;
+
+	syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg));
+}
+
+size_t Ring::reap()
+{
+	size_t count = 0;
+
+	while (isOpen())
+	{
+		auto head = *cqHead;
+		if (head == load_acquire(cqTail))
+			break;
+
+		// the entry is copied out so the slot can be reused while the operation completes
+		auto cqe = cqes[head & cqMask];
+		store_release(cqHead, head + 1);
+		count++;
+
+		auto *operation = (Operation *)cqe.user_data;
+		if (!operation)
+			continue;
+
+		operation->complete(cqe);
+
+		if (!(cqe.flags & IORING_CQE_F_MORE))
+		{
+			{
+				auto lock = lock_of(operationsMutex);
+				operations.erase(operation);
+			}
+
+			delete operation;
+		}
+	}
+
+	return count;
+}
+
+bool Ring::registerBuffers(io_uring_buf_ring *buffers, unsigned entries, u16 group)
+{
+	io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.ring_addr = (u64)buffers;
+	reg.ring_entries = entries;
+	reg.bgid = group;
+
+	if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0)
+	{
+		sLogRelease("mrudp::uring", "register buffer ring failed " << logVar(errno));
+		return false;
+	}
+
+	return true;
+}
+
+void Ring::unregisterBuffers(u16 group)
+{
+	io_uring_buf_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.bgid = group;
+
+	syscall(__NR_io_uring_register, fd, IORING_UNREGISTER_PBUF_RING, &reg, 1);
+}
+
+void Ring::cancel(int handle)
+{
+	io_uring_sync_cancel_reg reg;
+	memset(&reg, 0, sizeof(reg));
+	reg.fd = handle;
+	reg.flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+	reg.timeout.tv_sec = -1;
+	reg.timeout.tv_nsec = -1;
+
+	syscall(__NR_io_uring_register, fd, IORING_REGISTER_SYNC_CANCEL, &reg, 1);
+}
+
+// --------------------------
+
+ReceiveBuffers::ReceiveBuffers(Ring &ring_, u16 group_, unsigned count) :
+	ring(ring_),
+	group(group_)
+{
+	// the kernel requires a power of 2 number of entries
+	unsigned entries = 1;
+	while (entries < count)
+		entries <<= 1;
+
+	mask = entries - 1;
+
+	bufferRingSize = roundUpToPage(entries * sizeof(io_uring_buf));
+	auto memory = mmap(nullptr, bufferRingSize, PROT_READ | PROT_WRITE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+	if (memory == MAP_FAILED)
+		return;
+
+	bufferRing = (io_uring_buf_ring *)memory;
+	buffers.resize(entries);
+
+	registered = ring.registerBuffers(bufferRing, entries, group);
+
+	for (auto i=0; i<entries; ++i)
+		provide(i);
+}
+
+ReceiveBuffers::~ReceiveBuffers()
+{
+	if (registered)
+		ring.unregisterBuffers(group);
+
+	if (bufferRing)
+		munmap(bufferRing, bufferRingSize);
+}
+
+void ReceiveBuffers::provide(u16 id)
+{
+	auto tail = bufferRing->tail;
+
+	// the tail overlays the resv field of the first entry, so resv is left alone.
+	// the entries are indexed from the start of the ring, in c++ the flexible
+	// array member bufs is offset by the empty struct which declares it
+	auto &buffer = ((io_uring_buf *)bufferRing)[tail & mask];
+	buffer.addr = (u64)&buffers[id];
+	buffer.len = sizeof(ReceiveBuffer) - sizeof(Packet::dataSize);
+	buffer.bid = id;
+
+	store_release(&bufferRing->tail, u16(tail + 1));
+}
+
+// --------------------------
+
+SocketNative::SocketNative(Ring &ring_) :
+	ring(ring_)
+{
+	memset(&receiveMessage, 0, sizeof(receiveMessage));
+	receiveMessage.msg_namelen = sizeof(sockaddr_storage);
+}
+
+SocketNative::~SocketNative()
+{
+	close();
+}
+
+bool SocketNative::open(const Address &address, bool reusePort)
+{
+	// as with the asio backend, an ephemeral port is bound exclusively first, so
+	// that the port given to the reusing socket is not one already in use
+	if (reusePort && address.v4.sin_port == 0)
+	{
+		if (!open(address, false))
+			return false;
+
+		sockaddr_storage bound;
+		socklen_t size = sizeof(bound);
+		auto result = ::getsockname(handle, (sockaddr *)&bound, &size);
+
+		::close(handle);
+		handle = -1;
+
+		if (result < 0)
+			return false;
+
+		return open(toAddr((sockaddr *)&bound, size), true);
+	}
+
+	handle = ::socket(address.ip.sa_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+	if (handle < 0)
+	{
+		sLogRelease("mrudp::uring", "socket failed " << logVar(errno));
+		return false;
+	}
+
+	int enable = 1;
+	if (reusePort && ::setsockopt(handle, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0)
+	{
+		sLogRelease("mrudp::uring", "reuse port failed " << logVar(errno));
+
+		::close(handle);
+		handle = -1;
+		return false;
+	}
+
+	if (::bind(handle, &address.ip, sizeOf(address)) < 0)
+	{
+		sLogRelease("mrudp::uring", "bind failed " << logVar(errno));
+
+		::close(handle);
+		handle = -1;
+		return false;
+	}
+
+	return true;
+}
+
+void SocketNative::close()
+{
+	if (handle < 0)
+		return;
+
+	// operations hold a reference to the file, so they must be cancelled before
+	// the descriptor is closed
+	ring.cancel(handle);
+
+	::close(handle);
+	handle = -1;
+}
+
+// --------------------------
+
+SchedulerImp::SchedulerImp(Ring &ring_, const OptionsImp *options) :
+	ring(ring_)
+{
+}
+
+void SchedulerImp::update(const Timepoint &next, bool isRequired)
+{
+	bool needsWake = false;
+
+	{
+		auto lock = lock_of(mutex);
+		needsWake = !deadline || next < *deadline;
+		deadline = next;
+	}
+
+	// the runner reads the deadline before each wait, so it only needs waking
+	// when the deadline is moved earlier by another thread
+	if (needsWake && std::this_thread::get_id() != runner)
+		ring.wake();
+}
+
+void SchedulerImp::process(const Timepoint &now)
+{
+	{
+		auto lock = lock_of(mutex);
+		if (!deadline || *deadline > now)
+			return;
+
+		deadline.reset();
+	}
+
+	if (scheduler)
+		scheduler->process();
+}
+
+// --------------------------
+
+ServiceImp::ServiceImp (Service *parent_, const OptionsImp *options_) :
+	parent(weak_this(parent_)),
+	options(options_ ? *options_ : systemDefaultOptions)
+{
+	merge(options, systemDefaultOptions);
+
+	ring = strong<Ring>(options.queue_depth);
+	scheduler = strong<SchedulerImp>(*ring, options_);
+}
+
+ServiceImp::~ServiceImp ()
+{
+	stop();
+}
+
+void ServiceImp::start ()
+{
+	if (!runner.joinable())
+	{
+		stopping = false;
+		runner = Thread([this]() { run(); });
+	}
+}
+
+void ServiceImp::run ()
+{
+	scheduler->runner = std::this_thread::get_id();
+
+	while (!stopping)
+	{
+		Optional<Timepoint> deadline;
+		{
+			auto lock = lock_of(scheduler->mutex);
+			deadline = scheduler->deadline;
+		}
+
+		ring->wait(deadline);
+		ring->reap();
+
+		scheduler->process(Clock::now());
+	}
+}
+
+void ServiceImp::stop ()
+{
+	if (runner.joinable())
+	{
+		stopping = true;
+		ring->wake();
+
+		if (runner.get_id() != std::this_thread::get_id())
+		{
+			runner.join();
+		}
+		else
+		{
+			runner.detach();
+		}
+	}
+}
+
+void ServiceImp::resolve(const String &host, const String &port, Function<void(Vector<mrudp_addr_t> &&)> &&f)
+{
+	addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	std::vector<mrudp_addr_t> addresses;
+
+	addrinfo *results = nullptr;
+	if (getaddrinfo(host.c_str(), port.c_str(), &hints, &results) == 0)
+	{
+		for (auto *result = results; result; result = result->ai_next)
+			addresses.push_back(toAddr(result->ai_addr, result->ai_addrlen));
+
+		freeaddrinfo(results);
+	}
+
+	f(std::move(addresses));
+}
+
+// -------------------------------------
+
+ConnectionImp::ConnectionImp(const StrongPtr<Connection> &parent_) :
+	parent(weak(parent_))
+{
+	ALLOC_RECORD(this);
+	xLogDebug(logOfThis(this));
+}
+
+ConnectionImp::~ConnectionImp()
+{
+	DEALLOC_RECORD(this);
+
+	xLogDebug(logOfThis(this));
+	stop();
+}
+
+mrudp_error_code_t ConnectionImp::open ()
+{
+	auto parent_ = strong(parent);
+
+	if (!parent_)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	return MRUDP_OK;
+}
+
+void ConnectionImp::stop ()
+{
+	xLogDebug(logOfThis(this));
+}
+
+void ConnectionImp::relocate ()
+{
+}
+
+void ConnectionImp::onRemoteAddressChanged ()
+{
+}
+
+// -------------------------------------
+
+void SendOperation::complete(const io_uring_cqe &cqe)
+{
+	if (cqe.res < 0)
+	{
+		sLogDebug("mrudp::send", logOfThis(this) << "sendmsg failed " << logVar(cqe.res));
+	}
+}
+
+// -------------------------------------
+
+SocketImp::SocketImp(const StrongPtr<Socket> &parent_, const Address &address) :
+	parent(weak(parent_)),
+	ring(*parent_->service->imp->ring),
+	socket(strong<SocketNative>(*parent_->service->imp->ring)),
+	options(parent_->service->imp->options)
+{
+	acquireAddress(address);
+}
+
+SocketImp::~SocketImp ()
+{
+	close();
+}
+
+void SocketImp::acquireAddress(const Address &address)
+{
+	socket->open(address, options.reuse_port == 1);
+}
+
+void SocketImp::open()
+{
+	debug_assert(running == false);
+	running = true;
+
+	beginReceive(socket);
+}
+
+void SocketImp::beginReceive(const StrongPtr<SocketNative> &socket)
+{
+	if (!running || socket->handle < 0)
+		return;
+
+	if (!socket->receiveBuffers)
+	{
+		auto parent_ = strong(parent);
+		if (!parent_)
+			return;
+
+		auto group = parent_->service->imp->nextBufferGroup++;
+		socket->receiveBuffers = strong<ReceiveBuffers>(ring, group, options.receive_buffers);
+	}
+
+	if (!socket->receiveBuffers->registered)
+		return;
+
+	auto *receive = operation(
+		[this, weak_self=weak_this(this), socket](const io_uring_cqe &cqe) {
+			if (auto self = strong(weak_self))
+			{
+				onReceive(socket, cqe);
+			}
+		}
+	);
+
+	auto lock = lock_of(ring.submitMutex);
+
+	auto *sqe = ring.next(receive);
+	if (!sqe)
+	{
+		delete receive;
+		return;
+	}
+
+	sqe->opcode = IORING_OP_RECVMSG;
+	sqe->fd = socket->handle;
+	sqe->addr = (u64)&socket->receiveMessage;
+	sqe->len = 1;
+	sqe->ioprio = IORING_RECV_MULTISHOT;
+	sqe->flags = IOSQE_BUFFER_SELECT;
+	sqe->buf_group = socket->receiveBuffers->group;
+
+	ring.submit();
+}
+
+void SocketImp::onReceive(const StrongPtr<SocketNative> &socket, const io_uring_cqe &cqe)
+{
+	if (cqe.flags & IORING_CQE_F_BUFFER)
+	{
+		auto id = u16(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+		auto &buffer = socket->receiveBuffers->buffers[id];
+		auto out = buffer.out;
+
+		if (cqe.res > 0 &&
+			!(out.flags & MSG_TRUNC) &&
+			out.payloadlen >= sizeof(Header) &&
+			out.payloadlen <= sizeof(Header) + MAX_PACKET_SIZE
+		)
+		{
+			buffer.packet.dataSize = out.payloadlen - sizeof(Header);
+
+			auto remoteAddress = toAddr((sockaddr *)((char *)&buffer + offsetof(ReceiveBuffer, address)), std::min((size_t)out.namelen, sizeof(buffer.address)));
+			handleReceiveFrom(remoteAddress, buffer.packet);
+		}
+
+		socket->receiveBuffers->provide(id);
+	}
+
+	// the kernel finishes a multishot receive when it runs out of buffers, in which
+	// case it is armed again; any other error would only recur, so the receive ends
+	if (!(cqe.flags & IORING_CQE_F_MORE))
+	{
+		if (cqe.res == -ECANCELED || socket != this->socket)
+		{
+			sLogRelease("mrudp::uring", "receive ending");
+			return;
+		}
+		
+		if (cqe.res < 0 && cqe.res != -ENOBUFS)
+		{
+			sLogRelease("mrudp::uring", "receive failed " << logVar(cqe.res));
+			return;
+		}
+
+		beginReceive(socket);
+	}
+}
+
+void SocketImp::handleReceiveFrom(const Address &remoteAddress, Packet &receivePacket)
+{
+	if (auto parent = strong(this->parent))
+	{
+		parent->receive(receivePacket, remoteAddress);
+	}
+}
+
+bool SocketImp::prepareSend(const PacketPtr &packet, const Address &address)
+{
+	auto *send = new SendOperation();
+	send->packet = packet;
+	send->address = address;
+
+	send->buffer.iov_base = ptr_of(packet);
+	send->buffer.iov_len = packet->dataSize + sizeof(Header);
+
+	memset(&send->message, 0, sizeof(send->message));
+	send->message.msg_name = &send->address.ip;
+	send->message.msg_namelen = sizeOf(send->address);
+	send->message.msg_iov = &send->buffer;
+	send->message.msg_iovlen = 1;
+
+	auto *sqe = ring.next(send);
+	if (!sqe)
+	{
+		delete send;
+		return false;
+	}
+
+	sqe->opcode = IORING_OP_SENDMSG;
+	sqe->fd = socket->handle;
+	sqe->addr = (u64)&send->message;
+	sqe->len = 1;
+
+	return true;
+}
+
+mrudp_error_code_t SocketImp::send(const PacketPtr &packet, Connection *connection, const Address *address_)
+{
+	if (socket->handle < 0)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	auto *address = address_ ? address_ : &connection->remoteAddress;
+
+	auto lock = lock_of(ring.submitMutex);
+	if (!prepareSend(packet, *address))
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	ring.submit();
+
+	return MRUDP_OK;
+}
+
+mrudp_error_code_t SocketImp::send(PacketRun &run, Connection *connection)
+{
+	if (socket->handle < 0)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	// the run goes to the kernel with a single io_uring_enter
+	auto lock = lock_of(ring.submitMutex);
+	for (auto &packet: run)
+	{
+		if (!prepareSend(packet, connection->remoteAddress))
+			break;
+	}
+
+	ring.submit();
+
+	return MRUDP_OK;
+}
+
+void SocketImp::close ()
+{
+	if (running)
+	{
+		running = false;
+		socket->close();
+	}
+}
+
+void SocketImp::relocate(const Address &address)
+{
+	auto parent_ = strong(parent);
+
+	auto lock = lock_of(parent_->connectionsMutex);
+
+	close();
+	socket = strong<SocketNative>(ring);
+	acquireAddress(address);
+	open();
+
+	for (auto &[id, connection] : parent_->connections)
+	{
+		connection->imp->relocate();
+	}
+}
+
+mrudp_addr_t SocketImp::getLocalAddress ()
+{
+	sockaddr_storage address;
+	socklen_t size = sizeof(address);
+
+	if (::getsockname(socket->handle, (sockaddr *)&address, &size) < 0)
+		size = 0;
+
+	return toAddr((sockaddr *)&address, size);
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,297 @@
+#pragma once
+
+#include "../Connection.h"
+#include "../Socket.h"
+#include "../Service.h"
+#include "../Scheduler.h"
+
+#include "../Base.h"
+
+#include <linux/io_uring.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+namespace timprepscius {
+namespace mrudp {
+namespace imp {
+
+// --------------------------
+
+const mrudp_imp_selector SELECTOR = MRUDP_IMP_URING;
+
+mrudp_addr_t toAddr(const sockaddr *address, size_t size);
+
+typedef mrudp_options_uring_t OptionsImp;
+void merge(OptionsImp &lhs, const OptionsImp &rhs);
+
+OptionsImp getDefaultOptions();
+
+// the options for the index-th shard of a sharded listener
+OptionsImp getShardOptions(const OptionsImp *options, int index);
+
+// --------------------------------------------------------------------------------
+// Operation
+//
+// An Operation is the user_data of a submission.  It is completed once per
+// completion queue entry, and deleted by the Ring after the last one (multishot
+// operations set IORING_CQE_F_MORE until they are finished).
+// --------------------------------------------------------------------------------
+
+struct Operation
+{
+	virtual ~Operation() {}
+	virtual void complete(const io_uring_cqe &cqe) = 0;
+} ;
+
+template<typename F>
+struct OperationOf : Operation
+{
+	F f;
+
+	OperationOf(F &&f_) :
+		f(std::move(f_))
+	{
+	}
+
+	void complete(const io_uring_cqe &cqe) override
+	{
+		f(cqe);
+	}
+} ;
+
+template<typename F>
+Operation *operation(F &&f)
+{
+	return new OperationOf<F>(std::move(f));
+}
+
+// --------------------------------------------------------------------------------
+// Ring
+//
+// Ring is a thin layer over the io_uring system calls, it maps the submission and
+// completion queues.
+//
+// Any thread may submit, submissions are serialized by submitMutex.  Completions
+// are reaped only by the runner thread of the service.
+//
+// Operations which are still outstanding when the ring is closed are deleted
+// without being completed.
+// --------------------------------------------------------------------------------
+
+struct Ring
+{
+	Ring(unsigned entries);
+	~Ring();
+
+	int fd = -1;
+
+	void *sqMemory = nullptr;
+	size_t sqMemorySize = 0;
+	void *cqMemory = nullptr;
+	size_t cqMemorySize = 0;
+	io_uring_sqe *sqes = nullptr;
+	size_t sqesSize = 0;
+
+	unsigned *sqHead, *sqTail, sqMask, sqEntries, *sqArray;
+	unsigned sqLocalTail = 0;
+	unsigned *cqHead, *cqTail, cqMask;
+	io_uring_cqe *cqes;
+
+	Mutex submitMutex;
+
+	Mutex operationsMutex;
+	Set<Operation *> operations;
+
+	bool isOpen();
+	void close();
+
+	// returns the next submission entry, cleared, with its user_data set to the
+	// operation, which the ring then owns.  Returns nullptr if the queue is full,
+	// in which case the caller still owns the operation.
+	// The submitMutex must be held.
+	io_uring_sqe *next(Operation *operation);
+
+	// submits the entries returned by next, the submitMutex must be held
+	int submit();
+
+	// wakes the runner thread from wait
+	void wake();
+
+	// waits for at least one completion, or until the deadline
+	void wait(const Optional<Timepoint> &deadline);
+
+	// completes the operations of the available completion entries
+	size_t reap();
+
+	// registers and unregisters a provided buffer ring
+	bool registerBuffers(io_uring_buf_ring *buffers, unsigned entries, u16 group);
+	void unregisterBuffers(u16 group);
+
+	// cancels, and waits for the cancellation of, every operation on the file descriptor
+	void cancel(int handle);
+} ;
+
+// --------------------------------------------------------------------------------
+// ReceiveBuffers
+//
+// The buffers a socket provides to the kernel for its multishot receive.
+//
+// A multishot recvmsg writes an io_uring_recvmsg_out, then the source address, then
+// the payload into the buffer it picks.  The buffer is laid out so that the payload
+// lands on the Packet, which is then handed to Socket::receive in place.  The
+// length given to the kernel stops before Packet::dataSize.
+// --------------------------------------------------------------------------------
+
+PACK(
+	struct ReceiveBuffer
+	{
+		io_uring_recvmsg_out out;
+		sockaddr_storage address;
+		Packet packet;
+	}
+);
+
+struct ReceiveBuffers
+{
+	ReceiveBuffers(Ring &ring, u16 group, unsigned count);
+	~ReceiveBuffers();
+
+	Ring &ring;
+	u16 group;
+	bool registered = false;
+
+	io_uring_buf_ring *bufferRing = nullptr;
+	size_t bufferRingSize = 0;
+	unsigned mask;
+
+	Vector<ReceiveBuffer> buffers;
+
+	// hands the buffer back to the kernel, only called by the runner thread
+	void provide(u16 id);
+} ;
+
+// ------------
+
+struct SocketNative
+{
+	SocketNative(Ring &ring);
+	~SocketNative();
+
+	Ring &ring;
+	int handle = -1;
+
+	StrongPtr<ReceiveBuffers> receiveBuffers;
+
+	// multishot recvmsg only reads msg_namelen and msg_controllen, it must stay
+	// valid while the receive is armed
+	msghdr receiveMessage;
+
+	bool open(const Address &address, bool reusePort);
+	void close();
+} ;
+
+// ------------
+
+struct SchedulerImp
+{
+	SchedulerImp(Ring &ring, const OptionsImp *options);
+
+	Ring &ring;
+	Scheduler *scheduler = nullptr;
+
+	Mutex mutex;
+	Optional<Timepoint> deadline;
+	std::thread::id runner;
+
+	void update(const Timepoint &when, bool isRequired);
+
+	// processes the scheduler if the deadline has passed, called by the runner thread
+	void process(const Timepoint &now);
+} ;
+
+// ---------
+
+struct ServiceImp : StrongThis<ServiceImp>
+{
+	OptionsImp options;
+
+	WeakPtr<Service> parent;
+	Thread runner;
+	Atomic<bool> stopping = false;
+
+	Atomic<u16> nextBufferGroup = 0;
+
+	StrongPtr<Ring> ring;
+	StrongPtr<SchedulerImp> scheduler;
+
+	ServiceImp (Service *parent_, const OptionsImp *options);
+	~ServiceImp ();
+
+	void start ();
+	void stop ();
+
+	void run ();
+
+	void resolve(const String &host, const String &port, Function<void(Vector<mrudp_addr_t> &&)> &&f);
+} ;
+
+struct ConnectionImp : StrongThis<ConnectionImp>
+{
+	WeakPtr<Connection> parent;
+
+	ConnectionImp(const StrongPtr<Connection> &parent_);
+	~ConnectionImp();
+
+	mrudp_error_code_t open ();
+	void stop ();
+
+	void onRemoteAddressChanged();
+	void relocate ();
+} ;
+
+struct SendOperation : Operation
+{
+	PacketPtr packet;
+	Address address;
+	iovec buffer;
+	msghdr message;
+
+	void complete(const io_uring_cqe &cqe) override;
+} ;
+
+struct SocketImp : StrongThis<SocketImp>
+{
+	OptionsImp options;
+
+	WeakPtr<Socket> parent;
+
+	StrongPtr<SocketNative> socket;
+	Ring &ring;
+
+	bool running = false;
+	void beginReceive(const StrongPtr<SocketNative> &);
+	void onReceive(const StrongPtr<SocketNative> &, const io_uring_cqe &cqe);
+
+	SocketImp(const StrongPtr<Socket> &parent, const Address &address);
+	~SocketImp ();
+
+	void acquireAddress(const Address &address);
+
+	void open();
+	void handleReceiveFrom(const Address &remoteAddress, Packet &receivePacket);
+
+	// prepares a sendmsg, the ring's submitMutex must be held
+	bool prepareSend(const PacketPtr &packet, const Address &address);
+	mrudp_error_code_t send(const PacketPtr &packet, Connection *connection, const Address *addr);
+	mrudp_error_code_t send(PacketRun &run, Connection *connection);
+	void close ();
+
+	void relocate(const Address &address);
+
+	mrudp_addr_t getLocalAddress ();
+} ;
+
+} // namespace
+} // namespace
+} // namespace
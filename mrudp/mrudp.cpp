@@ -3,8 +3,11 @@
 #include "Socket.h"
 #include "Connection.h"
 #include "Implementation.h"
+#include "Shards.h"
+#include "Buffer.h"
 
 #include <iostream>
+#include <sstream>
 
 using namespace timprepscius;
 using namespace mrudp;
@@ -25,13 +28,33 @@ mrudp_connection_options_t mrudp_default_connection_options()
 		},
 		
 		.probe_delay_ms = -1,
-		.maximum_retry_attempts = -1
+		.maximum_retry_attempts = -1,
+		.congestion_control = -1,
+		.packet_numbers = -1,
+		
+		.fec = {
+			.mode = -1,
+			.data_packets = -1,
+			.parity_packets = -1,
+			.delay_ms = -1
+		},
+		
+		.ack = {
+			.packets = -1,
+			.delay_ms = -1
+		},
+		
+		.receive_window = -1,
+		.send_buffer = -1
 	} ;
 }
 
 mrudp_error_code_t mrudp_default_options (mrudp_imp_selector imp, void *options_)
 {
 	// TODO: size checks
+	if (imp != imp::SELECTOR)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
 	auto options = imp::getDefaultOptions();
 	memcpy(options_, &options, sizeof(options));
 	return MRUDP_OK;
@@ -167,6 +190,43 @@ mrudp_error_code_t mrudp_connection_state (mrudp_connection_t connection_, mrudp
 	return MRUDP_OK;
 }
 
+mrudp_error_code_t mrudp_packet_pool_statistics (mrudp_packet_pool_statistics_t *statistics)
+{
+	*statistics = getPacketPoolStatistics();
+	return MRUDP_OK;
+}
+
+mrudp_buffer_t mrudp_buffer_retain(const char *data, int size)
+{
+	if (size < 0)
+		return nullptr;
+		
+	return newHandle(Buffer::retain(data, size));
+}
+
+const char *mrudp_buffer_data(mrudp_buffer_t buffer_)
+{
+	auto buffer = toNative(buffer_);
+	if (!buffer)
+		return nullptr;
+		
+	return buffer->data;
+}
+
+int mrudp_buffer_size(mrudp_buffer_t buffer_)
+{
+	auto buffer = toNative(buffer_);
+	if (!buffer)
+		return 0;
+		
+	return (int)buffer->size;
+}
+
+void mrudp_buffer_release(mrudp_buffer_t buffer_)
+{
+	deleteHandle(buffer_);
+}
+
 mrudp_error_code_t mrudp_connection_options (mrudp_connection_t connection_, mrudp_connection_options_t *options)
 {
 	auto connection = toNative(connection_);
@@ -189,6 +249,18 @@ mrudp_error_code_t mrudp_connection_options_set (mrudp_connection_t connection_,
 	return MRUDP_OK;
 }
 
+mrudp_error_code_t mrudp_connection_ack_frequency (mrudp_connection_t connection_, const mrudp_ack_options_t *ack)
+{
+	auto connection = toNative(connection_);
+	if (!connection)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	connection->options.ack = *ack;
+	connection->sender.requestAckFrequency(*ack);
+	
+	return MRUDP_OK;
+}
+
 mrudp_error_code_t mrudp_relocate_socket(mrudp_socket_t socket_, const mrudp_addr_t *address)
 {
 	auto socket = toNative(socket_);
@@ -339,12 +411,114 @@ mrudp_error_code_t mrudp_send(mrudp_connection_t connection_, const char *buffer
 
 	xLogDebug(logVar(connection));
 
-	return connection->send(buffer, size, reliable == 0 ? UNRELIABLE : RELIABLE);
+	return connection->send(buffer, size, toReliability(reliable));
+}
+
+mrudp_error_code_t mrudp_send_ex(mrudp_connection_t connection_, const char *buffer, int size, int reliable, int deadline_ms)
+{
+	auto connection = toNative(connection_);
+	if (!connection || deadline_ms < 0)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	xLogDebug(logVar(connection) << logVar(deadline_ms));
+
+	Optional<Timepoint> deadline;
+	if (deadline_ms > 0)
+		deadline = connection->socket->service->clock.now() + Duration(deadline_ms);
+
+	return connection->send(buffer, size, toReliability(reliable), 0, deadline);
+}
+
+mrudp_error_code_t mrudp_sendv(mrudp_connection_t connection_, const mrudp_iovec_t *segments, int count, int reliable)
+{
+	auto connection = toNative(connection_);
+	if (!connection || count < 0)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	xLogDebug(logVar(connection));
+
+	return connection->send(segments, count, toReliability(reliable));
+}
+
+mrudp_error_code_t mrudp_send_stream(mrudp_connection_t connection_, int stream, const char *buffer, int size)
+{
+	auto connection = toNative(connection_);
+	if (!connection || stream < 0 || stream >= MAX_STREAMS)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	xLogDebug(logVar(connection) << logVar(stream));
+
+	return connection->send(buffer, size, RELIABLE, StreamID(stream));
+}
+
+mrudp_error_code_t mrudp_connection_stream_weight(mrudp_connection_t connection_, int stream, int weight)
+{
+	auto connection = toNative(connection_);
+	if (!connection || stream < 0 || stream >= MAX_STREAMS || weight < 1 || weight > 255)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	connection->sender.setWeight(StreamID(stream), u8(weight));
+	
+	return MRUDP_OK;
+}
+
+mrudp_error_code_t mrudp_connection_receive_stream(mrudp_connection_t connection_, mrudp_receive_stream_callback &&receiveHandler)
+{
+	auto connection = toNative(connection_);
+	if (!connection)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	connection->receiveStreamHandler = std::move(receiveHandler);
+	
+	return MRUDP_OK;
+}
+
+mrudp_error_code_t mrudp_connection_receive_stream(mrudp_connection_t connection_, mrudp_receive_stream_callback_fn receiveHandler)
+{
+	return mrudp_connection_receive_stream(connection_, mrudp_receive_stream_callback(receiveHandler));
+}
+
+mrudp_error_code_t mrudp_connection_writable(mrudp_connection_t connection_, mrudp_writable_callback &&writableHandler)
+{
+	auto connection = toNative(connection_);
+	if (!connection)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	connection->writableHandler = std::move(writableHandler);
+	
+	return MRUDP_OK;
+}
+
+mrudp_error_code_t mrudp_connection_writable(mrudp_connection_t connection_, mrudp_writable_callback_fn writableHandler)
+{
+	return mrudp_connection_writable(connection_, mrudp_writable_callback(writableHandler));
+}
+
+mrudp_error_code_t mrudp_connection_pause_receive(mrudp_connection_t connection_)
+{
+	auto connection = toNative(connection_);
+	if (!connection)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	connection->receiver.pause();
+	
+	return MRUDP_OK;
+}
+
+mrudp_error_code_t mrudp_connection_resume_receive(mrudp_connection_t connection_)
+{
+	auto connection = toNative(connection_);
+	if (!connection)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+
+	connection->receiver.resume();
+	
+	return MRUDP_OK;
 }
 
 mrudp_service_t mrudp_service()
 {
-	return mrudp_service_ex(MRUDP_IMP_ASIO, nullptr);
+	return mrudp_service_ex(imp::SELECTOR, nullptr);
 }
 
 mrudp_service_t mrudp_service_ex(mrudp_imp_selector imp, void *options)
@@ -381,6 +555,73 @@ void mrudp_close_service(mrudp_service_t service_, int waitForFinish)
 	}
 }
 
+mrudp_shards_t mrudp_shards(const mrudp_addr_t *address, int quantity)
+{
+	return mrudp_shards_ex(imp::SELECTOR, nullptr, address, quantity);
+}
+
+mrudp_shards_t mrudp_shards_ex(mrudp_imp_selector imp, void *options, const mrudp_addr_t *address, int quantity)
+{
+	auto shards = new Shards();
+	if (!shards->open(imp, options, *address, quantity))
+	{
+		delete shards;
+		return nullptr;
+	}
+	
+	return newHandle(shards);
+}
+
+int mrudp_shards_quantity(mrudp_shards_t shards_)
+{
+	auto shards = toNative(shards_);
+	if (!shards)
+		return 0;
+		
+	return (int)shards->sockets.size();
+}
+
+mrudp_socket_t mrudp_shards_socket(mrudp_shards_t shards_, int index)
+{
+	auto shards = toNative(shards_);
+	if (!shards || index < 0 || index >= (int)shards->sockets.size())
+		return nullptr;
+		
+	return shards->sockets[index];
+}
+
+mrudp_error_code_t mrudp_shards_listen(
+	mrudp_shards_t shards_,
+	void *userData,
+	mrudp_should_accept_callback_fn shouldAcceptCallback,
+	mrudp_accept_callback_fn acceptCallback,
+	mrudp_close_callback_fn closeCallback
+)
+{
+	auto shards = toNative(shards_);
+	if (!shards)
+		return MRUDP_ERROR_GENERAL_FAILURE;
+		
+	for (auto socket : shards->sockets)
+	{
+		auto result = mrudp_listen(socket, userData, shouldAcceptCallback, acceptCallback, closeCallback);
+		if (mrudp_failed(result))
+			return result;
+	}
+	
+	return MRUDP_OK;
+}
+
+void mrudp_close_shards(mrudp_shards_t shards_, int waitForFinish)
+{
+	auto shards = toNative(shards_);
+	if (!shards)
+		return;
+		
+	shards->close(waitForFinish);
+	deleteHandle(shards_);
+}
+
 mrudp_error_code_t mrudp_resolve(mrudp_service_t service_, const char *address, mrudp_resolve_callback_fn callback, void *userData)
 {
 	return mrudp_resolve(service_, address, mrudp_resolve_callback(callback), userData);
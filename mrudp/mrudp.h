@@ -6,6 +6,7 @@
 	#include <Ws2ipdef.h>
 #else
 	#include <netinet/in.h>
+	#include <sys/uio.h>
 #endif
 
 #include <stdint.h>
@@ -17,11 +18,27 @@ extern "C" {
 // The maximum data payload size can be sent.
 // 1500 - sizeof(Header) - sizeof(crypto) - sizeof(FrameOverhead) - sizeo(cryptoOverhead) - sanity = 1400
 #define MRUDP_MAX_PACKET_SIZE 1400
+
+// The number of reliable streams of a connection, each delivers its messages in
+// order without waiting on the others
+#define MRUDP_MAX_STREAMS 16
+
+// The reliability data is sent with, and given to the receive callbacks as
+// is_reliable.  Reliable unordered data is resent until it arrives as reliable
+// data is, but is delivered as it arrives rather than in the order sent.
+#define MRUDP_UNRELIABLE 0
+#define MRUDP_RELIABLE 1
+#define MRUDP_RELIABLE_UNORDERED 2
+
 #define MRUDP_OK 0
 #define MRUDP_ERROR_GENERAL_FAILURE 1
 #define MRUDP_ERROR_PACKET_SIZE_TOO_LARGE 2
 #define MRUDP_ERROR_CONNECTION_CLOSED 3
 
+// the send buffer of the connection or of its service is full, the send may be
+// tried again once the writable call-back is invoked
+#define MRUDP_ERROR_WOULD_BLOCK 4
+
 // this is for tests
 #define MRUDP_MAXIMUM_CONNECTION_TIMEOUT 30
 
@@ -51,6 +68,24 @@ typedef mrudp_socket_t_ *mrudp_socket_t;
 typedef struct { int silence_warnings; } mrudp_connection_t_;
 typedef mrudp_connection_t_ *mrudp_connection_t;
 
+// An anonymous structure for the sharded listener handle
+typedef struct { int silence_warnings; } mrudp_shards_t_;
+typedef mrudp_shards_t_ *mrudp_shards_t;
+
+// An anonymous structure for a retained receive buffer
+typedef struct { int silence_warnings; } mrudp_buffer_t_;
+typedef mrudp_buffer_t_ *mrudp_buffer_t;
+
+// A buffer of a message given in segments
+#if _WIN32
+typedef struct {
+	void *iov_base;
+	size_t iov_len;
+} mrudp_iovec_t;
+#else
+typedef struct iovec mrudp_iovec_t;
+#endif
+
 // The address structure
 typedef union {
     struct sockaddr ip;
@@ -71,11 +106,74 @@ typedef struct {
 	int8_t compression_level;
 } mrudp_coalesce_options_t;
 
+typedef enum {
+	MRUDP_CONGESTION_SIMPLE,
+	MRUDP_CONGESTION_NEWRENO,
+	MRUDP_CONGESTION_CUBIC,
+	MRUDP_CONGESTION_BBR
+} mrudp_congestion_control_t;
+
+typedef enum {
+	MRUDP_PACKET_NUMBERS_16,
+	MRUDP_PACKET_NUMBERS_32
+} mrudp_packet_numbers_t;
+
+typedef enum {
+	MRUDP_FEC_NONE,
+	MRUDP_FEC_XOR,
+	MRUDP_FEC_REED_SOLOMON
+} mrudp_fec_mode_t;
+
+typedef struct {
+	// the mrudp_fec_mode_t, the data and parity packets of a group, and how long
+	// a group which has not filled waits before its parity is sent
+	int8_t mode;
+	int8_t data_packets;
+	int8_t parity_packets;
+	int32_t delay_ms;
+} mrudp_fec_options_t;
+
+typedef struct {
+	// the reliable packets received before they are acked, and the longest the
+	// first of them waits, a packet arriving out of order is acked at once
+	int16_t packets;
+	int32_t delay_ms;
+} mrudp_ack_options_t;
+
 typedef struct {
 	mrudp_coalesce_options_t coalesce_reliable;
 	mrudp_coalesce_options_t coalesce_unreliable;
 	int32_t probe_delay_ms;
 	int16_t maximum_retry_attempts;
+	
+	// the mrudp_congestion_control_t which sizes the window of unacked reliable
+	// packets, it is local to the sender and may differ on each end
+	int8_t congestion_control;
+	
+	// the mrudp_packet_numbers_t of the connection, the narrower of the two ends
+	// is used; with 32 bit numbers the window of unacked reliable packets may grow
+	// to 16384 rather than 1024
+	int8_t packet_numbers;
+	
+	// forward error correction of the data packets, the lesser mode, the larger
+	// group and the fewer parity packets of the two ends are used, the delay is
+	// local to the sender
+	mrudp_fec_options_t fec;
+	
+	// how often the remote acks the reliable packets this end sends, it is sent to
+	// the remote in the handshake and by mrudp_connection_ack_frequency; the delay
+	// is at most 20ms
+	mrudp_ack_options_t ack;
+	
+	// the packets of reliable data this end holds, arrived out of order or while
+	// receiving is paused, before the remote waits for it to take them; the room
+	// left is sent to the remote in each ack
+	int16_t receive_window;
+	
+	// the bytes waiting to be sent before a send is refused with
+	// MRUDP_ERROR_WOULD_BLOCK, 0 for no limit, which is the default; the writable
+	// call-back is invoked once they have drained below half of it
+	int32_t send_buffer;
 } mrudp_connection_options_t;
 
 typedef struct {
@@ -84,8 +182,65 @@ typedef struct {
 	int8_t overlapped_io;
 	int8_t send_via_queue;
 	int8_t thread_quantity;
+	
+	// the maximum number of datagrams moved per system call, when greater than 1
+	// linux will use recvmmsg and sendmmsg (sendmmsg requires send_via_queue)
+	int16_t batch_size;
+	
+	// when 1, linux hands each run of reliable packets to the kernel as a single
+	// UDP_SEGMENT datagram, falling back to one datagram per packet if the socket
+	// or the path does not support segmentation offload
+	int8_t segmentation_offload;
+	
+	// when 1, linux enables UDP_GRO on the sockets, the kernel may then hand back
+	// many datagrams from one sender with a single recvmsg, which are split into
+	// packets in place (takes precedence over batch_size for receiving)
+	int8_t receive_offload;
+	
+	// when 1, sockets are bound with SO_REUSEPORT, so that the sockets of several
+	// services may share one address (see mrudp_shards)
+	int8_t reuse_port;
+	
+	// the number of receives kept outstanding on each socket, with thread_quantity
+	// greater than 1 that many threads may receive from one socket at once
+	int16_t receive_depth;
+	
+	// when 1, the runner threads never sleep: each spins polling the sockets
+	// without blocking, and runs the timeouts which are due itself, trading cpu
+	// for the latency of waking a thread when a packet arrives
+	int8_t busy_poll;
+	
+	// linux, when greater than 0, the sockets are given SO_BUSY_POLL with this
+	// many microseconds, so the kernel polls the device queue on receive
+	int32_t busy_poll_us;
+	
+	// when not 0, a mask of the cpus the runner threads are pinned to, runner i
+	// goes to the i-th cpu of the mask (wrapping); -1 leaves the option unset
+	int64_t cpu_affinity;
+	
+	// the bytes waiting to be sent on all the connections of the service before a
+	// send is refused with MRUDP_ERROR_WOULD_BLOCK, 0 for no limit
+	int64_t send_buffer;
 } mrudp_options_asio_t;
 
+typedef struct {
+	mrudp_connection_options_t connection;
+	
+	// the number of submission queue entries of the io_uring
+	int32_t queue_depth;
+	
+	// the number of packet sized buffers each socket provides to the kernel
+	// for its multishot receive
+	int32_t receive_buffers;
+	
+	// when 1, sockets are bound with SO_REUSEPORT (see mrudp_shards)
+	int8_t reuse_port;
+	
+	// the bytes waiting to be sent on all the connections of the service before a
+	// send is refused with MRUDP_ERROR_WOULD_BLOCK, 0 for no limit
+	int64_t send_buffer;
+} mrudp_options_uring_t;
+
 typedef struct {
 	uint32_t sent, received;
 } mrudp_data_send_receive_t;
@@ -104,15 +259,59 @@ typedef struct {
 	mrudp_data_statistics_t reliable, unreliable;
 	
 	uint32_t acks_sent;
+	
+	// the acks carried by reliable data packets, rather than sent on their own
+	// (these are not counted in acks_sent)
+	uint32_t acks_piggybacked;
 	uint32_t packets_resent;
+	
+	// the packets resent because later packets were acked, before their retry
+	// timeout (these are also counted in packets_resent)
+	uint32_t packets_fast_resent;
+	
+	// the packets resent as tail loss probes, when no ack had arrived for a time
+	// after the last send (these are also counted in packets_resent)
+	uint32_t packets_probed;
+	
+	// the data packets rebuilt from parity packets, see mrudp_fec_options_t
+	uint32_t packets_recovered;
+	
+	// the data packets dropped rather than sent or resent, as their deadline had
+	// passed, see mrudp_send_ex
+	uint32_t packets_expired;
+	
+	// the smoothed rtt, its variation, the lowest rtt sampled, and the retry
+	// timeout of a packet before any backoff, in microseconds.  The lowest rtt
+	// is 0 until the first sample
+	uint32_t rtt_smoothed_us;
+	uint32_t rtt_variance_us;
+	uint32_t rtt_minimum_us;
+	uint32_t retry_timeout_us;
 } mrudp_connection_statistics_t;
 
 typedef struct {
 	uint32_t packets_awaiting_ack;
 } mrudp_connection_state_t;
 
+// statistics for the packet pools, which are kept per thread
+typedef struct {
+	// packets taken from the heap, and returned to it
+	uint64_t allocated;
+	uint64_t freed;
+	
+	// packets taken from a pool, and returned to one
+	uint64_t reused;
+	uint64_t recycled;
+	
+	// packets currently held by the pools
+	uint64_t pooled;
+} mrudp_packet_pool_statistics_t;
+
 #define MRUDP_IMP_ASIO 0x01
 
+// linux only, available when the library is built with USE_URING
+#define MRUDP_IMP_URING 0x02
+
 typedef int mrudp_imp_selector;
 
 // Call-back for when a handle is about to be closed
@@ -127,9 +326,16 @@ typedef mrudp_error_code_t (*mrudp_should_accept_callback_fn)(void *, const mrud
 // Call-back for when data has been received
 typedef mrudp_error_code_t (*mrudp_receive_callback_fn)(void *, char *data, int size, int is_reliable);
 
+// Call-back for when data has been received, with the stream it was sent on
+// (unreliable data is given stream 0)
+typedef mrudp_error_code_t (*mrudp_receive_stream_callback_fn)(void *, int stream, char *data, int size, int is_reliable);
+
 // Call-back for when an address has been resolved
 typedef mrudp_error_code_t (*mrudp_resolve_callback_fn)(void *, const mrudp_addr_t *addresses, size_t numAddresses);
 
+// Call-back for when a connection which refused a send may be sent on again
+typedef mrudp_error_code_t (*mrudp_writable_callback_fn)(void *);
+
 // converts an ip+port string into an address
 mrudp_error_code_t mrudp_str_to_addr(const char *str, mrudp_addr_t *addr);
 
@@ -194,6 +400,32 @@ mrudp_error_code_t mrudp_accept_ex(
 	mrudp_close_callback_fn
 );
 
+// creates a listener sharded over the given quantity of services (0 is one per core),
+// each with its own thread and connections, and a socket bound to the address with
+// SO_REUSEPORT.  linux keeps each remote address on one shard.  Returns null if
+// the sockets could not be bound.
+mrudp_shards_t mrudp_shards(const mrudp_addr_t *address, int quantity);
+mrudp_shards_t mrudp_shards_ex(mrudp_imp_selector imp, void *options, const mrudp_addr_t *address, int quantity);
+
+// gets the quantity of shards
+int mrudp_shards_quantity(mrudp_shards_t shards);
+
+// gets the socket of a shard, the socket is owned by the shards and must not be closed
+mrudp_socket_t mrudp_shards_socket(mrudp_shards_t shards, int index);
+
+// enables listening on every shard, the call-backs are invoked on the thread
+// of the shard, and the close call-back is invoked once for each shard
+mrudp_error_code_t mrudp_shards_listen(
+	mrudp_shards_t shards,
+	void *userData,
+	mrudp_should_accept_callback_fn,
+	mrudp_accept_callback_fn,
+	mrudp_close_callback_fn
+) ;
+
+// closes the sockets and services of the shards, after closing the handle is invalid
+void mrudp_close_shards(mrudp_shards_t shards, int waitForFinish);
+
 // gets the local address of the given socket
 mrudp_error_code_t mrudp_socket_addr(mrudp_socket_t socket, mrudp_addr_t *);
 
@@ -228,19 +460,81 @@ mrudp_error_code_t mrudp_close_connection(mrudp_connection_t connection);
 // closes the native handle for the socket of the given connection immediately
 mrudp_error_code_t mrudp_close_connection_socket_native(mrudp_connection_t socket);
 
-// sends data on the given connection
+// sends data on the given connection, reliable is one of MRUDP_UNRELIABLE,
+// MRUDP_RELIABLE or MRUDP_RELIABLE_UNORDERED.  Reliable unordered data is not
+// coalesced across packets, so a message must be at most MRUDP_MAX_PACKET_SIZE.
+// While the send_buffer of the connection or of the service is full, the sends
+// return MRUDP_ERROR_WOULD_BLOCK and the data is not sent.
 mrudp_error_code_t mrudp_send (mrudp_connection_t connection, const char *, int size, int reliable);
 
+// sends data which is dropped if it has not been sent, or for reliable data has
+// not been acked, within deadline_ms (0 for no deadline).  A message with a
+// deadline is sent in a packet of its own, so must be at most MRUDP_MAX_PACKET_SIZE.
+// The remote skips the reliable messages which were dropped and delivers those
+// after them.
+mrudp_error_code_t mrudp_send_ex (mrudp_connection_t connection, const char *, int size, int reliable, int deadline_ms);
+
+// sends the data of count segments as one message, the segments are copied
+// directly into packets without first being joined
+mrudp_error_code_t mrudp_sendv (mrudp_connection_t connection, const mrudp_iovec_t *segments, int count, int reliable);
+
+// sends data reliably on the given stream (0 to MRUDP_MAX_STREAMS-1), the messages of
+// a stream arrive in order, a loss on one stream does not hold back the others.
+// mrudp_send sends reliable data on stream 0.
+mrudp_error_code_t mrudp_send_stream (mrudp_connection_t connection, int stream, const char *, int size);
+
+// sets the weight (1 to 255) by which a stream shares the send window with the
+// other streams which have data waiting, streams have a weight of 1 at first
+mrudp_error_code_t mrudp_connection_stream_weight (mrudp_connection_t connection, int stream, int weight);
+
+// sets a receive call-back which is given the stream of the data, it is used
+// instead of the receive call-back of the connection.  It should be set before
+// data arrives, in the accept call-back or directly after connecting.
+mrudp_error_code_t mrudp_connection_receive_stream (mrudp_connection_t connection, mrudp_receive_stream_callback_fn);
+
+// sets a call-back which is invoked, with the user data of the connection, once
+// after a send has returned MRUDP_ERROR_WOULD_BLOCK and the data waiting has
+// drained below half of the send_buffer of the connection and of the service
+mrudp_error_code_t mrudp_connection_writable (mrudp_connection_t connection, mrudp_writable_callback_fn);
+
+// pauses the delivery of data to the receive call-backs, the reliable data which
+// arrives is held until resumed and the remote waits once the receive_window is
+// full; unreliable data which arrives while paused is dropped.  A call-back which
+// is under way when paused may still complete.
+mrudp_error_code_t mrudp_connection_pause_receive (mrudp_connection_t connection);
+
+// resumes the delivery of data, the data held is delivered first
+mrudp_error_code_t mrudp_connection_resume_receive (mrudp_connection_t connection);
+
 // gets the statistics for the connect connection
 mrudp_error_code_t mrudp_connection_statistics(mrudp_connection_t connection, mrudp_connection_statistics_t *statistics);
 
 // gets the statistics for the connect connection
 mrudp_error_code_t mrudp_connection_state(mrudp_connection_t connection, mrudp_connection_state_t *statistics);
 
+// gets the statistics of the packet pools of all threads
+mrudp_error_code_t mrudp_packet_pool_statistics(mrudp_packet_pool_statistics_t *statistics);
+
+// keeps the data given to a receive callback past the callback; may only be called
+// from within the callback.  The received packet is held rather than the data
+// being copied, unless the data does not lie within it.
+mrudp_buffer_t mrudp_buffer_retain(const char *data, int size);
+
+// the retained data, valid until the buffer is released
+const char *mrudp_buffer_data(mrudp_buffer_t buffer);
+int mrudp_buffer_size(mrudp_buffer_t buffer);
+
+// releases a retained buffer, after releasing the handle is invalid
+void mrudp_buffer_release(mrudp_buffer_t buffer);
+
 // gets and sets the options for a connection
 mrudp_error_code_t mrudp_connection_options(mrudp_connection_t connection, mrudp_connection_options_t *options);
 mrudp_error_code_t mrudp_connection_options_set(mrudp_connection_t connection, mrudp_connection_options_t *options);
 
+// asks the remote to ack the reliable packets of this end as given, the request is
+// sent reliably, so takes effect once it arrives
+mrudp_error_code_t mrudp_connection_ack_frequency(mrudp_connection_t connection, const mrudp_ack_options_t *ack);
+
 #ifdef __cplusplus
 }
 #endif
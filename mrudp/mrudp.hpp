@@ -7,7 +7,9 @@ typedef std::function<mrudp_error_code_t(void *userData, mrudp_event_t)> mrudp_c
 typedef std::function<mrudp_error_code_t(void *userData, const mrudp_addr_t *)> mrudp_should_accept_callback;
 typedef std::function<mrudp_error_code_t(void *userData, mrudp_connection_t connection)> mrudp_accept_callback;
 typedef std::function<mrudp_error_code_t(void *userData, char *data, int size, int is_reliable)> mrudp_receive_callback;
+typedef std::function<mrudp_error_code_t(void *userData, int stream, char *data, int size, int is_reliable)> mrudp_receive_stream_callback;
 typedef std::function<mrudp_error_code_t(void *userData, const mrudp_addr_t *addresses, size_t numAddresses)> mrudp_resolve_callback;
+typedef std::function<mrudp_error_code_t(void *userData)> mrudp_writable_callback;
 
 mrudp_error_code_t mrudp_resolve(mrudp_service_t mrudp, const char *address, mrudp_resolve_callback &&);
  
@@ -54,3 +56,7 @@ mrudp_connection_t mrudp_connect_ex(
 );
 
 mrudp_error_code_t mrudp_resolve(mrudp_service_t mrudp, const char *address, mrudp_resolve_callback &&, void *userData);
+
+mrudp_error_code_t mrudp_connection_receive_stream(mrudp_connection_t connection, mrudp_receive_stream_callback &&);
+
+mrudp_error_code_t mrudp_connection_writable(mrudp_connection_t connection, mrudp_writable_callback &&);
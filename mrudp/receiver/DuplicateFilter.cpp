@@ -0,0 +1,78 @@
+#include "DuplicateFilter.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+bool DuplicateFilter::test(PacketID id) const
+{
+	auto bit = id % span;
+	return (bits[bit / bitsPerWord] >> (bit % bitsPerWord)) & 1;
+}
+
+void DuplicateFilter::set(PacketID id)
+{
+	auto bit = id % span;
+	bits[bit / bitsPerWord] |= u64(1) << (bit % bitsPerWord);
+}
+
+void DuplicateFilter::reset(PacketID id)
+{
+	auto bit = id % span;
+	bits[bit / bitsPerWord] &= ~(u64(1) << (bit % bitsPerWord));
+}
+
+void DuplicateFilter::advance(PacketID id)
+{
+	if (!newest)
+	{
+		newest = id;
+		return;
+	}
+	
+	if (!id_greater_than(id, *newest))
+		return;
+		
+	// until an id is inserted there are no bits to clear
+	if (!bits.empty())
+	{
+		// the ids passed over have not been seen, their bits last held the ids a
+		// span behind them
+		PacketID distance = id - *newest;
+		if (distance >= span)
+		{
+			std::fill(bits.begin(), bits.end(), 0);
+		}
+		else
+		{
+			for (PacketID i = *newest + 1; i != PacketID(id + 1); ++i)
+				reset(i);
+		}
+	}
+	
+	newest = id;
+}
+
+bool DuplicateFilter::inSpan(PacketID id) const
+{
+	if (!newest || id_greater_than(id, *newest))
+		return true;
+		
+	return PacketID(*newest - id) < span;
+}
+
+bool DuplicateFilter::insert(PacketID id)
+{
+	if (bits.empty())
+		bits.resize(span / bitsPerWord, 0);
+		
+	advance(id);
+	
+	if (!inSpan(id) || test(id))
+		return false;
+		
+	set(id);
+	return true;
+}
+
+} // namespace
+} // namespace
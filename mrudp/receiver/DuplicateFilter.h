@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../Packet.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+// --------------------------------------------------------------------------------
+// DuplicateFilter
+//
+// Remembers which packet ids have been seen, so that a packet which is resent
+// after it arrived is only processed once.
+//
+// The ids seen are kept as bits in a bitmap which slides forward with the newest
+// id.  It spans half of the id space, as an id further behind than that can not
+// be told from one ahead.  The bitmap is only allocated once an id is inserted.
+//
+// The ids inserted may be a few of those of the connection, so the filter is
+// also advanced by the ids which are not inserted, otherwise the newest would
+// fall so far behind that a new id would be taken for one long past.
+// --------------------------------------------------------------------------------
+
+struct DuplicateFilter
+{
+	static constexpr size_t span = size_t(1) << (sizeof(PacketID) * 8 - 1);
+	static constexpr size_t bitsPerWord = sizeof(u64) * 8;
+	
+	Vector<u64> bits;
+	Optional<PacketID> newest;
+	
+	// marks the id as seen, returns whether it had not been seen before.  An id
+	// which is not in the span is never new
+	bool insert(PacketID id);
+	
+	// whether the id is ahead of the newest, or less than a span behind it
+	bool inSpan(PacketID id) const;
+	
+	// slides the bitmap forward to the id, without marking it as seen
+	void advance(PacketID id);
+	
+	bool test(PacketID id) const;
+	void set(PacketID id);
+	void reset(PacketID id);
+} ;
+
+} // namespace
+} // namespace
@@ -3,16 +3,6 @@
 namespace timprepscius {
 namespace mrudp {
 
-ReceiveQueue::Frame::Frame()
-{
-
-}
-
-ReceiveQueue::Frame::Frame(const Frame &frame)
-{
-	memcpy(this, &frame, sizeof(frame.header) + frame.header.dataSize);
-}
-
 void ReceiveQueue::processQueue()
 {
 	while (processNext())
@@ -27,12 +17,14 @@ bool ReceiveQueue::processNext()
 	auto frame_ = queue.find(expectedID);
 	if (frame_ != queue.end())
 	{
-		auto &frame = frame_->second;
+		auto &queued = frame_->second;
 		
-		// process it
-		processor(frame);
+		// process it, the user may retain data from the packet
+		ReceivedPacket received(queued.packet);
+		processor(*queued.frame);
 			
 		// erase it
+		queuedSize -= sizeof(queued.frame->header) + queued.frame->header.dataSize;
 		queue.erase(frame_);
 		
 		// increase our expected ID
@@ -44,7 +36,7 @@ bool ReceiveQueue::processNext()
 	return false;
 }
 
-void ReceiveQueue::onReceive(Packet &packet)
+void ReceiveQueue::onReceive(Packet &packet, const Optional<u16> &high)
 {
 	sLogDebug("mrudp::receive", logVarV((char)packet.header.type) << logVarV(packet.header.connection) << logVarV(packet.header.id) );
 
@@ -54,6 +46,8 @@ void ReceiveQueue::onReceive(Packet &packet)
 	auto *begin = (Frame *)packet.data;
 	auto *end = (Frame *)(packet.data + packet.dataSize);
 	
+	Optional<FrameNumber> previous;
+	
 	for (auto *frame = (Frame *)begin; frame < end; frame = (Frame *)(frame->data + frame->header.dataSize))
 	{
 		auto remaining = (size_t)end - (size_t)frame;
@@ -66,7 +60,20 @@ void ReceiveQueue::onReceive(Packet &packet)
 		if (remaining < sizeof(FrameHeader) + frame->header.dataSize)
 			break;
 
-		if (frame->header.id == expectedID)
+		auto id = frame->header.id;
+		FrameNumber number;
+		
+		if (previous)
+			number = *previous + FrameID(id - FrameID(*previous));
+		else
+		if (high)
+			number = (FrameNumber(*high) << 16) | id;
+		else
+			number = expectedID + (int16_t)FrameID(id - FrameID(expectedID));
+			
+		previous = number;
+		
+		if (number == expectedID)
 		{
 			processor(*frame);
 			expectedID++;
@@ -75,11 +82,11 @@ void ReceiveQueue::onReceive(Packet &packet)
 		}
 		else
 		{
-			if (id_greater_than(frame->header.id, expectedID))
+			if (id_greater_than(number, expectedID))
 			{
 				sLogDebug("mrudp::receive", logOfThis(this) << "out of order " << packet.header.id << " but greater than expected " << expectedID);
 				
-				enqueue(*frame);
+				enqueue(*frame, number);
 			}
 			else
 			{
@@ -89,10 +96,28 @@ void ReceiveQueue::onReceive(Packet &packet)
 	}
 }
 
-void ReceiveQueue::enqueue(Frame &frame)
+void ReceiveQueue::enqueue(Frame &frame, FrameNumber id)
 {
-	auto id = frame.header.id;
-	queue.emplace(id, frame);
+	auto size = sizeof(frame.header) + frame.header.dataSize;
+	
+	// a frame queued already is not queued again
+	if (queue.find(id) != queue.end())
+		return;
+		
+	queuedSize += size;
+	
+	auto packet = retainReceived((char *)&frame, size);
+	if (packet)
+	{
+		queue.emplace(id, QueuedFrame { packet, &frame });
+		return;
+	}
+	
+	packet = newPacket();
+	mem_copy(packet->data, (char *)&frame, size);
+	packet->dataSize = size;
+	
+	queue.emplace(id, QueuedFrame { packet, (Frame *)packet->data });
 }
 
 } // namespace
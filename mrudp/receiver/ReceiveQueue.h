@@ -13,6 +13,14 @@ namespace mrudp {
 //
 // ReceiveQueue::onReceive is called for each incoming packet, which in turn
 // calls the processor function for each frame in each packet in order;
+//
+// Frames in order are processed in place.  A frame which arrives early keeps the
+// received packet it lies in, it is only copied if that packet is not pooled.
+//
+// Frames are ordered by their full FrameNumber.  The first frame of a packet is
+// numbered from the high bits the packet carries with 32 bit packet numbers, or
+// otherwise as the number nearest the expected one, and each frame after it as
+// the next number with its low bits.
 // --------------------------------------------------------------------------------
 
 struct ReceiveQueue
@@ -23,25 +31,31 @@ struct ReceiveQueue
 
 			FrameHeader header;
 			Data data;
-			
-			Frame();
-			Frame(const Frame &frame);
 		}
 	);
+	
+	struct QueuedFrame
+	{
+		PacketPtr packet;
+		Frame *frame;
+	} ;
 
-	FrameID expectedID = 0;
+	FrameNumber expectedID = 0;
 	Function<void(Frame &)> processor;
 
 	Mutex mutex;
-	typedef OrderedMap<FrameID, Frame> Queue;
+	typedef OrderedMap<FrameNumber, QueuedFrame> Queue;
 	Queue queue;
 	
+	// the size of the frames queued, see Receiver::credit
+	Atomic<size_t> queuedSize = 0;
+	
 	// enqueues an out of order packet
-	void enqueue(Frame &packet);
+	void enqueue(Frame &packet, FrameNumber number);
 	
 	// either process the packet immediately, enqueue it or
-	// discard it
-	void onReceive(Packet &packet);
+	// discard it, high is the high bits of the number of the first frame
+	void onReceive(Packet &packet, const Optional<u16> &high = {});
 	
 	// processes all in order and as expected packets with the given function
 	void processQueue ();
@@ -11,20 +11,34 @@ namespace mrudp {
 Receiver::Receiver(Connection *connection_) :
 	connection(connection_)
 {
-	receiveQueue.processor =
+	for (int i=0; i<MAX_STREAMS; ++i)
+	{
+		streams[i].queue.processor =
+			[this, i](auto &packet) {
+				processReceived(packet, RELIABLE, StreamID(i));
+			};
+	}
+
+	unorderedReceiveQueue.processor =
 		[this](auto &packet) {
-			processReceived(packet, RELIABLE);
+			processReceived(packet, RELIABLE_UNORDERED);
 		};
 
 	unreliableReceiveQueue.processor =
 		[this](auto &packet) {
 			processReceived(packet, UNRELIABLE);
 		};
+		
+	connection->socket->service->scheduler->allocate(
+		resumeTimeout,
+		[this]() { drain(); }
+	);
 }
 
 void Receiver::open (PacketID packetID)
 {
-	receiveQueue.processQueue();
+	for (auto &stream: streams)
+		stream.queue.processQueue();
 
 	if (status == UNINITIALIZED)
 		status = OPEN;
@@ -42,7 +56,7 @@ void Receiver::close ()
 		
 		if (connection->canSend())
 		{
-			auto packet = strong<Packet>();
+			auto packet = newPacket();
 			packet->header.type = CLOSE_READ;
 		
 			connection->sender.sendReliably(packet);
@@ -60,7 +74,126 @@ void Receiver::fail ()
 	}
 }
 
-void Receiver::processReceived(ReceiveQueue::Frame &frame, Reliability reliability)
+void Receiver::deliver(char *data, int size, Reliability reliability, StreamID stream)
+{
+	{
+		auto lock = lock_of(heldMutex);
+		
+		if (reliability == UNRELIABLE)
+		{
+			if (paused)
+				return;
+		}
+		else
+		if (paused || draining)
+		{
+			held.push_back(Held { Vector<char>(data, data + size), reliability, stream });
+			heldSize += size;
+			
+			return;
+		}
+	}
+	
+	connection->receive(data, size, reliability, stream);
+}
+
+void Receiver::pause ()
+{
+	auto lock = lock_of(heldMutex);
+	paused = true;
+}
+
+void Receiver::resume ()
+{
+	{
+		auto lock = lock_of(heldMutex);
+		if (!paused)
+			return;
+			
+		paused = false;
+		draining = true;
+	}
+	
+	resumeTimeout.schedule(connection->socket->service->clock.now());
+}
+
+void Receiver::drain ()
+{
+	while (true)
+	{
+		Held next;
+		
+		{
+			auto lock = lock_of(heldMutex);
+			if (paused || held.empty())
+			{
+				draining = false;
+				break;
+			}
+			
+			next = std::move(held.front());
+			held.pop_front();
+			heldSize -= next.data.size();
+		}
+		
+		connection->receive(next.data.data(), (int)next.data.size(), next.reliability, next.stream);
+	}
+	
+	// the remote may be waiting with no packets unacked, so has no ack coming to
+	// learn of the credit
+	connection->sender.sendCredit(credit());
+	
+	possiblyClose();
+}
+
+u16 Receiver::credit ()
+{
+	size_t window = std::max((int)connection->options.receive_window, 0) * MAX_PACKET_DATA_SIZE;
+	size_t used = heldSize;
+	
+	for (auto &stream: streams)
+		used += stream.queue.queuedSize;
+		
+	if (used >= window)
+		return 0;
+		
+	return u16(std::min((window - used) / MAX_PACKET_DATA_SIZE, (size_t)std::numeric_limits<u16>::max()));
+}
+
+void Receiver::possiblyClose ()
+{
+	if (!ends || status != OPEN)
+		return;
+		
+	// the data held is delivered before closing, see Receiver::drain
+	{
+		auto lock = lock_of(heldMutex);
+		if (!held.empty())
+			return;
+	}
+		
+	for (auto &end: *ends)
+	{
+		if (end.stream == UNORDERED_STREAM)
+		{
+			if (id_greater_than(end.end, unorderedReceiveQueue.processed))
+				return;
+				
+			continue;
+		}
+		
+		if (end.stream >= MAX_STREAMS)
+			continue;
+			
+		if (id_greater_than(end.end, streams[end.stream].queue.expectedID))
+			return;
+	}
+	
+	close();
+	connection->possiblyClose();
+}
+
+void Receiver::processReceived(ReceiveQueue::Frame &frame, Reliability reliability, StreamID stream)
 {
 	if (frame.header.type == ACK_FRAME)
 	{
@@ -69,27 +202,64 @@ void Receiver::processReceived(ReceiveQueue::Frame &frame, Reliability reliabili
 		connection->sender.onAck(ack);
 	}
 	else
+	if (frame.header.type == SACK_FRAME)
+	{
+		if (frame.header.dataSize < sizeof(Sack))
+			return;
+			
+		Sack sack;
+		small_copy((char *)&sack, frame.data, sizeof(sack));
+		
+		auto *ranges = (const AckRange *)(frame.data + sizeof(sack));
+		auto count = (frame.header.dataSize - sizeof(sack)) / sizeof(AckRange);
+		
+		connection->sender.onAck(sack, ranges, count);
+	}
+	else
+	if (frame.header.type == CREDIT_FRAME)
+	{
+		if (frame.header.dataSize < sizeof(u16))
+			return;
+			
+		u16 credit;
+		small_copy((char *)&credit, frame.data, sizeof(credit));
+		connection->sender.onCredit(credit);
+	}
+	else
+	if (frame.header.type == ACK_FREQUENCY_FRAME)
+	{
+		if (frame.header.dataSize < sizeof(AckFrequency))
+			return;
+			
+		AckFrequency frequency;
+		small_copy((char *)&frequency, frame.data, sizeof(frequency));
+		connection->sender.onAckFrequency(frequency);
+	}
+	else
 	if (frame.header.type == DATA)
 	{
-		connection->receive(frame.data, frame.header.dataSize, reliability);
+		deliver(frame.data, frame.header.dataSize, reliability, stream);
 	}
 	else
 	if (frame.header.type == DATA_COMPRESSED)
 	{
-		processCompressed(frame);
+		processCompressed(frame, stream);
 	}
 	else
 	if (frame.header.type == CLOSE_WRITE)
 	{
 		if (reliability == RELIABLE)
 		{
-			close();
-			connection->possiblyClose();
+			auto count = frame.header.dataSize / sizeof(StreamEnd);
+			auto *ends_ = (const StreamEnd *)frame.data;
+			
+			ends.emplace(ends_, ends_ + count);
+			possiblyClose();
 		}
 	}
 }
 
-void Receiver::processCompressedSubframes(char *begin, int size)
+void Receiver::processCompressedSubframes(char *begin, int size, StreamID stream)
 {
 	using BufferSize = u32;
 
@@ -112,17 +282,18 @@ void Receiver::processCompressedSubframes(char *begin, int size)
 		if (size < frameSize)
 			break;
 			
-		connection->receive(p, frameSize, RELIABLE);
+		deliver(p, frameSize, RELIABLE, stream);
 		p += frameSize;
 		size -= frameSize;
 	}
 }
 
-void Receiver::processCompressed(ReceiveQueue::Frame &frame)
+void Receiver::processCompressed(ReceiveQueue::Frame &frame, StreamID stream)
 {
 	using WasCompressed = u8;
 	using BufferSize = u32;
 
+	auto &compressionBuffers = streams[stream].compressionBuffers;
 	auto &compressed = compressionBuffers[0];
 	auto at = compressed.size();
 	compressed.resize(compressed.size() + frame.header.dataSize);
@@ -149,7 +320,7 @@ void Receiver::processCompressed(ReceiveQueue::Frame &frame)
 	
 	if (wasCompressed == 0)
 	{
-		processCompressedSubframes(p, inSize);
+		processCompressedSubframes(p, inSize, stream);
 	}
 	else
 	{
@@ -171,7 +342,7 @@ void Receiver::processCompressed(ReceiveQueue::Frame &frame)
 		uncompress(dest, &destLen, source, sourceLen);
 		debug_assert(destLen == uncompressedSize);
 
-		processCompressedSubframes((char *)dest, (int)destLen);
+		processCompressedSubframes((char *)dest, (int)destLen, stream);
 		uncompressed.resize(0);
 	}
 	
@@ -183,7 +354,7 @@ inline
 bool requiresAck(TypeID typeID)
 {
 	return
-		typeID == DATA_RELIABLE ||
+		isAckedData(typeID) ||
 		typeID == PROBE ||
 		typeID == CLOSE_READ;
 }
@@ -198,14 +369,56 @@ void Receiver::onReceive(Packet &packet)
 	// and only accept packets after it
 		
 	auto type = packet.header.type;
+	bool inOrder = false;
+	
 	if(requiresAck(type))
 	{
-		connection->sender.ack(packet.header.id);
+		inOrder = connection->sender.ack(packet.header.id);
+		
+		// the unordered packets share the ids with the others
+		if (type != DATA_RELIABLE_UNORDERED)
+			unorderedReceiveQueue.onAcked(packet.header.id);
 	}
 
-	if (packet.header.type == DATA_RELIABLE)
+	if (isReliableData(packet.header.type))
+	{
+		if (packet.header.type == DATA_RELIABLE_WITH_ACKS)
+		{
+			if (!connection->sender.popPiggybackedAcks(packet, inOrder))
+				return;
+		}
+		
+		Optional<u16> high;
+		if (connection->handshake_options.isExtended())
+		{
+			u16 high_;
+			if (!popData(packet, high_))
+				return;
+				
+			high = high_;
+		}
+		
+		StreamID stream;
+		if (!popData(packet, stream) || stream >= MAX_STREAMS)
+			return;
+			
+		streams[stream].queue.onReceive(packet, high);
+		
+		// the frames which arrived may be the last the remote wrote
+		possiblyClose();
+	}
+	else
+	if (packet.header.type == DATA_RELIABLE_UNORDERED)
 	{
-		receiveQueue.onReceive(packet);
+		// the packet has been acked, so if it can not be processed its frames are lost
+		if (!unorderedReceiveQueue.onReceive(packet))
+		{
+			connection->fail(MRUDP_EVENT_TIMEOUT);
+			return;
+		}
+		
+		// the frames which arrived may be the last the remote wrote
+		possiblyClose();
 	}
 	else
 	if (packet.header.type == DATA_UNRELIABLE)
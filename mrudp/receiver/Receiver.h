@@ -2,6 +2,8 @@
 
 #include "ReceiveQueue.h"
 #include "UnreliableReceiveQueue.h"
+#include "UnorderedReceiveQueue.h"
+#include "../Scheduler.h"
 
 namespace timprepscius {
 namespace mrudp {
@@ -20,6 +22,16 @@ struct Connection;
 // Processing is done as well within onPacket, if the header id is the next header
 // id we are expecting, it processes immediately, if it is not, it queues it in
 // an ordered processing queue.
+//
+// Each reliable stream has its own processing queue, so a frame missing on one
+// stream holds back only that stream.  Reliable unordered packets are processed as
+// they arrive, once each.
+//
+// The receiver holds the frames which arrive out of order, and while the user has
+// paused it the data which would have been delivered.  The room left in the
+// receive window is sent in each ack as the credit, and the remote sends no more
+// unacked packets than it, see Sender::processReliableDataQueue.  When the user
+// resumes, the held data is delivered and the credit is sent again.
 // --------------------------------------------------------------------------------
 
 struct Receiver
@@ -35,10 +47,20 @@ struct Receiver
 	
 	Receiver(Connection *connection);
 	
-	ReceiveQueue receiveQueue;
+	struct Stream
+	{
+		ReceiveQueue queue;
+		SizedVector<char> compressionBuffers[2];
+	} ;
+	
+	Stream streams[MAX_STREAMS];
+	UnorderedReceiveQueue unorderedReceiveQueue;
 	UnreliableReceiveQueue unreliableReceiveQueue;
-	SizedVector<char> compressionBuffers[2];
-
+	
+	// the ends of the streams given by the CLOSE_WRITE of the remote, the receiver
+	// closes once each stream has been processed up to its end
+	Optional<Vector<StreamEnd>> ends;
+	void possiblyClose ();
 	
 	// Called on a SYN packet, sets the status to Open, and
 	// sets the expected packet id.
@@ -50,11 +72,40 @@ struct Receiver
 	// Called when the connection is already failed
 	void fail();
 	
+	struct Held
+	{
+		Vector<char> data;
+		Reliability reliability;
+		StreamID stream;
+	} ;
+	
+	Mutex heldMutex;
+	List<Held> held;
+	Atomic<size_t> heldSize = 0;
+	
+	// draining is set from a resume until the data held has been delivered, the
+	// data which arrives meanwhile is held behind it
+	bool paused = false;
+	bool draining = false;
+	
+	Timeout resumeTimeout;
+	
+	// gives the data to the user, or holds it while paused, unreliable data is
+	// dropped while paused
+	void deliver(char *data, int size, Reliability reliability, StreamID stream);
+	
+	void pause ();
+	void resume ();
+	void drain ();
+	
+	// the packets of data which fit in what is left of the receive window
+	u16 credit ();
+	
 	// Dispatches to either reliable, unreliable, or probe paths
-	void processReceived(ReceiveQueue::Frame &frame, Reliability reliability);
+	void processReceived(ReceiveQueue::Frame &frame, Reliability reliability, StreamID stream = 0);
 	
-	void processCompressedSubframes(char *data, int size);
-	void processCompressed(ReceiveQueue::Frame &frame);
+	void processCompressedSubframes(char *data, int size, StreamID stream);
+	void processCompressed(ReceiveQueue::Frame &frame, StreamID stream);
 	
 	// Processes incoming packets
 	void onReceive (Packet &packet);
@@ -0,0 +1,47 @@
+#include "UnorderedReceiveQueue.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+void UnorderedReceiveQueue::onAcked(PacketID id)
+{
+	auto lock = lock_of(mutex);
+	filter.advance(id);
+}
+
+bool UnorderedReceiveQueue::onReceive(Packet &packet)
+{
+	sLogDebug("mrudp::receive", logVarV((char)packet.header.type) << logVarV(packet.header.connection) << logVarV(packet.header.id) );
+
+	auto lock = lock_of(mutex);
+	
+	if (!filter.inSpan(packet.header.id))
+	{
+		sLogRelease("mrudp::receive", logOfThis(this) << "unordered packet outside of the duplicate filter " << packet.header.id);
+		return false;
+	}
+	
+	if (!filter.insert(packet.header.id))
+	{
+		sLogDebug("mrudp::receive", logOfThis(this) << "DISCARD duplicate " << packet.header.id);
+		return true;
+	}
+
+	auto *begin = (Frame *)packet.data;
+	auto *end = (Frame *)(packet.data + packet.dataSize);
+	
+	for (auto *frame = (Frame *)begin; frame < end; frame = (Frame *)(frame->data + frame->header.dataSize))
+	{
+		auto remaining = (size_t)end - (size_t)frame;
+		if (remaining < sizeof(FrameHeader) + frame->header.dataSize)
+			break;
+			
+		processor(*frame);
+		processed++;
+	}
+	
+	return true;
+}
+
+} // namespace
+} // namespace
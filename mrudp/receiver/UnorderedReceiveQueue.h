@@ -0,0 +1,41 @@
+#pragma once
+
+#include "ReceiveQueue.h"
+#include "DuplicateFilter.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+// --------------------------------------------------------------------------------
+// UnorderedReceiveQueue
+//
+// Processes the frames of a reliable unordered packet as soon as it arrives.  The
+// packet is resent until it is acked, so it may arrive more than once, only the
+// first arrival is processed, see DuplicateFilter.
+// --------------------------------------------------------------------------------
+
+struct UnorderedReceiveQueue
+{
+	using Frame = ReceiveQueue::Frame;
+	
+	Function<void(Frame &)> processor;
+	
+	Mutex mutex;
+	DuplicateFilter filter;
+	
+	// the number of frames processed, the remote gives the number it sent when it
+	// closes, see Receiver::possiblyClose
+	FrameNumber processed = 0;
+
+	// process the packet immediately, unless it has been processed already.
+	// Returns false if the packet lies too far behind to be told from a new one,
+	// which the remote should never send, see RetryWindow::maximumCapacity
+	bool onReceive(Packet &packet);
+	
+	// the id of each acked packet of the connection, which moves the filter
+	// forward with the ids of the other packets
+	void onAcked(PacketID id);
+} ;
+
+} // namespace
+} // namespace
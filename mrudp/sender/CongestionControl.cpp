@@ -0,0 +1,295 @@
+#include "CongestionControl.h"
+#include <cmath>
+
+namespace timprepscius {
+namespace mrudp {
+
+namespace {
+
+float secondsBetween(const Timepoint &from, const Timepoint &to)
+{
+	return std::chrono::duration_cast<std::chrono::duration<float>>(to - from).count();
+}
+
+} // namespace
+
+// --------------------------------------------------------------------------------
+// Simple
+// --------------------------------------------------------------------------------
+
+void CongestionSimple::onAck(const Timepoint &, float, float rtt)
+{
+	window.onSample(rtt);
+}
+
+void CongestionSimple::onRetry(const Timepoint &, const Timepoint &, float rtt)
+{
+	window.onSample(rtt);
+}
+
+// --------------------------------------------------------------------------------
+// NewReno
+// --------------------------------------------------------------------------------
+
+void CongestionNewReno::onAck(const Timepoint &, float, float)
+{
+	if (window.size < threshold)
+		window.size += 1;
+	else
+		window.size += 1 / window.size;
+		
+	window.clamp();
+}
+
+void CongestionNewReno::onRetry(const Timepoint &now, const Timepoint &sentAt, float)
+{
+	if (sentAt <= recovery)
+		return;
+		
+	recovery = now;
+	
+	// a retry is a timeout here, but it comes after 2 rtts rather than the
+	// seconds of tcp, so the window is halved instead of collapsed
+	threshold = std::max(window.size / 2, CongestionWindow::minimum);
+	window.size = threshold;
+	window.clamp();
+}
+
+// --------------------------------------------------------------------------------
+// Cubic
+// --------------------------------------------------------------------------------
+
+void CongestionCubic::onAck(const Timepoint &now, float, float rtt)
+{
+	if (window.size < threshold)
+	{
+		window.size += 1;
+		window.clamp();
+		return;
+	}
+	
+	if (!epoch)
+	{
+		epoch = now;
+		
+		if (window.size < maximum)
+		{
+			K = std::cbrt((maximum - window.size) / C);
+		}
+		else
+		{
+			K = 0;
+			maximum = window.size;
+		}
+	}
+	
+	auto t = secondsBetween(*epoch, now) + rtt;
+	auto cubic = C * (t - K) * (t - K) * (t - K) + maximum;
+	
+	// the window reno would have, so cubic is never slower than it
+	auto reno = maximum * beta + 3 * (1 - beta) / (1 + beta) * (t / rtt);
+	
+	auto target = std::max(cubic, reno);
+	if (target > window.size)
+		window.size += std::min(target - window.size, window.size * 0.5f) / window.size;
+	else
+		window.size += 0.01f / window.size;
+		
+	window.clamp();
+}
+
+void CongestionCubic::onRetry(const Timepoint &now, const Timepoint &sentAt, float)
+{
+	if (sentAt <= recovery)
+		return;
+		
+	recovery = now;
+	epoch.reset();
+	
+	// fast convergence, a flow which lost before reaching its last maximum
+	// releases bandwidth to the others
+	if (window.size < previousMaximum)
+		maximum = window.size * (1 + beta) / 2;
+	else
+		maximum = window.size;
+		
+	previousMaximum = maximum;
+		
+	window.size = std::max(window.size * beta, CongestionWindow::minimum);
+	threshold = window.size;
+	window.clamp();
+}
+
+// --------------------------------------------------------------------------------
+// BBR
+// --------------------------------------------------------------------------------
+
+void CongestionBBR::onAck(const Timepoint &now, float sample, float)
+{
+	if (sample > 0)
+	if (minimumRtt == 0 || sample <= minimumRtt || secondsBetween(minimumRttAt, now) > minimumRttExpiration)
+	{
+		minimumRtt = sample;
+		minimumRttAt = now;
+	}
+	
+	if (!roundStart)
+		roundStart = now;
+	
+	delivered++;
+	
+	if (minimumRtt > 0 && secondsBetween(*roundStart, now) >= minimumRtt)
+		onRound(now);
+}
+
+void CongestionBBR::onRound(const Timepoint &now)
+{
+	auto elapsed = secondsBetween(*roundStart, now);
+	
+	bandwidths.push_back(delivered / elapsed);
+	if (bandwidths.size() > bandwidthRounds)
+		bandwidths.pop_front();
+		
+	bandwidth = *std::max_element(bandwidths.begin(), bandwidths.end());
+	
+	roundStart = now;
+	delivered = 0;
+	
+	switch (mode)
+	{
+		case STARTUP:
+		{
+			if (bandwidth >= fullBandwidth * 1.25f)
+			{
+				fullBandwidth = bandwidth;
+				fullBandwidthRounds = 0;
+			}
+			else
+			if (++fullBandwidthRounds >= 3)
+			{
+				mode = DRAIN;
+				gain = 1 / highGain;
+			}
+		}
+		break;
+		
+		case DRAIN:
+		{
+			mode = PROBE_BANDWIDTH;
+			cycle = 0;
+			gain = cycleGains[cycle];
+		}
+		break;
+		
+		case PROBE_BANDWIDTH:
+		{
+			cycle = (cycle + 1) % std::size(cycleGains);
+			gain = cycleGains[cycle];
+		}
+		break;
+	}
+	
+	// the window is the bandwidth delay product, doubled so that acks which
+	// are delayed or bunched do not stall the sender
+	auto bdp = bandwidth * minimumRtt;
+	window.size = (mode == STARTUP ? gain : 2 * gain) * bdp;
+	window.clamp();
+}
+
+void CongestionBBR::onRetry(const Timepoint &now, const Timepoint &sentAt, float)
+{
+	if (sentAt <= recovery)
+		return;
+		
+	recovery = now;
+	
+	// the model does not change on loss, but probing stops for this cycle
+	if (mode == PROBE_BANDWIDTH && gain > 1)
+	{
+		cycle = 1;
+		gain = cycleGains[cycle];
+		
+		window.size = 2 * gain * bandwidth * minimumRtt;
+		window.clamp();
+	}
+}
+
+// --------------------------------------------------------------------------------
+// CongestionControl
+// --------------------------------------------------------------------------------
+
+CongestionControl::CongestionControl() :
+	mode(MRUDP_CONGESTION_SIMPLE)
+{
+	update_();
+}
+
+void CongestionControl::select_(s8 mode_)
+{
+	if (mode == mode_)
+		return;
+		
+	mode = mode_;
+	
+	switch (mode)
+	{
+		case MRUDP_CONGESTION_NEWRENO:
+			controller = CongestionNewReno();
+		break;
+		case MRUDP_CONGESTION_CUBIC:
+			controller = CongestionCubic();
+		break;
+		case MRUDP_CONGESTION_BBR:
+			controller = CongestionBBR();
+		break;
+		default:
+			controller = CongestionSimple();
+	}
+	
+	std::visit([&](auto &c) { c.window.maximum = maximum; }, controller);
+	update_();
+}
+
+void CongestionControl::setMaximum(size_t maximum_)
+{
+	auto lock = lock_of(mutex);
+	maximum = maximum_;
+	
+	std::visit([&](auto &c) { c.window.maximum = maximum; }, controller);
+	update_();
+}
+
+void CongestionControl::update_()
+{
+	size = std::visit([](auto &c) { return c.size(); }, controller);
+}
+
+void CongestionControl::select(s8 mode_)
+{
+	auto lock = lock_of(mutex);
+	select_(mode_);
+}
+
+void CongestionControl::onAck(s8 mode_, const Timepoint &now, size_t acked, float sample, float rtt)
+{
+	auto lock = lock_of(mutex);
+	select_(mode_);
+	
+	std::visit([&](auto &c) {
+		for (size_t i=0; i<acked; ++i)
+			c.onAck(now, i == 0 ? sample : 0, rtt);
+	}, controller);
+	update_();
+}
+
+void CongestionControl::onRetry(s8 mode_, const Timepoint &now, const Timepoint &sentAt, float rtt)
+{
+	auto lock = lock_of(mutex);
+	select_(mode_);
+	
+	std::visit([&](auto &c) { c.onRetry(now, sentAt, rtt); }, controller);
+	update_();
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,155 @@
+#pragma once
+
+#include "../Base.h"
+#include "../mrudp.h"
+#include "WindowSize.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+// --------------------------------------------------------------------------------
+// CongestionControl
+//
+// CongestionControl decides the maximum number of unacked reliable packets on a
+// connection.  It is told of each ack, with the rtt sample and the smoothed rtt,
+// and of each retry, which is taken as a loss.
+//
+// A sample of 0 means the ack carried no rtt sample.
+//
+// The controller is chosen per connection by the congestion_control option:
+//
+//   Simple:  the window is 2 / rtt packets, losses only matter through the rtt
+//   NewReno: slow start, then one packet per rtt, halving on loss
+//   Cubic:   the window follows a cubic of the time since the last loss
+//   BBR:     the window is a gain of the estimated bandwidth delay product
+//
+// A retry of a packet which was sent before the last reduction is part of the
+// same loss event, and does not reduce the window again.
+// --------------------------------------------------------------------------------
+
+struct CongestionWindow
+{
+	// the largest window with 16 bit packet numbers, and with 32 bit ones, see
+	// Handshake_Options
+	static constexpr float minimum = 3, standardMaximum = 1024, extendedMaximum = 16384;
+	
+	float size = minimum;
+	float maximum = standardMaximum;
+	
+	void clamp ()
+	{
+		size = std::min(maximum, std::max(minimum, size));
+	}
+} ;
+
+struct CongestionSimple
+{
+	WindowSizeSimple window;
+	
+	size_t size () { return window.size; }
+	
+	void onAck(const Timepoint &now, float sample, float rtt);
+	void onRetry(const Timepoint &now, const Timepoint &sentAt, float rtt);
+} ;
+
+struct CongestionNewReno
+{
+	CongestionWindow window;
+	float threshold = std::numeric_limits<float>::max();
+	Timepoint recovery = Timepoint::min();
+	
+	size_t size () { return (size_t)window.size; }
+
+	void onAck(const Timepoint &now, float sample, float rtt);
+	void onRetry(const Timepoint &now, const Timepoint &sentAt, float rtt);
+} ;
+
+struct CongestionCubic
+{
+	static constexpr float C = 0.4f, beta = 0.7f;
+	
+	CongestionWindow window;
+	float threshold = std::numeric_limits<float>::max();
+	Timepoint recovery = Timepoint::min();
+	
+	// the window before the last loss, and when the current epoch began
+	float maximum = 0, previousMaximum = 0;
+	float K = 0;
+	Optional<Timepoint> epoch;
+	
+	size_t size () { return (size_t)window.size; }
+
+	void onAck(const Timepoint &now, float sample, float rtt);
+	void onRetry(const Timepoint &now, const Timepoint &sentAt, float rtt);
+} ;
+
+struct CongestionBBR
+{
+	enum Mode {
+		STARTUP,
+		DRAIN,
+		PROBE_BANDWIDTH
+	} ;
+	
+	static constexpr float highGain = 2.885f;
+	static constexpr float cycleGains[] = { 1.25f, 0.75f, 1, 1, 1, 1, 1, 1 };
+	static constexpr size_t bandwidthRounds = 10;
+	static constexpr float minimumRttExpiration = 10;
+	
+	CongestionWindow window;
+	Mode mode = STARTUP;
+	float gain = highGain;
+	size_t cycle = 0;
+	
+	// packets acked in the current round, a round lasts one minimum rtt
+	Optional<Timepoint> roundStart;
+	size_t delivered = 0;
+	
+	// the bandwidth samples (packets per second) of the last rounds
+	List<float> bandwidths;
+	float bandwidth = 0;
+	
+	// startup ends when the bandwidth stops growing
+	float fullBandwidth = 0;
+	size_t fullBandwidthRounds = 0;
+	
+	float minimumRtt = 0;
+	Timepoint minimumRttAt;
+	
+	Timepoint recovery = Timepoint::min();
+	
+	size_t size () { return (size_t)window.size; }
+
+	void onAck(const Timepoint &now, float sample, float rtt);
+	void onRetry(const Timepoint &now, const Timepoint &sentAt, float rtt);
+	
+	void onRound(const Timepoint &now);
+} ;
+
+struct CongestionControl
+{
+	CongestionControl();
+	
+	Mutex mutex;
+	s8 mode;
+	Variant<CongestionSimple, CongestionNewReno, CongestionCubic, CongestionBBR> controller;
+	
+	// read without the lock when deciding whether to send
+	Atomic<size_t> size;
+	
+	// the largest window the controller may grow to
+	size_t maximum = CongestionWindow::standardMaximum;
+	void setMaximum(size_t maximum);
+	
+	// replaces the controller if the mode has changed
+	void select(s8 mode);
+	
+	void onAck(s8 mode, const Timepoint &now, size_t acked, float sample, float rtt);
+	void onRetry(s8 mode, const Timepoint &now, const Timepoint &sentAt, float rtt);
+	
+	void select_(s8 mode);
+	void update_();
+} ;
+
+} // namespace
+} // namespace
@@ -1,53 +1,98 @@
 #pragma once
 
+#include "../Base.h"
+#include <cmath>
+
 namespace timprepscius {
 namespace mrudp {
 
 // --------------------------------------------------------------------------------
 // RTT
 // 
-// RTT is calculated by generating a weighted average of the current RTT with the
-// next sample.
+// RTT keeps the smoothed rtt and its variation as in RFC 6298, along with the
+// lowest sample seen.  The retry timeout is the smoothed rtt plus four times the
+// variation, and the longest the remote may delay an ack.
+//
+// A packet which is retried doubles its timeout with each attempt, rather than
+// the rtt being pushed towards its maximum.  Acks of retried packets are not
+// sampled, as it is unknown which attempt they ack.
+//
+// The probe timeout is one and a half smoothed rtts, without the allowance for a
+// delayed ack, see Retrier::onProbeTimeout.
 // --------------------------------------------------------------------------------
 
-struct RTTConstant
-{
-	float duration = 1.0f;
-
-	void onSample(float) {}
-	void onAckFailure () {}
-} ;
-
-struct RTTSimple
+struct RTTEstimator
 {
-	static constexpr float a = 0.9f;
-	static constexpr float b = 1 - a;
-
-	float maximum = 1.0f;
+	static constexpr float alpha = 1 / 8.0f;
+	static constexpr float beta = 1 / 4.0f;
+	
+	// the scheduler rounds timeouts up to 10ms
+	static constexpr float granularity = 0.010f;
+	static constexpr float maximumAckDelay = 0.030f;
+	
+	static constexpr float minimum = 0.005f, maximum = 1.0f;
+	static constexpr float initialTimeout = 1.0f;
+	static constexpr float minimumTimeout = 2 * minimum + maximumAckDelay;
+	static constexpr float maximumTimeout = 2 * maximum;
+	static constexpr float probeFactor = 1.5f;
+	
+	// the smoothed rtt
 	float duration = maximum;
-	float minimum = 0.005f;
+	float variance = 0;
+	
+	// zero until the first sample
+	float lowest = 0;
+	bool sampled = false;
 	
-	float calculate(float duration, float sample)
+	// Recalculates the rtt given a new sample
+	void onSample(float sample)
 	{
-		return std::min(maximum, std::max(minimum, a * duration + b * sample));
+		sample = std::min(maximum, std::max(minimum, sample));
+		
+		if (!sampled)
+		{
+			duration = sample;
+			variance = sample / 2;
+			lowest = sample;
+			sampled = true;
+		}
+		else
+		{
+			variance = (1 - beta) * variance + beta * std::abs(duration - sample);
+			duration = (1 - alpha) * duration + alpha * sample;
+			lowest = std::min(lowest, sample);
+		}
 	}
 	
-	// Recalculates the rtt duration given a new sample
-	void onSample(float sample)
+	// the retry timeout of a packet which has not yet been retried
+	float timeout () const
 	{
-		duration = calculate(duration, sample);
+		if (!sampled)
+			return initialTimeout;
+			
+		auto timeout = duration + std::max(granularity, 4 * variance) + maximumAckDelay;
+		return std::min(maximumTimeout, std::max(minimumTimeout, timeout));
 	}
 	
-	// Recalculates the rtt duration given a failure, which is evaluated as
-	// a sample taking the maximum transit time.
-	void onAckFailure ()
+	// the retry timeout after the given number of attempts
+	float timeout (size_t attempts) const
 	{
-		onSample(maximum);
+		return backoff(timeout(), attempts);
+	}
+	
+	// the time without an ack after a send before the newest packet is probed
+	float probeTimeout () const
+	{
+		return std::max(2 * granularity, probeFactor * duration);
+	}
+	
+	static float backoff (float timeout, size_t attempts)
+	{
+		return std::min(maximumTimeout, timeout * float(1 << std::min(attempts, size_t(16))));
 	}
-
 } ;
 
-typedef RTTSimple RTT;
+typedef RTTEstimator RTT;
 
 } // namespace
 } // namespace
@@ -17,6 +17,13 @@ Retrier::Retrier (Sender *sender_) :
 			this->onRetryTimeout();
 		}
 	);
+	
+	sender->connection->socket->service->scheduler->allocate(
+		probeTimeout,
+		[this]() {
+			this->onProbeTimeout();
+		}
+	);
 }
 
 Retrier::~Retrier ()
@@ -32,30 +39,69 @@ void Retrier::close ()
 	{
 		status = CLOSED;
 		window.clear();
+		deadlines = decltype(deadlines)();
+		probeAt.reset();
 	}
 }
 
-StrongPtr<Retry> Retrier::getNextRetry()
+void Retrier::pushDeadline(PacketID id, Retry &retry)
 {
-	auto lock = lock_of(mutex);
+	retry.retryAt = retry.sentAt + toDuration(calculateRetryDuration(retry.attempts));
+	retry.generation = ++generation;
+	
+	deadlines.push(Deadline {
+		.at = retry.retryAt,
+		.id = id,
+		.generation = retry.generation,
+		.priority = retry.priority
+	});
+	
+	if (deadlines.size() > 2 * window.size() + RetryWindow::initialCapacity)
+		compactDeadlines();
+}
 
-	if (window.empty())
-		return nullptr;
+const Retrier::Deadline *Retrier::nextDeadline()
+{
+	while (!deadlines.empty())
+	{
+		auto &deadline = deadlines.top();
 		
-	if (!priority.empty())
+		auto retry = window.find(deadline.id);
+		if (retry && retry->generation == deadline.generation)
+			return &deadline;
+			
+		deadlines.pop();
+	}
+	
+	return nullptr;
+}
+
+void Retrier::compactDeadlines()
+{
+	Vector<Deadline> live;
+	live.reserve(window.size());
+	
+	for (PacketID id = window.first; id != window.end; ++id)
 	{
-		auto i = window.find(*priority.begin());
-		debug_assert(i != window.end());
-		return i->second;
+		if (auto retry = window.find(id))
+		{
+			live.push_back(Deadline {
+				.at = retry->retryAt,
+				.id = id,
+				.generation = retry->generation,
+				.priority = retry->priority
+			});
+		}
 	}
 	
-	return window.begin()->second;
+	deadlines = decltype(deadlines)(Later(), std::move(live));
 }
 
-Retrier::InsertResult Retrier::insert(const MultiPacketPath &packetPaths, const Timepoint &now, bool priority)
+Retrier::InsertResult Retrier::insert(const MultiPacketPath &packetPaths, const Timepoint &now, bool priority, const Optional<Expiry> &expiry)
 {
 	bool wasEmpty = false;
-	bool wasPriority = false;
+	bool isEarliest = false;
+	bool refused = false;
 	debug_assert(!packetPaths.empty());
 	
 	// scoped lock
@@ -69,69 +115,122 @@ Retrier::InsertResult Retrier::insert(const MultiPacketPath &packetPaths, const
 		
 		auto id = packetPaths.front().packet->header.id;
 		
-		auto retry = strong<Retry>(Retry {
+		auto earliest = nextDeadline();
+		auto earliestAt = earliest ? earliest->at : Timepoint::max();
+		
+		auto retry = window.insert(id, Retry {
 			.paths = packetPaths,
 			.sentAt = now,
-			.priority = priority
+			.priority = priority,
+			.expiry = expiry
 		});
 		
-		auto insertion = window.try_emplace(id, retry);
-		debug_assert(insertion.second);
-		
-		if (priority)
+		if (retry)
 		{
-			this->priority.insert(id);
-			wasPriority = true;
+			pushDeadline(id, *retry);
+			isEarliest = retry->retryAt < earliestAt;
 		}
+		else
+		{
+			sLogRelease("mrudp::retry", logOfThis(this) << "retry window overflow " << logVar(id) << logVar(window.first) << logVar(window.end));
+			refused = true;
+		}
+	}
+	
+	// the packet could never be resent, so the connection can not be kept
+	if (refused)
+	{
+		sender->connection->fail(MRUDP_EVENT_TIMEOUT);
+		return { false };
 	}
 	
-	if (wasEmpty || wasPriority)
+	if (isEarliest)
 		recalculateRetryTimeout();
 		
+	scheduleProbe(now);
+		
 	return { wasEmpty };
 }
 
 Retrier::AckResult Retrier::ack(PacketID packetID, const Timepoint &now, u16 delayedMS)
 {
-	auto lock = lock_of(mutex);
+	AckRange range { packetID, 1 };
+	auto result = ack(&range, 1, packetID, now, delayedMS);
+	
+	if (!result.contained)
+	{
+		sLogRelease("debug", logOfThis(this) << "ack for nothing " << logVar(packetID));
+	}
+	
+	return result;
+}
 
-	bool wasFirst = false;
-	bool wasPriority = false;
-	bool contained = false;
-	float rtt = 0;
+Retrier::AckResult Retrier::ack(const AckRange *ranges, size_t count, PacketID latest, const Timepoint &now, u16 delayedMS)
+{
+	auto lock = lock_of(mutex);
 
-	auto i = window.find(packetID);
-	if (i != window.end())
+	AckResult result {
+		.contained = false,
+		.needsRetryTimeoutRecalculation = false,
+		.rtt = 0,
+		.retried = false,
+		.acked = 0,
+		.sampled = false
+	} ;
+	
+	auto earliest = nextDeadline();
+	auto earliestAt = earliest ? earliest->at : Timepoint::max();
+	
+	for (size_t i=0; i<count && !window.empty(); ++i)
 	{
-		contained = true;
+		AckRange range;
+		small_copy((char *)&range, (const char *)&ranges[i], sizeof(range));
 		
-		wasFirst = i == window.begin();
-		auto &retry = i->second;
-
-		auto duration = now - retry->sentAt - Duration(delayedMS);
-		rtt = std::chrono::duration_cast<std::chrono::duration<float>>(duration).count();
-
-		if (retry->priority)
-		{
-			wasPriority = true;
-
-			auto j = priority.find(packetID);
-			if (j != priority.end())
-				priority.erase(j);
-		}
-
-		window.erase(i);
+		// the range relative to the start of the window, clamped to the window,
+		// which also takes care of a range that wraps
+		auto first = window.first;
+		int from = (int16_t)PacketID(range.first - first);
+		int to = from + range.count;
+		
+		from = std::max(from, 0);
+		to = std::min(to, (int)window.span());
+		
+		for (auto offset = from; offset < to; ++offset)
+			ack_(PacketID(first + offset), latest, now, delayedMS, result);
 	}
-	else
+	
+	if (result.acked > 0)
 	{
-		sLogRelease("debug", logOfThis(this) << "ack for nothing " << logVar(packetID));
+		auto next = nextDeadline();
+		result.needsRetryTimeoutRecalculation = !next || next->at != earliestAt;
+	}
+	
+	result.contained = result.acked > 0;
+	return result;
+}
+
+void Retrier::ack_(PacketID id, PacketID latest, const Timepoint &now, u16 delayedMS, AckResult &result)
+{
+	auto retry = window.find(id);
+	if (!retry)
+		return;
+		
+	if (!largestAcked || id_greater_than(id, *largestAcked))
+	{
+		largestAcked = id;
+		largestAckedSentAt = retry->sentAt;
 	}
 	
-	return {
-		.contained = contained,
-		.needsRetryTimeoutRecalculation = wasFirst || wasPriority,
-		.rtt = rtt
-	};
+	if (id == latest)
+	{
+		auto duration = now - retry->sentAt - Duration(delayedMS);
+		result.rtt = std::chrono::duration_cast<std::chrono::duration<float>>(duration).count();
+		result.retried = retry->attempts > 0 || retry->probed;
+		result.sampled = true;
+	}
+
+	window.erase(id);
+	result.acked++;
 }
 
 size_t Retrier::numUnacked()
@@ -141,96 +240,317 @@ size_t Retrier::numUnacked()
 	return window.size();
 }
 
+bool Retrier::hasRoomForData()
+{
+	auto lock = lock_of(mutex);
+	
+	return window.span() < maximumDataSpan;
+}
+
 bool Retrier::empty ()
 {
 	auto lock = lock_of(mutex);
 	return window.empty();
 }
 
-float Retrier::calculateRetryDuration(float rtt)
+float Retrier::calculateRetryDuration(size_t attempts)
 {
-	auto delayedAckContribution = 30/1000.0f;
-	return 2 * rtt + delayedAckContribution;
+	return sender->rtt.timeout(attempts);
 }
 
 void Retrier::recalculateRetryTimeout()
 {
-	auto retry = getNextRetry();
-	if (retry)
+	Optional<Timepoint> at;
+	
 	{
-		auto interval = toDuration(calculateRetryDuration(sender->rtt.duration));
+		auto lock = lock_of(mutex);
+		if (auto deadline = nextDeadline())
+		{
+			// the rtt may have shrunk since the deadline was set
+			auto retry = window.find(deadline->id);
+			auto retryAt = retry->sentAt + toDuration(calculateRetryDuration(retry->attempts));
+			
+			at = std::min(deadline->at, retryAt);
+		}
+	}
+	
+	if (at)
+		timeout.schedule(*at);
+}
 
-		retry->retryAt = retry->sentAt + interval;
-		timeout.schedule(retry->retryAt);
+Retrier::Resend Retrier::markResent(PacketID id, Retry &retry, const Timepoint &now)
+{
+	if (retry.expired(now))
+	{
+		Resend resend {
+			.sentAt = retry.sentAt,
+			.attempts = retry.attempts,
+			.expired = retry.expiry
+		} ;
+		
+		window.erase(id);
+		return resend;
 	}
+
+	const auto &paths = retry.paths;
+	
+	Resend resend {
+		.paths = paths,
+		.sentAt = retry.sentAt
+	} ;
+	
+	retry.attempts++;
+	retry.sentAt = now;
+	resend.attempts = retry.attempts;
+	
+	pushDeadline(id, retry);
+	
+	return resend;
 }
 
-void Retrier::onRetryTimeout()
+void Retrier::resend(Resend &resend, const Timepoint &now, bool lost)
 {
-	auto now = sender->connection->socket->service->clock.now();
+	auto connection = sender->connection;
 	
-	auto retry = getNextRetry();
-	if (!retry)
-		return;
+	sLogReleaseIf(resend.attempts > 8, "mrudp::retry::lots", logOfThis(this) << logVar(resend.attempts));
 
-	if (now > retry->retryAt)
+	if (resend.expired)
 	{
-		xLogDebug(logOfThis(this) << logVar(retry));
+		sender->skip(*resend.expired);
+		connection->statistics.onExpire(1);
+	}
+
+	for (auto &path: resend.paths)
+	{
+		auto &header = path.packet->header;
+		(void)header;
+
+		sLogDebug("mrudp::retry", logOfThis(this) << logLabelVar("local", toString(connection->socket->getLocalAddress())) << logLabelVar("remote", toString(connection->remoteAddress))<< logLabel("retrying") << logVarV(header.id) << logVarV((char)header.type) << logVar(resend.attempts) << "rtt.duration " << sender->rtt.duration);
+
+		xTraceChar(this, path.packet->header.id, '0' + (char)resend.attempts, (char)path.packet->header.type);
+		if (path.address)
+		{
+			connection->resend(path.packet, &*path.address);
+		}
+		else
+		{
+			connection->resend(path.packet);
+		}
+	}
+
+	if (lost)
+		sender->congestion.onRetry(connection->options.congestion_control, now, resend.sentAt, sender->rtt.duration);
+}
+
+size_t Retrier::resendLost(const Timepoint &now)
+{
+	Vector<Resend> lost;
+	
+	{
+		auto lock = lock_of(mutex);
 		
-		auto connection = sender->connection;
+		if (status == CLOSED || !largestAcked)
+			return 0;
+			
+		auto lossDelay = toDuration(lossTimeThreshold * sender->rtt.duration);
 		
-		if(retry->attempts >= maximumAttempts)
+		// the packets before the largest acked, in the order they were sent
+		for (PacketID id = window.first; id != window.end && id_greater_than(*largestAcked, id); ++id)
 		{
-			auto &header = retry->paths.front().packet->header;
-			(void)header;
+			auto retry = window.find(id);
+			if (!retry)
+				continue;
+				
+			// only a packet sent before one which was acked can be lost, this
+			// also keeps a packet which was just resent from being resent again
+			if (retry->sentAt > largestAckedSentAt)
+				continue;
+				
+			// the last attempt is left to the retry timeout, which fails the
+			// connection
+			if (retry->attempts + 1 >= (size_t)maximumAttempts && !retry->expired(now))
+				continue;
+				
+			PacketID gap = *largestAcked - id;
+			if (gap >= lossPacketThreshold || now - retry->sentAt >= lossDelay)
+				lost.push_back(markResent(id, *retry, now));
+		}
+	}
+	
+	for (auto &resend_: lost)
+		resend(resend_, now);
+		
+	return lost.size();
+}
 
-			sLogDebug("mrudp::retry", logOfThis(this) << logLabelVar("local", toString(connection->socket->getLocalAddress())) << logLabelVar("remote", toString(connection->remoteAddress)) << logLabel("FAILING") << logVarV(header.id) << logVarV((char)header.type) << logVar(retry->attempts) << "rtt.duration " << sender->rtt.duration);
+void Retrier::scheduleProbe(const Timepoint &now)
+{
+	auto &rtt = sender->rtt;
+	
+	// before the rtt is known, or when the retry timeout would come first, the
+	// retry timeout is left to find the loss
+	auto probeDuration = rtt.probeTimeout();
+	if (!rtt.sampled || !(probeDuration < rtt.timeout()))
+		return;
+		
+	Optional<Timepoint> at;
+	
+	{
+		auto lock = lock_of(mutex);
+		
+		if (status == CLOSED || window.empty())
+		{
+			probeAt.reset();
+			return;
+		}
+		
+		probeAt = now + toDuration(probeDuration);
+		
+		if (!probeScheduled)
+		{
+			probeScheduled = true;
+			at = probeAt;
+		}
+	}
+	
+	if (at)
+		probeTimeout.schedule(*at);
+}
 
+void Retrier::onProbeTimeout()
+{
+	auto now = sender->connection->socket->service->clock.now();
+	
+	Optional<Resend> probe;
+	Optional<Timepoint> later;
 	
-			xTraceChar(this, header.id, 'F', (char)header.type);
-			connection->fail(MRUDP_EVENT_TIMEOUT);
+	{
+		auto lock = lock_of(mutex);
+		probeScheduled = false;
+		
+		if (status == CLOSED || window.empty() || !probeAt)
+			return;
+			
+		// a send or ack since the timeout was scheduled has pushed the probe back
+		if (now < *probeAt)
+		{
+			probeScheduled = true;
+			later = probeAt;
 		}
 		else
 		{
-			sLogRelease("mrudp::ack_failure",
-				logOfThis(this) << "ack failure " <<
-				logLabelVarV("id", retry->paths.front().packet->header.id) <<
-				logLabelVarV("duration", std::chrono::duration_cast<Duration>(now - retry->sentAt).count())
-			);
-
-			retry->attempts++;
-			retry->sentAt = connection->socket->service->clock.now();
-
-			sLogReleaseIf(retry->attempts > 8, "mrudp::retry::lots", logOfThis(this) << logVar(retry->attempts));
+			// only one probe until the next send or ack
+			probeAt.reset();
+			
+			// the newest unacked packet
+			auto id = PacketID(window.end - 1);
+			auto retry = window.find(id);
+			
+			while (!retry && id != window.first)
+				retry = window.find(--id);
+				
+			// the probe does not count as an attempt, so the retry timeout of the
+			// packet is not backed off
+			if (retry && retry->expired(now))
+			{
+				probe = markResent(id, *retry, now);
+			}
+			else
+			if (retry)
+			{
+				const auto &paths = retry->paths;
+				
+				probe = Resend {
+					.paths = paths,
+					.sentAt = retry->sentAt,
+					.attempts = retry->attempts
+				} ;
+				
+				retry->probed = true;
+				retry->sentAt = now;
+				pushDeadline(id, *retry);
+			}
+		}
+	}
+	
+	if (later)
+	{
+		probeTimeout.schedule(*later);
+		return;
+	}
+	
+	if (probe)
+	{
+		resend(*probe, now, false);
+		
+		if (!probe->expired)
+			sender->connection->statistics.onProbe(1);
+	}
+}
 
-			for (auto &path: retry->paths)
+void Retrier::onRetryTimeout()
+{
+	auto now = sender->connection->socket->service->clock.now();
+	
+	Vector<Resend> due;
+	bool failed = false;
+	
+	{
+		auto lock = lock_of(mutex);
+		
+		while (auto deadline = nextDeadline())
+		{
+			auto id = deadline->id;
+			auto retry = window.find(id);
+			
+			// the deadline was set with the rtt of when the packet was sent, the
+			// retry is due at whichever of it and the current timeout is earlier,
+			// but waits for the current timeout if that has grown
+			auto retryAt = retry->sentAt + toDuration(calculateRetryDuration(retry->attempts));
+			if (!(now > retryAt))
+			{
+				if (!(now > deadline->at))
+					break;
+					
+				deadlines.pop();
+				pushDeadline(id, *retry);
+				continue;
+			}
+			
+			deadlines.pop();
+			
+			if (retry->attempts >= (size_t)maximumAttempts && !retry->expired(now))
 			{
-				auto &header = path.packet->header;
+				auto &header = retry->paths.front().packet->header;
 				(void)header;
 
-				sLogDebug("mrudp::retry", logOfThis(this) << logLabelVar("local", toString(connection->socket->getLocalAddress())) << logLabelVar("remote", toString(connection->remoteAddress))<< logLabel("retrying") << logVarV(header.id) << logVarV((char)header.type) << logVar(retry->attempts) << "rtt.duration " << sender->rtt.duration);
-
-				xTraceChar(this, path.packet->header.id, '0' + (char)retry->attempts, (char)path.packet->header.type);
-				if (path.address)
-				{
-					connection->resend(path.packet, &*path.address);
-				}
-				else
-				{
-					connection->resend(path.packet);
-				}
+				sLogDebug("mrudp::retry", logOfThis(this) << logLabelVar("remote", toString(sender->connection->remoteAddress)) << logLabel("FAILING") << logVarV(header.id) << logVarV((char)header.type) << logVar(retry->attempts) << "rtt.duration " << sender->rtt.duration);
+
+				xTraceChar(this, header.id, 'F', (char)header.type);
+				failed = true;
+				break;
 			}
 
-			sender->rtt.onAckFailure();
-			sender->windowSize.onSample(sender->rtt.duration);
-			
-			recalculateRetryTimeout();
+			sLogRelease("mrudp::ack_failure",
+				logOfThis(this) << "ack failure " <<
+				logLabelVarV("id", id) <<
+				logLabelVarV("duration", std::chrono::duration_cast<Duration>(now - retry->sentAt).count())
+			);
+
+			due.push_back(markResent(id, *retry, now));
 		}
 	}
-	else
+	
+	if (failed)
 	{
-		recalculateRetryTimeout();
+		sender->connection->fail(MRUDP_EVENT_TIMEOUT);
+		return;
 	}
+	
+	for (auto &resend_: due)
+		resend(resend_, now);
+		
+	recalculateRetryTimeout();
 }
 
 } // namespace
@@ -2,6 +2,7 @@
 
 #include "../Packet.h"
 #include "../Scheduler.h"
+#include "RetryWindow.h"
 
 namespace timprepscius {
 namespace mrudp {
@@ -11,7 +12,7 @@ namespace mrudp {
 //
 // For reliability, the socket must retry packets that do not ack in an allowed
 // period of time. This is done by maintaining a window of all unacked packets, as
-// a map from their PacketID to the Retry structure.
+// a RetryWindow indexed by their PacketID.
 //
 // When a reliable packet is sent, it is first entered into the Retrier via
 // Retrier::insert.
@@ -19,36 +20,25 @@ namespace mrudp {
 // When an ack is received for a reliable packet, the Retry is removed using
 // Retrier::ack.
 //
-// When a Retry is either inserted or acked for the Retrier, a calculation may be
-// required of when a check should be made to retry the first waiting packet.
+// Each time a Retry is sent its deadline is pushed onto a min heap, and the retry
+// timeout is scheduled for the earliest deadline.  A deadline whose retry has
+// been acked or resent since is stale, and is dropped when it reaches the top.
 //
 // The calculation is made within Retrier::recalculateRetryTimeout
 // The decision of retrying a packet, or timing a connection out is made in Retrier::onRetryTimeout
+//
+// When the last packets of a burst are lost, there are no later acks to show the
+// loss.  So after each send or ack, a probe is scheduled for the probe timeout, and
+// if no ack has arrived by then the newest unacked packet is resent.  Its ack then
+// shows any loss before it to Retrier::resendLost.
+//
+// A packet sent with a deadline which is due to be resent after the deadline has
+// passed is dropped from the window, and its frames are sent again as SKIPPED
+// frames, see Sender::skip.
 // --------------------------------------------------------------------------------
 
 struct Sender;
 
-struct Retry
-{
-	MultiPacketPath paths;
-	Timepoint sentAt, retryAt;
-	
-	size_t attempts = 0;
-	bool priority = false;
-} ;
-
-//inline
-//bool operator<(const RetryPaths &lhs, const RetryPaths &rhs)
-//{
-//	auto &l = std::get<0>(lhs);
-//	auto &r = std::get<0>(rhs);
-//
-//	if (l.priority != r.priority)
-//		return l.priority < r.priority;
-//
-//	return l.sentAt > r.sentAt;
-//}
-
 struct Retrier
 {
 	enum Status {
@@ -68,10 +58,39 @@ struct Retrier
 	Mutex mutex;
 
 	// The window of reliable packets that have been sent, but not acked.
-	OrderedMap<PacketID, StrongPtr<Retry>> window;
-	Set<PacketID> priority;
+	RetryWindow window;
+	
+	struct Deadline
+	{
+		Timepoint at;
+		PacketID id;
+		u32 generation;
+		bool priority;
+	} ;
+	
+	// orders the heap by the earliest deadline, priority retries first on a tie
+	struct Later
+	{
+		bool operator()(const Deadline &lhs, const Deadline &rhs) const
+		{
+			if (lhs.at != rhs.at)
+				return lhs.at > rhs.at;
+				
+			return lhs.priority < rhs.priority;
+		}
+	} ;
+	
+	PriorityQueue<Deadline, Vector<Deadline>, Later> deadlines;
+	u32 generation = 0;
+	
+	// sets the retryAt of the retry, and pushes it as the next deadline
+	void pushDeadline(PacketID id, Retry &retry);
 	
-	StrongPtr<Retry> getNextRetry();
+	// drops stale deadlines, returns the earliest live one
+	const Deadline *nextDeadline();
+	
+	// rebuilds the heap from the window once it is mostly stale
+	void compactDeadlines();
 
 	struct InsertResult {
 		bool wasFirst;
@@ -80,13 +99,21 @@ struct Retrier
 	// Inserts a packet into the Retrier.
 	// Returns the InsertResult, where .wasFirst signifies that
 	// the recalculateRetryTimeout should be called
-	InsertResult insert(const MultiPacketPath &packetPaths, const Timepoint &now, bool priority);
+	InsertResult insert(const MultiPacketPath &packetPaths, const Timepoint &now, bool priority, const Optional<Expiry> &expiry = {});
 	
 	struct AckResult
 	{
 		bool contained;
 		bool needsRetryTimeoutRecalculation;
 		float rtt;
+		
+		// the packet was retried, so the rtt is ambiguous
+		bool retried;
+		
+		// the number of packets removed from the window, and whether the rtt
+		// was sampled from one of them
+		size_t acked;
+		bool sampled;
 	} ;
 	
 	// Signals to the Retrier that a packet was acked,
@@ -95,9 +122,25 @@ struct Retrier
 	// that recalculateRetryTimeout should be called
 	AckResult ack(PacketID, const Timepoint &now, u16 delayedMS);
 	
+	// Signals the Retrier that the packets of the ranges were acked, the rtt
+	// is sampled from the latest packet only
+	AckResult ack(const AckRange *ranges, size_t count, PacketID latest, const Timepoint &now, u16 delayedMS);
+	
+	// removes the retry of the id, if it is in the window
+	void ack_(PacketID id, PacketID latest, const Timepoint &now, u16 delayedMS, AckResult &result);
+	
 	// returns the number of outstanding unacked packets
 	size_t numUnacked();
 	
+	// the data queues stop short of the maximum span of the window, leaving room
+	// for the packets which are sent reliably outside of them
+	static constexpr size_t maximumDataSpan = RetryWindow::maximumCapacity - 1024;
+	
+	// returns whether another data packet fits in the window.  A lost packet which
+	// is being retried holds the start of the window, so the span of ids may pass
+	// the maximum with far fewer packets unacked.
+	bool hasRoomForData();
+	
 	// clears the any waiting retries
 	void close ();
 	
@@ -107,11 +150,58 @@ struct Retrier
 	// recalculates the retry timeout for the getNextRetry packet
 	void recalculateRetryTimeout ();
 	
-	// calculates the retry duration given an rtt
-	float calculateRetryDuration(float rtt);
+	// calculates the retry duration of a packet given its attempts so far
+	float calculateRetryDuration(size_t attempts);
 	
 	// does the retry mechanism, after checking that it should be done
 	void onRetryTimeout ();
+	
+	// The packets of a retry being resent, copied out of the window so they can be
+	// sent without holding the lock
+	struct Resend
+	{
+		MultiPacketPath paths = {};
+		Timepoint sentAt;
+		size_t attempts = 0;
+		
+		// the frames to skip instead, when the deadline of the packet has passed
+		Optional<Expiry> expired = {};
+	} ;
+	
+	// counts the attempt and pushes the new deadline of the retry, returns what
+	// must be resent.  An expired retry is removed from the window instead.
+	Resend markResent(PacketID id, Retry &retry, const Timepoint &now);
+	
+	// resends the packets, or skips their frames, and tells the congestion control
+	// of the loss if they were lost rather than probed
+	void resend(Resend &resend, const Timepoint &now, bool lost = true);
+	
+	// The largest packet acked, and when it was sent.  An unacked packet which
+	// was sent before it is lost once lossPacketThreshold packets past it have
+	// been acked, or it is lossTimeThreshold rtts old, and it is resent without
+	// waiting for its retry timeout.
+	static constexpr PacketID lossPacketThreshold = 3;
+	static constexpr float lossTimeThreshold = 9 / 8.0f;
+	
+	Optional<PacketID> largestAcked;
+	Timepoint largestAckedSentAt;
+	
+	// resends the packets which are deemed lost, returns the number resent
+	size_t resendLost(const Timepoint &now);
+	
+	// The tail loss probe, which is due at probeAt.  The timeout is only scheduled
+	// when it is not already, and when it fires early it is scheduled again for
+	// probeAt, so that a send need not reschedule it.
+	Timeout probeTimeout;
+	Optional<Timepoint> probeAt;
+	bool probeScheduled = false;
+	
+	// pushes the probe back to the probe timeout from now
+	void scheduleProbe(const Timepoint &now);
+	
+	// resends the newest unacked packet, if no ack has arrived since the probe
+	// was scheduled
+	void onProbeTimeout();
 };
 
 } // namespace
@@ -0,0 +1,125 @@
+#include "RetryWindow.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+RetryWindow::RetryWindow () :
+	slots(initialCapacity),
+	mask(initialCapacity - 1)
+{
+}
+
+Retry *RetryWindow::find(PacketID id)
+{
+	if (PacketID(id - first) >= span())
+		return nullptr;
+
+	auto &slot = slots[id & mask];
+	return slot.occupied ? &slot.retry : nullptr;
+}
+
+Retry *RetryWindow::insert(PacketID id, Retry &&retry)
+{
+	auto first_ = first, end_ = end;
+	
+	if (empty())
+	{
+		first_ = id;
+		end_ = id + 1;
+	}
+	else
+	{
+		// ids are usually inserted in order, but two senders may race between
+		// generating the id and inserting it
+		if (id_greater_than(first, id))
+			first_ = id;
+		else
+		if (!id_greater_than(end, id))
+			end_ = id + 1;
+	}
+
+	// past the maximum the ids can no longer be told apart, and the ring would
+	// reuse the slots of the oldest
+	size_t span_ = PacketID(end_ - first_);
+	if (span_ > maximumCapacity)
+		return nullptr;
+		
+	if (span_ > slots.size())
+		grow(span_);
+		
+	auto &slot = slots[id & mask];
+	if (slot.occupied)
+		return nullptr;
+		
+	first = first_;
+	end = end_;
+
+	slot.retry = std::move(retry);
+	slot.occupied = true;
+	count++;
+
+	return &slot.retry;
+}
+
+void RetryWindow::erase(PacketID id)
+{
+	auto &slot = slots[id & mask];
+	debug_assert(slot.occupied);
+
+	// release the packets now, rather than when the slot is reused
+	slot.retry = Retry();
+	slot.occupied = false;
+	count--;
+
+	if (count == 0)
+	{
+		first = end;
+		return;
+	}
+
+	if (id == first)
+	{
+		while (!slots[first & mask].occupied)
+			++first;
+	}
+	else
+	if (PacketID(id + 1) == end)
+	{
+		while (!slots[PacketID(end - 1) & mask].occupied)
+			--end;
+	}
+}
+
+void RetryWindow::clear ()
+{
+	for (auto &slot: slots)
+		slot = Slot();
+
+	count = 0;
+	first = end;
+}
+
+void RetryWindow::grow (size_t span)
+{
+	auto capacity = slots.size();
+	while (capacity < span)
+		capacity *= 2;
+
+	debug_assert(capacity <= maximumCapacity);
+
+	Vector<Slot> grown(capacity);
+	auto grownMask = capacity - 1;
+
+	for (PacketID id = first; id != end; ++id)
+	{
+		auto &slot = slots[id & mask];
+		if (slot.occupied)
+			grown[id & grownMask] = std::move(slot);
+	}
+
+	slots = std::move(grown);
+	mask = grownMask;
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,101 @@
+#pragma once
+
+#include "../Packet.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+// --------------------------------------------------------------------------------
+// RetryWindow
+//
+// The reliable packets which have been sent but not acked, stored inline in a
+// circular buffer indexed by PacketID modulo the capacity.
+//
+// Packet ids are handed out in order, so the unacked packets span a short run of
+// ids from first to end.  Finding, inserting and erasing a packet are a mask and
+// an index.  When an insert would make the span larger than the capacity, the
+// buffer doubles.
+//
+// Iterating from first to end walks the packets in the order they were sent, even
+// when the ids wrap.
+// --------------------------------------------------------------------------------
+
+// the frames of a packet sent with a deadline, which are skipped rather than
+// resent once it has passed
+struct Expiry
+{
+	Timepoint at;
+	StreamID stream;
+	FrameNumber first;
+	u16 frames;
+	bool unordered = false;
+} ;
+
+struct Retry
+{
+	MultiPacketPath paths;
+	Timepoint sentAt, retryAt;
+
+	size_t attempts = 0;
+	bool priority = false;
+	
+	// the packet was resent as a tail loss probe, so its rtt is ambiguous
+	bool probed = false;
+
+	// identifies the current deadline of the retry, see Retrier::Deadline
+	u32 generation = 0;
+	
+	Optional<Expiry> expiry;
+	
+	bool expired (const Timepoint &now) const
+	{
+		return expiry && !(now < expiry->at);
+	}
+} ;
+
+struct RetryWindow
+{
+	static constexpr size_t initialCapacity = 64;
+
+	// the span must stay inside half the id space for id_greater_than
+	static constexpr size_t maximumCapacity = size_t(1) << (sizeof(PacketID) * 8 - 1);
+
+	RetryWindow ();
+
+	struct Slot
+	{
+		Retry retry;
+		bool occupied = false;
+	} ;
+
+	Vector<Slot> slots;
+	size_t mask;
+
+	// the oldest unacked id, and one past the newest
+	PacketID first = 0, end = 0;
+	size_t count = 0;
+
+	bool empty () const { return count == 0; }
+	size_t size () const { return count; }
+
+	// the number of ids from first to end, occupied or not
+	size_t span () const { return PacketID(end - first); }
+
+	// returns the retry of the id, or nullptr if it is not in the window
+	Retry *find(PacketID id);
+
+	// inserts the retry, returns nullptr instead if the id is already in the window
+	// or the span would grow past the maximum capacity
+	Retry *insert(PacketID id, Retry &&retry);
+
+	// removes the retry of the id, which must be in the window
+	void erase(PacketID id);
+
+	void clear ();
+
+	// moves the current span into a buffer large enough for the span given
+	void grow (size_t span);
+} ;
+
+} // namespace
+} // namespace
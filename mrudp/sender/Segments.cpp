@@ -0,0 +1,64 @@
+#include "Segments.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+Segments::Segments(const mrudp_iovec_t *segments_, size_t count_) :
+	segments(segments_),
+	count(count_)
+{
+	for (size_t i=0; i<count; ++i)
+		size += segments[i].iov_len;
+}
+
+Segments::Segments(const u8 *data, size_t size_) :
+	segments(&single),
+	count(1),
+	size(size_)
+{
+	single.iov_base = (void *)data;
+	single.iov_len = size_;
+}
+
+void Segments::read(u8 *to, size_t size_)
+{
+	debug_assert(size_ <= size);
+	size -= size_;
+	
+	while (size_ > 0)
+	{
+		auto &from = segments[segment];
+		auto readSize = std::min(size_, from.iov_len - offset);
+		
+		mem_copy((char *)to, (char *)from.iov_base + offset, readSize);
+		to += readSize;
+		size_ -= readSize;
+		offset += readSize;
+		
+		if (offset == from.iov_len)
+		{
+			segment++;
+			offset = 0;
+		}
+	}
+}
+
+bool pushFrame(Packet &packet, const FrameHeader &header, Segments &segments)
+{
+	if (!pushData(packet, header))
+		return false;
+		
+	if (packet.dataSize > MAX_PACKET_SIZE - header.dataSize)
+	{
+		debug_assert(false);
+		return false;
+	}
+	
+	segments.read((u8 *)packet.data + packet.dataSize, header.dataSize);
+	packet.dataSize += header.dataSize;
+	
+	return true;
+}
+
+} // namespace
+} // namespace
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../Packet.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+// --------------------------------------------------------------------------------
+// Segments
+//
+// Segments is a message given as a list of buffers, as passed to mrudp_sendv.
+// The send queue reads it into packets, or into the compression buffer, piece by
+// piece, so the message is never flattened first.
+//
+// Reading advances through the segments, a Segments is read once.
+// --------------------------------------------------------------------------------
+
+struct Segments
+{
+	Segments(const mrudp_iovec_t *segments, size_t count);
+	Segments(const u8 *data, size_t size);
+	
+	Segments(const Segments &) = delete;
+	
+	const mrudp_iovec_t *segments;
+	size_t count;
+	mrudp_iovec_t single;
+	
+	// the number of bytes not yet read
+	size_t size = 0;
+	
+	size_t segment = 0;
+	size_t offset = 0;
+	
+	// copies the next size bytes, which must not be more than are left
+	void read(u8 *to, size_t size);
+} ;
+
+bool pushFrame(Packet &packet, const FrameHeader &header, Segments &segments);
+
+} // namespace
+} // namespace
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "../Base.h"
+
+namespace timprepscius {
+namespace mrudp {
+
+// --------------------------------------------------------------------------------
+// SendBuffer
+//
+// SendBuffer counts the bytes waiting in the send queues, those of a connection
+// and, as its parent, those of all the connections of the service.  A send is
+// refused while either is full, and the connection is told it is writable once
+// both have drained below half of their limits, see Sender::possiblyWritable.
+//
+// A limit of 0 is no limit.
+// --------------------------------------------------------------------------------
+
+struct SendBuffer
+{
+	SendBuffer *parent = nullptr;
+	
+	Atomic<size_t> size = 0;
+	size_t limit = 0;
+	
+	void add (size_t size_)
+	{
+		size += size_;
+		
+		if (parent)
+			parent->add(size_);
+	}
+	
+	void remove (size_t size_)
+	{
+		size -= size_;
+		
+		if (parent)
+			parent->remove(size_);
+	}
+	
+	bool full ()
+	{
+		return (limit && size >= limit) || (parent && parent->full());
+	}
+	
+	bool drained ()
+	{
+		return (!limit || size < limit / 2) && (!parent || parent->drained());
+	}
+} ;
+
+} // namespace
+} // namespace
@@ -23,24 +23,48 @@ void SendQueue::close()
 	{
 		status = CLOSED;
 		queue.clear();
+		compressionBuffers[0].resize(0);
+		shrink(size);
 	}
 }
 
-bool SendQueue::coalescePacket(FrameTypeID type, const u8 *data, size_t size)
+void SendQueue::grow (size_t size_)
 {
-	if (queue.empty())
+	size += size_;
+	
+	if (buffer)
+		buffer->add(size_);
+}
+
+void SendQueue::shrink (size_t size_)
+{
+	size -= size_;
+	
+	if (buffer)
+		buffer->remove(size_);
+}
+
+void SendQueue::push(Packet &packet, const FrameHeader &header, Segments &data)
+{
+	if (pushFrame(packet, header, data))
+		grow(sizeof(header) + header.dataSize);
+}
+
+bool SendQueue::coalescePacket(FrameTypeID type, Segments &data)
+{
+	if (queue.empty() || queue.back().deadline)
 		return false;
 		
-	auto &packet = *queue.back();
-	if (packet.dataSize + size + sizeof(FrameHeader) < MAX_PACKET_POST_FRAME_SIZE)
+	auto &packet = *queue.back().packet;
+	if (packet.dataSize + data.size + sizeof(FrameHeader) < MAX_PACKET_POST_FRAME_SIZE)
 	{
 		FrameHeader frameHeader {
-			.id = frameIDGenerator.nextID(),
+			.id = FrameID(frameIDGenerator.nextID()),
 			.type = type,
-			.dataSize = FrameHeader::Size(size),
+			.dataSize = FrameHeader::Size(data.size),
 		} ;
 		
-		pushFrame(packet, frameHeader, data);
+		push(packet, frameHeader, data);
 		
 		return true;
 	}
@@ -48,46 +72,40 @@ bool SendQueue::coalescePacket(FrameTypeID type, const u8 *data, size_t size)
 	return false;
 }
 
-bool SendQueue::coalesceStream(FrameTypeID type, const u8 *data, size_t size)
+bool SendQueue::coalesceStream(FrameTypeID type, Segments &data)
 {
-	if (queue.empty())
-	{
-		auto packet = strong<Packet>();
-		queue.push_back(packet);
-	}
+	if (queue.empty() || queue.back().deadline)
+		push_back();
 
-	auto offset = 0;
-	while (size > 0)
+	while (data.size > 0)
 	{
-		auto &packet = *queue.back();
+		auto &packet = *queue.back().packet;
 		auto availableWriteSize = MAX_PACKET_POST_FRAME_SIZE - int(packet.dataSize + sizeof(FrameHeader));
 		if (availableWriteSize > 0)
 		{
-			auto writeSize = std::min((size_t)availableWriteSize, size);
+			auto writeSize = std::min((size_t)availableWriteSize, data.size);
 		
 			FrameHeader frameHeader {
-				.id = frameIDGenerator.nextID(),
+				.id = FrameID(frameIDGenerator.nextID()),
 				.type = type,
 				.dataSize = FrameHeader::Size(writeSize),
 			} ;
 			
-			pushFrame(packet, frameHeader, data + offset);
-			
-			size -= writeSize;
-			offset += writeSize;
+			push(packet, frameHeader, data);
 		}
 		else
 		{
-			auto packet = strong<Packet>();
-			queue.push_back(packet);
+			push_back();
 		}
 	}
 		
 	return true;
 }
 
-bool SendQueue::coalesceStreamCompressed(FrameTypeID type, const u8 *data, size_t size)
+bool SendQueue::coalesceStreamCompressed(FrameTypeID type, Segments &data)
 {
+	auto size = data.size;
+
 	using BufferSize = u32;
 
 	auto &compressionBuffer = compressionBuffers[0];
@@ -105,9 +123,11 @@ bool SendQueue::coalesceStreamCompressed(FrameTypeID type, const u8 *data, size_
 	small_copy(p, (char *)&size_, sizeof(size_));
 	p += sizeof(size_);
 	
-	mem_copy(p, (char *)data, size);
+	data.read((u8 *)p, size);
 	p += size;
 	
+	grow(sizeof(type) + sizeof(BufferSize) + size);
+	
 	return true;
 }
 
@@ -162,51 +182,77 @@ void SendQueue::compress()
 	
 	small_copy(outSize_, (char *)&outSize, sizeof(BufferSize));
 	
-	coalesceStream(DATA_COMPRESSED, (u8*)compressed.data(), outSize);
+	// the uncompressed data is counted again as it is coalesced compressed
+	shrink(uncompressed.size());
+	
+	Segments data((u8*)compressed.data(), outSize);
+	coalesceStream(DATA_COMPRESSED, data);
 	compressed.resize(0);
 	uncompressed.resize(0);
 }
 
-bool SendQueue::coalesce(FrameTypeID type, const u8 *data, size_t size, CoalesceMode mode)
+bool SendQueue::coalesce(FrameTypeID type, Segments &data, CoalesceMode mode)
 {
 	if (mode == MRUDP_COALESCE_NONE)
 		return false;
 		
 	if (mode == MRUDP_COALESCE_PACKET)
-		return coalescePacket(type, data, size);
+		return coalescePacket(type, data);
 		
 	if (mode == MRUDP_COALESCE_STREAM)
-		return coalesceStream(type, data, size);
+		return coalesceStream(type, data);
 		
 	if (mode == MRUDP_COALESCE_STREAM_COMPRESSED)
-		return coalesceStreamCompressed(type, data, size);
+		return coalesceStreamCompressed(type, data);
 		
 	debug_assert(false);
 	return false;
 }
 
-void SendQueue::enqueue(FrameTypeID type, const u8 *data, size_t size, CoalesceMode mode)
+void SendQueue::enqueue(FrameTypeID type, Segments &data, CoalesceMode mode, const Optional<Timepoint> &deadline)
 {
 	auto lock = lock_of(mutex);
 	if (status == CLOSED)
 		return;
 		
-	if (coalesce(type, data, size, mode))
+	if (deadline)
+	{
+		// the data waiting to be compressed is numbered first, so that it keeps
+		// its place before the message
+		if (!compressionBuffers[0].empty())
+			compress();
+	}
+	else
+	if (coalesce(type, data, mode))
 		return;
 
-	auto packet = strong<Packet>();
+	auto &packet = push_back();
+	queue.back().deadline = deadline;
+	
 	FrameHeader frameHeader {
-		.id = frameIDGenerator.nextID(),
+		.id = FrameID(frameIDGenerator.nextID()),
 		.type = type,
-		.dataSize = FrameHeader::Size(size),
+		.dataSize = FrameHeader::Size(data.size),
 	} ;
 	
-	pushFrame(*packet, frameHeader, data);
+	push(packet, frameHeader, data);
+}
+
+Packet &SendQueue::push_back()
+{
+	auto packet = newPacket();
+	queue.push_back(Queued { packet, frameIDGenerator.nextID_ });
+	
+	return *packet;
+}
 
-	queue.push_back(packet);
+void SendQueue::enqueue(FrameTypeID type, const u8 *data, size_t size, CoalesceMode mode)
+{
+	Segments segments(data, size);
+	enqueue(type, segments, mode);
 }
 
-PacketPtr SendQueue::dequeue()
+PacketPtr SendQueue::dequeue(FrameNumber *first, Optional<Timepoint> *deadline)
 {
 	auto lock = lock_of(mutex);
 	if (status == CLOSED)
@@ -218,11 +264,30 @@ PacketPtr SendQueue::dequeue()
 	if (queue.empty())
 		return nullptr;
 		
-	auto packet = std::move(queue.front());
+	auto &front = queue.front();
+	auto packet = std::move(front.packet);
+	
+	if (first)
+		*first = front.first;
+		
+	if (deadline)
+		*deadline = front.deadline;
+		
+	shrink(packet->dataSize);
 	queue.pop_front();
 	return packet;
 }
 
+FrameNumber SendQueue::end()
+{
+	auto lock = lock_of(mutex);
+	
+	if (!compressionBuffers[0].empty())
+		compress();
+		
+	return frameIDGenerator.nextID_;
+}
+
 bool SendQueue::empty()
 {
 	auto lock = lock_of(mutex);
@@ -234,6 +299,7 @@ void SendQueue::clear ()
 	auto lock = lock_of(mutex);
 	compressionBuffers[0].resize(0);
 	queue.clear();
+	shrink(size);
 }
 
 } // namespace
@@ -2,6 +2,8 @@
 
 #include "../Packet.h"
 #include "IDGenerator.h"
+#include "Segments.h"
+#include "SendBuffer.h"
 
 namespace timprepscius {
 namespace mrudp {
@@ -29,25 +31,56 @@ struct SendQueue
 	Status status = OPEN;
 	using CoalesceMode = mrudp_coalesce_mode_t;
 
-	SendQueue(mrudp_coalesce_options_t *options);
+	SendQueue(mrudp_coalesce_options_t *options = nullptr);
 	~SendQueue ();
 
 	Mutex mutex;
 
 	mrudp_coalesce_options_t *options;
-	IDGenerator<FrameID> frameIDGenerator;
-	List<PacketPtr> queue;
+	IDGenerator<FrameNumber> frameIDGenerator;
+	
+	// the bytes of the packets queued and of the data waiting to be compressed,
+	// which are also counted in the buffer
+	size_t size = 0;
+	SendBuffer *buffer = nullptr;
+	
+	void grow (size_t size);
+	void shrink (size_t size);
+	
+	struct Queued
+	{
+		PacketPtr packet;
+		
+		// the number of the first frame in the packet
+		FrameNumber first;
+		
+		// a packet with a deadline holds one message, nothing is coalesced into it
+		Optional<Timepoint> deadline = {};
+	} ;
+	
+	List<Queued> queue;
 	SizedVector<char> compressionBuffers[2];
 
-	bool coalescePacket(FrameTypeID type, const u8 *data, size_t size);
-	bool coalesceStream(FrameTypeID type, const u8 *data, size_t size);
-	bool coalesceStreamCompressed(FrameTypeID type, const u8 *data, size_t size);
+	bool coalescePacket(FrameTypeID type, Segments &data);
+	bool coalesceStream(FrameTypeID type, Segments &data);
+	bool coalesceStreamCompressed(FrameTypeID type, Segments &data);
 	
 	void compress();
 
-	bool coalesce(FrameTypeID type, const u8 *data, size_t size, CoalesceMode mode);
+	bool coalesce(FrameTypeID type, Segments &data, CoalesceMode mode);
+	void enqueue(FrameTypeID type, Segments &data, CoalesceMode mode, const Optional<Timepoint> &deadline = {});
 	void enqueue(FrameTypeID type, const u8 *data, size_t size, CoalesceMode mode);
-	PacketPtr dequeue();
+	PacketPtr dequeue(FrameNumber *first = nullptr, Optional<Timepoint> *deadline = nullptr);
+	
+	// a new packet at the back of the queue, whose first frame will have the next id
+	Packet &push_back();
+	
+	// pushes the frame, counting its size
+	void push(Packet &packet, const FrameHeader &header, Segments &data);
+	
+	// the number the next frame enqueued will have, the frames waiting to be
+	// compressed are numbered first
+	FrameNumber end();
 	
 	bool empty();
 	void clear();
@@ -10,9 +10,20 @@ namespace mrudp {
 Sender::Sender(Connection *connection_) :
 	connection(connection_),
 	retrier(this),
-	dataQueue(&connection->options.coalesce_reliable),
 	unreliableDataQueue(&connection->options.coalesce_unreliable)
 {
+	for (auto &stream: streams)
+	{
+		stream.queue.options = &connection->options.coalesce_reliable;
+		stream.queue.buffer = &sendBuffer;
+	}
+		
+	unorderedDataQueue.options = &connection->options.coalesce_reliable;
+	unorderedDataQueue.buffer = &sendBuffer;
+	unreliableDataQueue.buffer = &sendBuffer;
+	
+	sendBuffer.parent = &connection->socket->service->sendBuffer;
+		
 	connection->socket->service->scheduler->allocate(
 		schedules[0].timeout,
 		[this]() {
@@ -33,7 +44,7 @@ Timepoint Sender::now()
 	return connection->socket->service->clock.now();
 }
 
-void Sender::processSchedule(Reliability mode)
+void Sender::processSchedule(Reliability mode, bool immediate)
 {
 	auto &schedule = schedules[(size_t)mode];
 
@@ -43,7 +54,17 @@ void Sender::processSchedule(Reliability mode)
 	{
 		auto lock = lock_of(schedule.mutex);
 		if (schedule.running)
+		{
+			// the processing which is running schedules itself again when it is done
+			if (immediate)
+			{
+				auto time = now();
+				if (!schedule.when || time < *schedule.when)
+					schedule.when = time;
+			}
+			
 			return;
+		}
 
 		debug_assert(!schedule.running);
 //		when = *schedule.when;
@@ -89,23 +110,189 @@ void Sender::processReliableDataQueue()
 	if (!isReadyToSend())
 		return;
 
+	// the packets which fit in the window are sent together as a run, so that the
+	// socket may hand them to the kernel as one segmented datagram
+	PacketRun run;
 	bool sentPacket;
 	
 	do
 	{
 		sentPacket = false;
 		
-		if (retrier.numUnacked() < windowSize.size)
+		auto unacked = retrier.numUnacked();
+		if (unacked < congestion.size && unacked < credit && retrier.hasRoomForData())
 		{
-			if (auto packet = dataQueue.dequeue())
+			StreamID stream;
+			FrameNumber first;
+			Optional<Timepoint> deadline;
+			bool unordered;
+			if (auto packet = dequeue(stream, first, deadline, unordered))
 			{
-				packet->header.type = DATA_RELIABLE;
 				sentPacket = true;
-				sendReliably(packet);
+				
+				Optional<Expiry> expiry;
+				if (deadline)
+				{
+					expiry = Expiry { *deadline, stream, first, countFrames(*packet), unordered };
+					
+					// the deadline passed while the packet waited for the window, so
+					// only the skip of its frames is sent
+					if (!(now() < *deadline))
+					{
+						packet->dataSize = 0;
+						pushSkipped(*packet, *expiry);
+						
+						expiry.reset();
+						connection->statistics.onExpire(1);
+					}
+				}
+				
+				prepareReliable(*packet, stream, first, unordered);
+				
+				MultiPacketPath multipath = { PacketPath { packet }};
+				insertReliably(multipath, false, expiry);
+				
+				run.push_back(packet);
 			}
 		}
 	}
 	while(sentPacket);
+	
+	if (!run.empty())
+		connection->send(run);
+}
+
+void Sender::prepareReliable(Packet &packet, StreamID stream, FrameNumber first, bool unordered)
+{
+	// the frames are processed as they arrive, so need neither their stream nor
+	// their numbers
+	if (unordered)
+	{
+		packet.header.type = DATA_RELIABLE_UNORDERED;
+		return;
+	}
+	
+	packet.header.type = DATA_RELIABLE;
+	
+	// the packet carries its stream, and with 32 bit numbers the high bits
+	// of the number of its first frame, see ReceiveQueue::onReceive
+	pushData(packet, stream);
+	
+	if (connection->handshake_options.isExtended())
+		pushData(packet, u16(first >> 16));
+	
+	// the acks waiting to be sent go with the packet, rather than in a
+	// packet of their own
+	piggybackAcks(packet);
+}
+
+u16 Sender::countFrames(const Packet &packet)
+{
+	u16 count = 0;
+	
+	for (size_t at = 0; at + sizeof(FrameHeader) <= packet.dataSize; ++count)
+	{
+		FrameHeader header;
+		small_copy((char *)&header, packet.data + at, sizeof(header));
+		at += sizeof(header) + header.dataSize;
+	}
+	
+	return count;
+}
+
+void Sender::pushSkipped(Packet &packet, const Expiry &expiry)
+{
+	for (u16 i=0; i<expiry.frames; ++i)
+	{
+		FrameHeader header {
+			.id = FrameID(expiry.first + i),
+			.type = SKIPPED,
+			.dataSize = 0
+		} ;
+		
+		pushData(packet, header);
+	}
+}
+
+void Sender::skip(const Expiry &expiry)
+{
+	auto packet = newPacket();
+	pushSkipped(*packet, expiry);
+	prepareReliable(*packet, expiry.stream, expiry.first, expiry.unordered);
+	
+	sendReliably(packet);
+}
+
+void Sender::onCredit (u16 credit_)
+{
+	auto previous = credit.exchange(credit_);
+	
+	if (credit_ > previous)
+		scheduleDataQueueProcessing(RELIABLE, true);
+}
+
+void Sender::sendCredit (u16 credit_)
+{
+	unreliableDataQueue.enqueue(
+		CREDIT_FRAME,
+		(const u8 *)&credit_, sizeof(credit_),
+		SendQueue::CoalesceMode::MRUDP_COALESCE_PACKET
+	);
+	
+	scheduleDataQueueProcessing(UNRELIABLE, true);
+}
+
+void Sender::setWeight (StreamID stream, u8 weight)
+{
+	streams[stream].weight = std::max(weight, (u8)1);
+}
+
+PacketPtr Sender::dequeue (StreamID &stream, FrameNumber &first, Optional<Timepoint> &deadline, bool &unordered)
+{
+	auto count = numStreams.load();
+	unordered = false;
+	
+	// with one stream there is nothing to share
+	if (count == 1 && unorderedDataQueue.empty())
+	{
+		stream = 0;
+		return dataQueue.dequeue(&first, &deadline);
+	}
+	
+	Stream *next = nullptr;
+	u64 nextPass = 0;
+	
+	for (int i=0; i<=count; ++i)
+	{
+		auto &candidate = i < count ? streams[i] : unorderedStream;
+		if (candidate.queue.empty())
+			continue;
+			
+		// a stream which has waited with nothing to send starts from the present,
+		// rather than taking the window until it has caught up
+		auto pass_ = std::max(candidate.pass, pass);
+		
+		if (!next || pass_ < nextPass)
+		{
+			next = &candidate;
+			nextPass = pass_;
+			stream = StreamID(i);
+		}
+	}
+	
+	if (!next)
+		return nullptr;
+		
+	pass = nextPass;
+	next->pass = nextPass + stride / next->weight;
+	
+	if (next == &unorderedStream)
+	{
+		stream = 0;
+		unordered = true;
+	}
+	
+	return next->queue.dequeue(&first, &deadline);
 }
 
 void Sender::processUnreliableDataQueue()
@@ -116,8 +303,16 @@ void Sender::processUnreliableDataQueue()
 	{
 		queueDelayedAcks();
 	
-		while (auto packet = unreliableDataQueue.dequeue())
+		Optional<Timepoint> deadline;
+		while (auto packet = unreliableDataQueue.dequeue(nullptr, &deadline))
 		{
+			// an unreliable packet whose deadline has passed is of no use to send
+			if (deadline && !(now() < *deadline))
+			{
+				connection->statistics.onExpire(1);
+				continue;
+			}
+			
 			packet->header.type = DATA_UNRELIABLE;
 			connection->send(packet);
 		}
@@ -135,7 +330,14 @@ bool Sender::isReadyToSend ()
 
 bool Sender::empty ()
 {
-	return retrier.empty() && dataQueue.empty();
+	if (!retrier.empty())
+		return false;
+		
+	for (int i=0; i<numStreams; ++i)
+		if (!streams[i].queue.empty())
+			return false;
+			
+	return unorderedDataQueue.empty();
 }
 
 void Sender::open()
@@ -161,9 +363,18 @@ void Sender::close()
 
 	if (status != CLOSED)
 	{
+		// the remote closes once the other streams have arrived up to their ends
+		Vector<StreamEnd> ends;
+		for (int i=1; i<numStreams; ++i)
+			ends.push_back(StreamEnd { StreamID(i), streams[i].queue.end() });
+			
+		auto unorderedEnd = unorderedDataQueue.end();
+		if (unorderedEnd != 0)
+			ends.push_back(StreamEnd { UNORDERED_STREAM, unorderedEnd });
+			
 		enqueue(
 			CLOSE_WRITE,
-			nullptr, 0,
+			(const u8 *)ends.data(), ends.size() * sizeof(StreamEnd),
 			RELIABLE,
 			MRUDP_COALESCE_PACKET
 		);
@@ -182,18 +393,27 @@ void Sender::fail()
 	}
 
 	retrier.close();
-	dataQueue.close();
+	
+	for (auto &stream: streams)
+		stream.queue.close();
+		
+	unorderedDataQueue.close();
 	unreliableDataQueue.close();
 }
 
-void Sender::sendReliablyMultipath(MultiPacketPath &multipath, bool priority)
+void Sender::insertReliably(MultiPacketPath &multipath, bool priority, const Optional<Expiry> &expiry)
 {
 	auto id = packetIDGenerator.nextID();
 	
 	for (auto &path: multipath)
 		path.packet->header.id = id;
 
-	retrier.insert(multipath, connection->socket->service->clock.now(), priority);
+	retrier.insert(multipath, connection->socket->service->clock.now(), priority, expiry);
+}
+
+void Sender::sendReliablyMultipath(MultiPacketPath &multipath, bool priority)
+{
+	insertReliably(multipath, priority);
 
 	for (auto &path: multipath)
 		connection->send(path.packet, path.address ? &*path.address : nullptr);
@@ -208,35 +428,83 @@ void Sender::sendReliably(const PacketPtr &packet, const Address *address)
 	sendReliablyMultipath(multipath, false);
 }
 
-void Sender::enqueue(FrameTypeID typeID, const u8 *data, size_t size, Reliability reliability, SendQueue::CoalesceMode mode)
+void Sender::enqueue(FrameTypeID typeID, Segments &data, Reliability reliability, SendQueue::CoalesceMode mode, StreamID stream, const Optional<Timepoint> &deadline)
 {
-	auto &dataQueue_ = reliability ? dataQueue : unreliableDataQueue;
+	auto &dataQueue_ =
+		reliability == RELIABLE_UNORDERED ? unorderedDataQueue :
+		reliability == RELIABLE ? streams[stream].queue :
+		unreliableDataQueue;
+	
+	// the window is shared between the streams up to the highest used
+	auto used = numStreams.load();
+	while (reliability == RELIABLE && stream >= used && !numStreams.compare_exchange_weak(used, stream + 1))
+	{
+		// intentionally left blank
+	}
 
 	dataQueue_.enqueue(
 		typeID,
-		data, size,
-		mode
+		data,
+		mode,
+		deadline
 	);
 	
 	if (isReadyToSend())
-		scheduleDataQueueProcessing(reliability);
+		scheduleDataQueueProcessing(reliability == UNRELIABLE ? UNRELIABLE : RELIABLE);
+}
+
+void Sender::enqueue(FrameTypeID typeID, const u8 *data, size_t size, Reliability reliability, SendQueue::CoalesceMode mode, StreamID stream)
+{
+	Segments segments(data, size);
+	enqueue(typeID, segments, reliability, mode, stream);
+}
+
+ErrorCode Sender::send(const u8 *data, size_t size, Reliability reliability, StreamID stream, const Optional<Timepoint> &deadline)
+{
+	Segments segments(data, size);
+	return send(segments, reliability, stream, deadline);
 }
 
-ErrorCode Sender::send(const u8 *data, size_t size, Reliability reliability)
+ErrorCode Sender::send(Segments &data, Reliability reliability, StreamID stream, const Optional<Timepoint> &deadline)
 {
 	if (status != CLOSED)
 	{
 		auto mode = reliability ?
 			(SendQueue::CoalesceMode)connection->options.coalesce_reliable.mode :
 			(SendQueue::CoalesceMode)connection->options.coalesce_unreliable.mode;
-
-		if (size > MAX_PACKET_DATA_SIZE &&
-			mode != MRUDP_COALESCE_STREAM &&
-			mode != MRUDP_COALESCE_STREAM_COMPRESSED
+			
+		// an unordered message can not be split between packets, as they may be
+		// processed in any order
+		if (reliability == RELIABLE_UNORDERED && mode != MRUDP_COALESCE_NONE)
+			mode = MRUDP_COALESCE_PACKET;
+
+		// a message with a deadline is sent in a packet of its own, so that it can
+		// be dropped whole
+		if (data.size > MAX_PACKET_DATA_SIZE &&
+			(deadline ||
+				(mode != MRUDP_COALESCE_STREAM &&
+				mode != MRUDP_COALESCE_STREAM_COMPRESSED))
 		)
 			return ERROR_PACKET_SIZE_TOO_LARGE;
+			
+		// the options may have been set since the last send
+		sendBuffer.limit = std::max(connection->options.send_buffer, 0);
+		
+		if (sendBuffer.full())
+		{
+			if (!blocked.exchange(true))
+			{
+				// the service drains by the sends of its other connections too
+				connection->socket->service->block(weak_this(connection));
+				
+				// the buffer may have drained before blocked was set
+				scheduleDataQueueProcessingAfter(RELIABLE, 0);
+			}
+			
+			return ERROR_WOULD_BLOCK;
+		}
 
-		enqueue(DATA, data, size, reliability, mode);
+		enqueue(DATA, data, reliability, mode, stream, deadline);
 		
 		return OK;
 	}
@@ -253,11 +521,14 @@ void Sender::scheduleDataQueueProcessing (Reliability reliability, bool immediat
 	if (options.mode == MRUDP_COALESCE_NONE)
 		return processDataQueue(reliability);
 
+	scheduleDataQueueProcessingAfter(reliability, immediate ? 0 : options.delay_ms);
+}
+
+void Sender::scheduleDataQueueProcessingAfter (Reliability reliability, int sendQueueProcessingDelay)
+{
 	debug_assert((size_t)reliability >= 0 && (size_t)reliability < 2);
 	auto &schedule = schedules[(size_t)reliability];
 	
-	auto sendQueueProcessingDelay =
-		immediate ? 0 : options.delay_ms;
 	auto now = connection->socket->service->clock.now();
 	auto then = now + Duration(sendQueueProcessingDelay);
 	
@@ -293,6 +564,15 @@ void Sender::processDataQueue(Reliability reliability)
 	{
 		processUnreliableDataQueue();
 	}
+	
+	possiblyWritable();
+	connection->socket->service->possiblyWritable();
+}
+
+void Sender::possiblyWritable ()
+{
+	if (blocked && sendBuffer.drained() && blocked.exchange(false))
+		connection->writable();
 }
 
 void Sender::onReceive(Packet &packet)
@@ -310,8 +590,42 @@ void Sender::onReceive(Packet &packet)
 	}
 }
 
-void Sender::ack(PacketID packetID)
+AckFrequency Sender::toAckFrequency(const mrudp_ack_options_t &options)
+{
+	return AckFrequency {
+		.packets = (u16)std::max(options.packets, (int16_t)1),
+		.delayMS = (u16)std::min(std::max(options.delay_ms, 0), maximumAckDelayMS)
+	} ;
+}
+
+void Sender::onAckFrequency(const AckFrequency &frequency)
+{
+	auto lock = lock_of(delayedAcksMutex);
+	
+	ackFrequency = AckFrequency {
+		.packets = std::max(frequency.packets, (u16)1),
+		.delayMS = std::min(frequency.delayMS, (u16)maximumAckDelayMS)
+	} ;
+}
+
+void Sender::requestAckFrequency(const mrudp_ack_options_t &options)
+{
+	auto frequency = toAckFrequency(options);
+	
+	enqueue(
+		ACK_FREQUENCY_FRAME,
+		(const u8 *)&frequency, sizeof(frequency),
+		RELIABLE,
+		MRUDP_COALESCE_PACKET
+	);
+}
+
+bool Sender::ack(PacketID packetID)
 {
+	bool inOrder;
+	bool immediate;
+	int delayMS;
+	
 	{
 		auto lock = lock_of(delayedAcksMutex);
 		DelayedAck ack {
@@ -319,9 +633,24 @@ void Sender::ack(PacketID packetID)
 			connection->socket->service->clock.now()
 		};
 		delayedAcks[0].push_back(ack);
+		
+		// a packet after a gap, a resent packet, or a duplicate
+		inOrder = !largestReceived || packetID == PacketID(*largestReceived + 1);
+		if (!largestReceived || id_greater_than(packetID, *largestReceived))
+			largestReceived = packetID;
+			
+		immediate = !inOrder || delayedAcks[0].size() >= ackFrequency.packets;
+		delayMS = ackFrequency.delayMS;
 	}
 	
-	scheduleDataQueueProcessing(UNRELIABLE);
+	// the scheduler runs timeouts on ticks of 10ms, so an immediate ack is sent
+	// from here rather than from a timeout
+	if (immediate)
+		processSchedule(UNRELIABLE, true);
+	else
+		scheduleDataQueueProcessingAfter(UNRELIABLE, delayMS);
+		
+	return inOrder;
 }
 
 void Sender::queueDelayedAcks()
@@ -342,21 +671,7 @@ void Sender::queueDelayedAcks()
 			std::swap(delayedAcks[0], delayedAcks[1]);
 		}
 		
-		for (auto &delayedAck: delayedAcks[1])
-		{
-			auto delayedMS = std::chrono::duration_cast<Duration>(now - delayedAck.when).count();
-			Ack ack {
-				.packetID = delayedAck.packetID,
-				.delayedMS = (u16)delayedMS
-			} ;
-			
-			unreliableDataQueue.enqueue(
-				ACK_FRAME,
-				(u8 *)&ack, sizeof(ack),
-				SendQueue::CoalesceMode::MRUDP_COALESCE_PACKET
-			);
-		}
-		
+		queueSacks(delayedAcks[1], now);
 		delayedAcks[1].clear();
 	}
 	
@@ -373,6 +688,141 @@ void Sender::queueDelayedAcks()
 	
 }
 
+Sack Sender::toAckRanges(Vector<DelayedAck> &acks, const Timepoint &now, Vector<AckRange> &ranges)
+{
+	debug_assert(!acks.empty());
+	
+	// the acks are appended as the packets arrive, so the last is the latest
+	auto &latest = acks.back();
+	auto delayedMS = std::chrono::duration_cast<Duration>(now - latest.when).count();
+	
+	Sack sack {
+		.latest = latest.packetID,
+		.delayedMS = (u16)delayedMS,
+		.credit = connection->receiver.credit()
+	} ;
+	
+	// the ids of one batch of acks are well within half the id space of each
+	// other, so the wrapping comparison orders them
+	std::sort(acks.begin(), acks.end(), [](auto &lhs, auto &rhs) {
+		return id_greater_than(rhs.packetID, lhs.packetID);
+	});
+	
+	AckRange range { acks.front().packetID, 1 };
+	
+	for (auto i = std::next(acks.begin()); i != acks.end(); ++i)
+	{
+		PacketID last = range.first + (range.count - 1);
+		
+		// a packet which was received twice is acked twice
+		if (i->packetID == last)
+			continue;
+		
+		if (i->packetID == PacketID(last + 1))
+		{
+			range.count++;
+			continue;
+		}
+		
+		ranges.push_back(range);
+		range = AckRange { i->packetID, 1 };
+	}
+	
+	ranges.push_back(range);
+	
+	return sack;
+}
+
+void Sender::queueSacks(Vector<DelayedAck> &acks, const Timepoint &now)
+{
+	if (acks.empty())
+		return;
+		
+	Vector<AckRange> ranges;
+	auto sack = toAckRanges(acks, now, ranges);
+	
+	queueSacks(sack, ranges);
+}
+
+void Sender::queueSacks(const Sack &sack, const Vector<AckRange> &ranges)
+{
+	const size_t maximumRanges = (MAX_PACKET_DATA_SIZE - sizeof(Sack)) / sizeof(AckRange);
+	
+	Vector<u8> frame;
+	
+	for (size_t i=0; i<ranges.size(); i += maximumRanges)
+	{
+		auto count = std::min(maximumRanges, ranges.size() - i);
+		
+		frame.clear();
+		frame.insert(frame.end(), (u8 *)&sack, (u8 *)&sack + sizeof(sack));
+		frame.insert(frame.end(), (u8 *)&ranges[i], (u8 *)&ranges[i + count]);
+		
+		unreliableDataQueue.enqueue(
+			SACK_FRAME,
+			frame.data(), frame.size(),
+			SendQueue::CoalesceMode::MRUDP_COALESCE_PACKET
+		);
+		
+		connection->statistics.onSendAck();
+	}
+}
+
+void Sender::piggybackAcks(Packet &packet)
+{
+	Vector<DelayedAck> acks;
+	
+	{
+		auto lock = lock_of(delayedAcksMutex);
+		if (delayedAcks[0].empty())
+			return;
+			
+		std::swap(delayedAcks[0], acks);
+	}
+	
+	auto now = this->now();
+	
+	Vector<AckRange> ranges;
+	auto sack = toAckRanges(acks, now, ranges);
+	
+	auto size = sizeof(sack) + ranges.size() * sizeof(AckRange) + sizeof(u8);
+	
+	if (ranges.size() <= maximumPiggybackedRanges &&
+		packet.dataSize + size <= MAX_PACKET_POST_FRAME_SIZE)
+	{
+		pushData(packet, sack);
+		pushData(packet, (const u8 *)ranges.data(), ranges.size() * sizeof(AckRange));
+		pushData(packet, u8(ranges.size()));
+		
+		packet.header.type = DATA_RELIABLE_WITH_ACKS;
+		connection->statistics.onPiggybackAck();
+		
+		return;
+	}
+	
+	// the acks do not fit, so are sent on their own
+	queueSacks(sack, ranges);
+	scheduleDataQueueProcessing(UNRELIABLE, true);
+}
+
+bool Sender::popPiggybackedAcks(Packet &packet, bool sample)
+{
+	u8 count;
+	if (!popData(packet, count) || count > maximumPiggybackedRanges)
+		return false;
+		
+	AckRange ranges[maximumPiggybackedRanges];
+	if (!popData(packet, (u8 *)ranges, count * sizeof(AckRange)))
+		return false;
+		
+	Sack sack;
+	if (!popData(packet, sack))
+		return false;
+		
+	onAck(sack, ranges, count, sample);
+	return true;
+}
+
 void Sender::onAck(const Packet &packet)
 {
 	onAck(Ack { packet.header.id, 0 });
@@ -380,25 +830,57 @@ void Sender::onAck(const Packet &packet)
 
 void Sender::onAck(const Ack &ack)
 {
-	auto packetID = ack.packetID;
-	
 	auto now = connection->socket->service->clock.now();
 	auto ackResult = retrier.ack(
-		packetID,
+		ack.packetID,
 		now,
 		ack.delayedMS
 	);
+	
+	onAck(ackResult, now);
+}
+
+void Sender::onAck(const Sack &sack, const AckRange *ranges, size_t count, bool sample)
+{
+	auto now = connection->socket->service->clock.now();
+	auto ackResult = retrier.ack(
+		ranges, count,
+		sack.latest,
+		now,
+		sack.delayedMS
+	);
+	
+	// the acks of a resent packet carry the credit of when it was first sent
+	if (!sample)
+		ackResult.sampled = false;
+	else
+		credit = sack.credit;
+	
+	onAck(ackResult, now);
+}
 
+void Sender::onAck(const Retrier::AckResult &ackResult, const Timepoint &now)
+{
 	if (ackResult.contained)
 	{
-		rtt.onSample(ackResult.rtt);
+		if (ackResult.sampled && !ackResult.retried)
+		{
+			rtt.onSample(ackResult.rtt);
+			connection->statistics.onRtt(rtt);
+		}
+		
+		auto sample = ackResult.sampled ? ackResult.rtt : 0;
+		congestion.onAck(connection->options.congestion_control, now, ackResult.acked, sample, rtt.duration);
 		
-		sLogDebug("mrudp::rtt_computation", logOfThis(this) << logVar(rtt.duration) << logVar(ackResult.rtt) << logVar(windowSize.size));
+		sLogDebug("mrudp::rtt_computation", logOfThis(this) << logVar(rtt.duration) << logVar(ackResult.rtt) << logVar(congestion.size));
 		
-		windowSize.onSample(rtt.duration);
+		auto resent = retrier.resendLost(now);
+		connection->statistics.onFastResend(resent);
 		
-		if (ackResult.needsRetryTimeoutRecalculation)
+		if (ackResult.needsRetryTimeoutRecalculation || resent > 0)
 			retrier.recalculateRetryTimeout();
+			
+		retrier.scheduleProbe(now);
 	}
 
 	scheduleDataQueueProcessing(RELIABLE, true);
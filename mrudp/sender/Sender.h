@@ -2,7 +2,7 @@
 
 #include "Retrier.h"
 #include "RTT.h"
-#include "WindowSize.h"
+#include "CongestionControl.h"
 #include "IDGenerator.h"
 #include "SendQueue.h"
 #include "../Scheduler.h"
@@ -32,6 +32,35 @@ struct Connection;
 // is received the sendQueue is processed (if more packets can be sent on a waiting
 // connection), and the connection is possibly closed (if a fin ack was received).
 //
+// The acks of received packets are delayed as the remote has asked, see
+// AckFrequency, until enough packets have arrived or the first has waited long
+// enough.  A packet which is not the one after the largest received is acked at
+// once, so that the remote learns of a loss quickly.
+//
+// When a reliable packet is sent, the acks waiting go with it in its trailer, see
+// Sender::piggybackAcks, and the delayed ack finds nothing left to send.
+//
+// Reliable data is sent on one of MAX_STREAMS streams, each with its own queue and
+// frame numbers, so that the remote orders each stream on its own.  The streams
+// with data waiting share the window by their weights, see Sender::dequeue.
+// Stream 0 carries the control frames.
+//
+// The reliable packets unacked are limited by the congestion window, and by the
+// credit of the remote, the packets of data it can yet hold, which it sends with
+// each ack, see Receiver::credit.
+//
+// Reliable unordered data has a queue of its own, which shares the window as a
+// stream does.  Its packets are acked and resent as the others, but carry neither
+// stream nor frame numbers, as the remote processes them as they arrive.
+//
+// The data waiting in the queues is counted in the SendBuffer, a send is refused
+// with ERROR_WOULD_BLOCK while it or that of the service is full.
+//
+// A message may be given a deadline, it is then sent in a packet of its own.  If
+// the deadline passes before the packet is sent, or before it must be resent, its
+// frames are sent as SKIPPED frames instead, see Sender::skip, which move the
+// remote past them.
+//
 // --------------------------------------------------------------------------------
 
 struct Sender
@@ -46,33 +75,91 @@ struct Sender
 	Connection *connection;
 	
 	Sender(Connection *connection_);
+	
+	// the bytes waiting in the queues, its parent is that of the service
+	SendBuffer sendBuffer;
+	
+	// set when a send is refused as the buffer is full, until the user is told the
+	// connection is writable
+	Atomic<bool> blocked = false;
+	void possiblyWritable ();
 
 	IDGenerator<PacketID> packetIDGenerator;
 	RTT rtt;
-	WindowSize windowSize;
+	CongestionControl congestion;
 	Retrier retrier;
-	SendQueue dataQueue;
+	
+	struct Stream
+	{
+		SendQueue queue;
+		Atomic<u8> weight = 1;
+		
+		// the virtual time the stream has been sent up to, each packet sent advances
+		// it by the stride divided by the weight
+		u64 pass = 0;
+	} ;
+	
+	static constexpr u64 stride = 1 << 16;
+	
+	Stream streams[MAX_STREAMS];
+	SendQueue &dataQueue = streams[0].queue;
+	
+	Stream unorderedStream;
+	SendQueue &unorderedDataQueue = unorderedStream.queue;
+	
+	// one past the highest stream which has been sent on, and the virtual time of
+	// the last packet sent
+	Atomic<int> numStreams = 1;
+	u64 pass = 0;
 	
 	SendQueue unreliableDataQueue;
 	
+	// the credit of the remote, from its latest ack or CREDIT_FRAME
+	Atomic<u16> credit = std::numeric_limits<u16>::max();
+	void onCredit (u16 credit);
+	
+	// sends the credit of this end in a CREDIT_FRAME
+	void sendCredit (u16 credit);
+	
+	void setWeight (StreamID stream, u8 weight);
+	
+	// the next packet of the stream with data waiting which has the least pass,
+	// the unordered stream taking part as another stream
+	PacketPtr dequeue (StreamID &stream, FrameNumber &first, Optional<Timepoint> &deadline, bool &unordered);
+	
+	// sets the type and trailers of a reliable packet of the stream
+	void prepareReliable(Packet &packet, StreamID stream, FrameNumber first, bool unordered = false);
+	
+	// sends SKIPPED frames in place of the frames of an expired packet
+	static u16 countFrames(const Packet &packet);
+	static void pushSkipped(Packet &packet, const Expiry &expiry);
+	void skip(const Expiry &expiry);
+	
 	void open ();
 	bool isReadyToSend ();
 
-	ErrorCode send(const u8 *data, size_t size, Reliability reliability);
+	ErrorCode send(const u8 *data, size_t size, Reliability reliability, StreamID stream = 0, const Optional<Timepoint> &deadline = {});
+	ErrorCode send(Segments &data, Reliability reliability, StreamID stream = 0, const Optional<Timepoint> &deadline = {});
 	
+	void insertReliably(MultiPacketPath &multipath, bool priority, const Optional<Expiry> &expiry = {});
 	void sendReliablyMultipath(MultiPacketPath &multipath, bool priority);
 	void sendReliably(const PacketPtr &packet, const Address *address = nullptr);
 	void onReceive (Packet &packet);
 	void onAck(const Packet &packet);
 	void onAck(const Ack &packet);
+	void onAck(const Sack &sack, const AckRange *ranges, size_t count, bool sample = true);
+	void onAck(const Retrier::AckResult &result, const Timepoint &now);
 	void close ();
 	void fail ();
 	
 	bool empty ();
 	
-	void enqueue(FrameTypeID type, const u8 *data, size_t size, Reliability reliability, SendQueue::CoalesceMode mode);
+	void enqueue(FrameTypeID type, const u8 *data, size_t size, Reliability reliability, SendQueue::CoalesceMode mode, StreamID stream = 0);
+	void enqueue(FrameTypeID type, Segments &data, Reliability reliability, SendQueue::CoalesceMode mode, StreamID stream = 0, const Optional<Timepoint> &deadline = {});
 	
-	void processSchedule(Reliability reliability);
+	// processes the data queue, unless it is being processed already, in which
+	// case an immediate processing is processed again once that is done
+	void processSchedule(Reliability reliability, bool immediate = false);
 	void processDataQueue(Reliability reliability);
 	void processReliableDataQueue ();
 	void processUnreliableDataQueue ();
@@ -89,6 +176,7 @@ struct Sender
 	// scheduler for reliable and unreliable
 	Schedule schedules[2];
 	void scheduleDataQueueProcessing (Reliability reliability, bool immediate=false);
+	void scheduleDataQueueProcessingAfter (Reliability reliability, int delayMS);
 	
 	struct DelayedAck {
 		PacketID packetID;
@@ -98,10 +186,43 @@ struct Sender
 	Mutex delayedAcksMutex;
 	Vector<DelayedAck> delayedAcks[2];
 	Timepoint lastDelayedAcksSend;
+	
+	// the ack frequency the remote asked for, and the largest packet received
+	AckFrequency ackFrequency { 1, 0 };
+	Optional<PacketID> largestReceived;
+	
+	// a delay which leaves the retry timeout of the remote enough allowance
+	static constexpr int maximumAckDelayMS = int((RTT::maximumAckDelay - RTT::granularity) * 1000);
+	static AckFrequency toAckFrequency(const mrudp_ack_options_t &options);
+	
+	// acks as the remote asked, the frequency is clamped as it is untrusted
+	void onAckFrequency(const AckFrequency &frequency);
+	
+	// sends an ACK_FREQUENCY_FRAME asking the remote to ack as given
+	void requestAckFrequency(const mrudp_ack_options_t &options);
 
-	void ack(PacketID packetID);
+	// acks the packet, returns whether it was the one after the largest received
+	bool ack(PacketID packetID);
 	void queueDelayedAcks();
 	
+	// sorts the acks and merges them into ranges, returns the Sack of the latest
+	Sack toAckRanges(Vector<DelayedAck> &acks, const Timepoint &now, Vector<AckRange> &ranges);
+	
+	// enqueues SACK_FRAMEs for the acks
+	void queueSacks(Vector<DelayedAck> &acks, const Timepoint &now);
+	void queueSacks(const Sack &sack, const Vector<AckRange> &ranges);
+	
+	// A reliable packet carries the acks waiting in its trailer, as a Sack, its
+	// AckRanges and their count, and becomes DATA_RELIABLE_WITH_ACKS.  If they do
+	// not fit they are sent on their own.
+	//
+	// A packet which is resent carries the acks of when it was first sent, so the
+	// rtt is only sampled from the acks of a packet which arrived in order.
+	static constexpr size_t maximumPiggybackedRanges = 32;
+	
+	void piggybackAcks(Packet &packet);
+	bool popPiggybackedAcks(Packet &packet, bool sample);
+	
 	Timepoint now();
 };
 
@@ -49,7 +49,7 @@ struct WindowSizeSimple
 	}
 } ;
 
-typedef WindowSizeSimple WindowSize;
+// the window is chosen per connection by CongestionControl
 
 } // namespace
 } // namespace
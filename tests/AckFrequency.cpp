@@ -0,0 +1,147 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("ack frequency")
+{
+	auto numPacketsToSend = 256;
+
+    GIVEN( "mrudp service, remote socket, the local end asking for an ack every 32 packets" )
+    {
+		Packet packet(512);
+		for (auto i=0; i<packet.size(); ++i)
+			packet[i] = i % 255;
+
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+		options.ack.packets = 32;
+		options.ack.delay_ms = 20;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service();
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				remote.packetsReceived++;
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept(
+					connection,
+					&remoteConnectionDispatch,
+					connectionReceive,
+					connectionClose
+				);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto connection = mrudp_connect_ex(
+			local.sockets.back(), &remoteAddress,
+			&options,
+			&localConnectionDispatch, connectionReceive, connectionClose
+		);
+		local.connections.insert(connection);
+		
+		auto sendAndCountAcks = [&](int count) {
+			auto sent = remote.packetsReceived.load();
+			
+			// paced, so that the packets arrive apart rather than being read in
+			// one batch and acked together
+			for (auto i=0; i<count; ++i)
+			{
+				mrudp_send(connection, packet.data(), (int)packet.size(), 1);
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+
+			wait_until(
+				std::chrono::seconds(10),
+				[&]() { return remote.packetsReceived == sent + count; }
+			);
+			
+			// the acks of the last packets
+			wait_until(
+				std::chrono::seconds(10),
+				[&]() {
+					mrudp_connection_state_t state;
+					mrudp_connection_state(connection, &state);
+					return state.packets_awaiting_ack == 0;
+				}
+			);
+			
+			auto lock = lock_of(remote.connectionsMutex);
+			mrudp_connection_statistics_t statistics;
+			mrudp_connection_statistics(*remote.connections.begin(), &statistics);
+			
+			return (int)statistics.acks_sent;
+		} ;
+
+		WHEN(numPacketsToSend << " reliable packets are sent a millisecond apart")
+		{
+			auto acks = sendAndCountAcks(numPacketsToSend);
+			
+			THEN("they all arrive, and the remote acks far fewer times than once a packet")
+			{
+				REQUIRE(remote.packetsReceived == numPacketsToSend);
+				REQUIRE(acks < numPacketsToSend / 4);
+			}
+			
+			WHEN("the local end asks for an ack every packet, and sends as many again")
+			{
+				mrudp_ack_options_t eager { .packets = 1, .delay_ms = 0 };
+				REQUIRE(mrudp_connection_ack_frequency(connection, &eager) == MRUDP_OK);
+				
+				auto moreAcks = sendAndCountAcks(numPacketsToSend) - acks;
+				
+				THEN("the remote acks many more times")
+				{
+					REQUIRE(remote.packetsReceived == 2 * numPacketsToSend);
+					REQUIRE(moreAcks > 4 * acks);
+				}
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,141 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("retained buffers")
+{
+	auto numPacketsToSend = 256;
+
+    GIVEN( "mrudp service, remote socket" )
+    {
+		auto options = mrudp_default_connection_options();
+
+		auto options_no_coalesce = options;
+		options_no_coalesce.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+		options_no_coalesce.coalesce_unreliable.mode = MRUDP_COALESCE_NONE;
+
+		auto options_coalesce_stream_compressed = options;
+		options_coalesce_stream_compressed.coalesce_reliable.mode = MRUDP_COALESCE_STREAM_COMPRESSED;
+		options_coalesce_stream_compressed.coalesce_reliable.compression_level = 9;
+
+		List<std::tuple<String, mrudp_connection_options_t>> availableOptions = {
+			{ "no coalesce", options_no_coalesce },
+			{ "coalesce stream compressed", options_coalesce_stream_compressed },
+		};
+
+		for (auto &[name, connectionOptions]: availableOptions)
+		{
+			WHEN(name)
+			{
+				mrudp_addr_t anyAddress;
+				mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+				State remote("remote");
+				remote.service = mrudp_service();
+				remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+				mrudp_addr_t remoteAddress;
+				mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+				State local("local");
+				local.service = mrudp_service();
+
+				Vector<mrudp_buffer_t> buffers;
+
+				auto remoteConnectionDispatch = Connection {
+					.receive = [&](auto data, auto size, auto isReliable) {
+						auto lock = lock_of(remote.packetsMutex);
+						buffers.push_back(mrudp_buffer_retain(data, size));
+						remote.packetsReceived++;
+						return 0;
+					},
+					.close = [&](auto event) {
+						return 0;
+					}
+				} ;
+
+				auto listen = Listener {
+					.accept = [&](auto connection) {
+						auto l = lock_of(remote.connectionsMutex);
+						remote.connections.insert(connection);
+
+						mrudp_accept(
+							connection,
+							&remoteConnectionDispatch,
+							connectionReceive,
+							connectionClose
+						);
+
+						return 0;
+					},
+					.close = [&](auto event) { return 0; }
+				} ;
+
+				mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+				local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+				auto localConnectionDispatch = Connection {
+					.receive = [&](auto data, auto size, auto isReliable) {
+						return 0;
+					},
+					.close = [&](auto event) {
+						return 0;
+					}
+				} ;
+
+				auto connection = mrudp_connect_ex(
+					local.sockets.back(), &remoteAddress,
+					&connectionOptions,
+					&localConnectionDispatch, connectionReceive, connectionClose
+				);
+				local.connections.insert(connection);
+
+				WHEN(numPacketsToSend << " reliable packets are sent and retained on receipt")
+				{
+					for (auto i=0; i<numPacketsToSend; ++i)
+					{
+						Packet packet(64 + i, 'a' + i % 26);
+						mrudp_send(connection, packet.data(), (int)packet.size(), 1);
+					}
+
+					wait_until(
+						std::chrono::seconds(10),
+						[&]() { return remote.packetsReceived == numPacketsToSend; }
+					);
+
+					THEN("the buffers still hold their data after later receives")
+					{
+						auto lock = lock_of(remote.packetsMutex);
+						REQUIRE(buffers.size() == numPacketsToSend);
+
+						auto i = 0;
+						for (auto buffer: buffers)
+						{
+							Packet packet(64 + i, 'a' + i % 26);
+							auto data = mrudp_buffer_data(buffer);
+							REQUIRE(mrudp_buffer_size(buffer) == packet.size());
+							REQUIRE(Packet(data, data + mrudp_buffer_size(buffer)) == packet);
+							++i;
+						}
+					}
+
+					auto lock = lock_of(remote.packetsMutex);
+					for (auto buffer: buffers)
+						mrudp_buffer_release(buffer);
+						
+					buffers.clear();
+				}
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,147 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("busy poll")
+{
+	auto numPacketsToSend = 1024;
+
+    GIVEN( "mrudp busy polled service, remote socket" )
+    {
+		Packet packet(1024);
+		for (auto i=0; i<packet.size(); ++i)
+			packet[i] = i % 255;
+
+		mrudp_options_asio_t options;
+		REQUIRE(mrudp_default_options(MRUDP_IMP_ASIO, &options) == MRUDP_OK);
+		options.connection.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+		options.connection.coalesce_unreliable.mode = MRUDP_COALESCE_NONE;
+
+		// the remote spins on the first cpu, the local service sleeps as usual
+		auto polledOptions = options;
+		polledOptions.busy_poll = 1;
+		polledOptions.busy_poll_us = 50;
+		polledOptions.cpu_affinity = 1;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service_ex(MRUDP_IMP_ASIO, &polledOptions);
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service_ex(MRUDP_IMP_ASIO, &options);
+
+		std::atomic<int> remoteConnectionsClosed = 0;
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				auto lock = lock_of(remote.packetsMutex);
+				remote.packets.push_back(Packet(data, data+size));
+				remote.packetsReceived++;
+				remote.bytesReceived += size;
+				return 0;
+			},
+			.close = [&](auto event) {
+				remoteConnectionsClosed++;
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept(
+					connection,
+					&remoteConnectionDispatch,
+					connectionReceive,
+					connectionClose
+				);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		local.connections.insert(
+			mrudp_connect_ex(
+				local.sockets.back(), &remoteAddress,
+				&options.connection,
+				&localConnectionDispatch, connectionReceive, connectionClose
+			)
+		);
+
+		WHEN(numPacketsToSend << " reliable packets are sent")
+		{
+			auto connection = *local.connections.begin();
+			for (auto i=0; i<numPacketsToSend; ++i)
+			{
+				packet[0] = i % 255;
+				mrudp_send(connection, packet.data(), (int)packet.size(), 1);
+			}
+
+			wait_until(
+				std::chrono::seconds(30),
+				[&]() { return remote.packetsReceived == numPacketsToSend; }
+			);
+
+			THEN("all packets arrive in order")
+			{
+				auto lock = lock_of(remote.packetsMutex);
+				REQUIRE(remote.packets.size() == numPacketsToSend);
+
+				auto i = 0;
+				for (auto &received: remote.packets)
+				{
+					packet[0] = i++ % 255;
+					REQUIRE(received == packet);
+				}
+			}
+
+			THEN("closing the connection reaches the remote")
+			{
+				{
+					auto lock = lock_of(local.connectionsMutex);
+					local.connections.erase(connection);
+				}
+				
+				mrudp_close_connection(connection);
+
+				wait_until(
+					std::chrono::seconds(30),
+					[&]() { return remoteConnectionsClosed == 1; }
+				);
+
+				REQUIRE(remoteConnectionsClosed == 1);
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,204 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+#include "../mrudp/sender/CongestionControl.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("congestion controllers")
+{
+	auto rtt = 0.02f;
+	Timepoint start = std::chrono::steady_clock::now();
+	
+	// acks a window of packets each rtt, returns the time after the last
+	auto ackRounds = [&](CongestionControl &congestion, s8 mode, Timepoint now, int rounds) {
+		for (auto round=0; round<rounds; ++round)
+		{
+			auto window = congestion.size.load();
+			for (auto i=0; i<window; ++i)
+				congestion.onAck(mode, now + toDuration(rtt * i / window), 1, rtt, rtt);
+				
+			now += toDuration(rtt);
+		}
+		
+		return now;
+	} ;
+
+	List<std::tuple<String, s8>> modes = {
+		{ "new reno", MRUDP_CONGESTION_NEWRENO },
+		{ "cubic", MRUDP_CONGESTION_CUBIC },
+		{ "bbr", MRUDP_CONGESTION_BBR },
+	};
+
+	for (auto &[name, mode]: modes)
+	{
+		GIVEN(name)
+		{
+			CongestionControl congestion;
+			congestion.select(mode);
+			
+			auto initial = congestion.size.load();
+			auto now = ackRounds(congestion, mode, start, 8);
+			
+			THEN("the window grows while packets are acked")
+			{
+				REQUIRE(congestion.size > initial);
+			}
+			
+			if (mode != MRUDP_CONGESTION_BBR)
+			{
+				WHEN("packets of one window are retried")
+				{
+					auto before = congestion.size.load();
+					auto sentAt = now - toDuration(rtt);
+					
+					congestion.onRetry(mode, now, sentAt, rtt);
+					auto after = congestion.size.load();
+					
+					congestion.onRetry(mode, now + toDuration(0.001f), sentAt, rtt);
+					
+					THEN("the window is reduced once")
+					{
+						REQUIRE(after < before);
+						REQUIRE(congestion.size == after);
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("congestion control")
+{
+	auto numPacketsToSend = 1024;
+
+    GIVEN( "mrudp service, remote socket" )
+    {
+		Packet packet(1024);
+		for (auto i=0; i<packet.size(); ++i)
+			packet[i] = i % 255;
+
+		List<std::tuple<String, s8>> modes = {
+			{ "simple", MRUDP_CONGESTION_SIMPLE },
+			{ "new reno", MRUDP_CONGESTION_NEWRENO },
+			{ "cubic", MRUDP_CONGESTION_CUBIC },
+			{ "bbr", MRUDP_CONGESTION_BBR },
+		};
+
+		for (auto &[name, mode]: modes)
+		{
+			WHEN(name)
+			{
+				auto options = mrudp_default_connection_options();
+				options.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+				options.congestion_control = mode;
+
+				mrudp_addr_t anyAddress;
+				mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+				State remote("remote");
+				remote.service = mrudp_service();
+				remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+				mrudp_addr_t remoteAddress;
+				mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+				State local("local");
+				local.service = mrudp_service();
+
+				auto remoteConnectionDispatch = Connection {
+					.receive = [&](auto data, auto size, auto isReliable) {
+						auto lock = lock_of(remote.packetsMutex);
+						remote.packets.push_back(Packet(data, data+size));
+						remote.packetsReceived++;
+						return 0;
+					},
+					.close = [&](auto event) {
+						return 0;
+					}
+				} ;
+
+				auto listen = Listener {
+					.accept = [&](auto connection) {
+						auto l = lock_of(remote.connectionsMutex);
+						remote.connections.insert(connection);
+
+						mrudp_accept(
+							connection,
+							&remoteConnectionDispatch,
+							connectionReceive,
+							connectionClose
+						);
+
+						return 0;
+					},
+					.close = [&](auto event) { return 0; }
+				} ;
+
+				mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+				local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+				auto localConnectionDispatch = Connection {
+					.receive = [&](auto data, auto size, auto isReliable) {
+						return 0;
+					},
+					.close = [&](auto event) {
+						return 0;
+					}
+				} ;
+
+				auto connection = mrudp_connect_ex(
+					local.sockets.back(), &remoteAddress,
+					&options,
+					&localConnectionDispatch, connectionReceive, connectionClose
+				);
+				local.connections.insert(connection);
+
+				WHEN(numPacketsToSend << " reliable packets are sent")
+				{
+					for (auto i=0; i<numPacketsToSend; ++i)
+					{
+						packet[0] = i % 255;
+						mrudp_send(connection, packet.data(), (int)packet.size(), 1);
+					}
+
+					wait_until(
+						std::chrono::seconds(30),
+						[&]() { return remote.packetsReceived == numPacketsToSend; }
+					);
+
+					THEN("all packets arrive in order")
+					{
+						auto lock = lock_of(remote.packetsMutex);
+						REQUIRE(remote.packets.size() == numPacketsToSend);
+
+						auto i = 0;
+						for (auto &received: remote.packets)
+						{
+							packet[0] = i++ % 255;
+							REQUIRE(received == packet);
+						}
+					}
+
+					THEN("the connection statistics report the rtt")
+					{
+						mrudp_connection_statistics_t statistics;
+						REQUIRE(mrudp_connection_statistics(connection, &statistics) == MRUDP_OK);
+						
+						REQUIRE(statistics.rtt_smoothed_us > 0);
+						REQUIRE(statistics.rtt_minimum_us <= statistics.rtt_smoothed_us);
+						REQUIRE(statistics.retry_timeout_us > statistics.rtt_smoothed_us);
+					}
+				}
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,153 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+#include "LossyRelay.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("deadlines")
+{
+	auto numMessagesToSend = 512;
+
+    GIVEN( "mrudp service, remote socket behind a relay which drops one packet in five" )
+    {
+		Packet packet(256);
+		for (auto i=0; i<packet.size(); ++i)
+			packet[i] = i % 255;
+
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+		options.maximum_retry_attempts = 32;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service();
+
+		Mutex receivedMutex;
+		Vector<int> received;
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				auto lock = lock_of(receivedMutex);
+				received.push_back((u8)data[0] | ((u8)data[1] << 8));
+				remote.packetsReceived++;
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept(connection, &remoteConnectionDispatch, connectionReceive, connectionClose);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		LossyRelay relay(remoteAddress, 5);
+
+		mrudp_addr_t relayAddress = { 0 };
+		relayAddress.v4 = relay.address;
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto connection = mrudp_connect_ex(
+			local.sockets.back(), &relayAddress,
+			&options,
+			&localConnectionDispatch, connectionReceive, connectionClose
+		);
+		local.connections.insert(connection);
+
+		auto sendNumbered = [&](int i, int deadlineMS) {
+			packet[0] = i & 0xFF;
+			packet[1] = (i >> 8) & 0xFF;
+			return mrudp_send_ex(connection, packet.data(), (int)packet.size(), 1, deadlineMS);
+		} ;
+
+		// the first message has no deadline, so the connection has opened before
+		// the messages with deadlines are sent
+		REQUIRE(sendNumbered(0, 0) == MRUDP_OK);
+
+		wait_until(
+			std::chrono::seconds(10),
+			[&]() { return remote.packetsReceived == 1; }
+		);
+
+		WHEN(numMessagesToSend << " reliable messages are sent with a deadline shorter than a resend, followed by one without")
+		{
+			for (auto i=1; i<=numMessagesToSend; ++i)
+				REQUIRE(sendNumbered(i, 1) == MRUDP_OK);
+
+			REQUIRE(sendNumbered(numMessagesToSend + 1, 0) == MRUDP_OK);
+
+			wait_until(
+				std::chrono::seconds(30),
+				[&]() {
+					auto lock = lock_of(receivedMutex);
+					return !received.empty() && received.back() == numMessagesToSend + 1;
+				}
+			);
+
+			THEN("the messages whose deadlines passed are skipped, and those after them arrive in order")
+			{
+				REQUIRE(relay.dropped > 0);
+
+				auto lock = lock_of(receivedMutex);
+				REQUIRE(received.back() == numMessagesToSend + 1);
+				REQUIRE(received.size() < numMessagesToSend + 2);
+
+				for (size_t i=1; i<received.size(); ++i)
+					REQUIRE(received[i] > received[i-1]);
+
+				mrudp_connection_statistics_t statistics;
+				REQUIRE(mrudp_connection_statistics(connection, &statistics) == MRUDP_OK);
+				REQUIRE(statistics.packets_expired > 0);
+			}
+		}
+
+		WHEN("a message with a deadline is larger than a packet")
+		{
+			Packet large(MRUDP_MAX_PACKET_SIZE * 2);
+
+			THEN("it is refused")
+			{
+				REQUIRE(mrudp_send_ex(connection, large.data(), (int)large.size(), 1, 100) == MRUDP_ERROR_PACKET_SIZE_TOO_LARGE);
+				REQUIRE(mrudp_send_ex(connection, large.data(), (int)large.size(), 0, 100) == MRUDP_ERROR_PACKET_SIZE_TOO_LARGE);
+				REQUIRE(mrudp_send_ex(connection, packet.data(), (int)packet.size(), 1, -1) != MRUDP_OK);
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
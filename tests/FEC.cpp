@@ -0,0 +1,283 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "LossyRelay.h"
+#include "../mrudp/connection/FEC.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("forward error correction")
+{
+	// a group of data packets of differing sizes and types
+	auto makePackets = [](size_t count) {
+		Vector<PacketPtr> packets;
+		for (size_t i=0; i<count; ++i)
+		{
+			auto packet = newPacket();
+			packet->header.type = i % 3 ? DATA_RELIABLE : DATA_UNRELIABLE;
+			packet->header.id = PacketID(1000 + i);
+			packet->dataSize = mrudp::Packet::Size(100 + i * 37);
+
+			for (size_t b=0; b<packet->dataSize; ++b)
+				packet->data[b] = char(i * 31 + b * 7);
+
+			packets.push_back(packet);
+		}
+
+		return packets;
+	} ;
+
+	auto same = [](const mrudp::Packet &lhs, const mrudp::Packet &rhs) {
+		return
+			lhs.header.type == rhs.header.type &&
+			lhs.header.id == rhs.header.id &&
+			lhs.dataSize == rhs.dataSize &&
+			memcmp(lhs.data, rhs.data, lhs.dataSize) == 0;
+	} ;
+
+	List<std::tuple<String, FECParameters, Vector<size_t>>> cases = {
+		{ "xor loses one packet", { .mode = MRUDP_FEC_XOR, .dataPackets = 8, .parityPackets = 1 }, { 5 } },
+		{ "reed solomon loses one packet", { .mode = MRUDP_FEC_REED_SOLOMON, .dataPackets = 8, .parityPackets = 3 }, { 0 } },
+		{ "reed solomon loses three packets", { .mode = MRUDP_FEC_REED_SOLOMON, .dataPackets = 10, .parityPackets = 3 }, { 1, 4, 9 } },
+		{ "reed solomon loses as many packets as parities", { .mode = MRUDP_FEC_REED_SOLOMON, .dataPackets = 32, .parityPackets = 8 }, { 0, 3, 7, 12, 18, 25, 30, 31 } },
+	};
+
+	for (auto &[name, parameters, lost]: cases)
+	{
+		GIVEN(name)
+		{
+			FECEncoder encoder;
+			encoder.open(parameters);
+
+			FECDecoder decoder;
+			decoder.open(parameters);
+
+			auto packets = makePackets(parameters.dataPackets);
+
+			Vector<FECTrailer> trailers;
+			for (auto &packet: packets)
+				trailers.push_back(encoder.add(*packet));
+
+			REQUIRE(encoder.full());
+
+			Vector<PacketPtr> parities;
+			encoder.close(parities);
+
+			REQUIRE(parities.size() == parameters.parityPackets);
+			REQUIRE(encoder.empty());
+			REQUIRE(encoder.group == 1);
+
+			Vector<PacketPtr> recovered;
+			for (size_t i=0; i<packets.size(); ++i)
+				if (std::find(lost.begin(), lost.end(), i) == lost.end())
+					decoder.onData(trailers[i], *packets[i], recovered);
+
+			REQUIRE(recovered.empty());
+
+			// the first parities are lost as well, only as many as are needed arrive
+			for (size_t j=parities.size() - lost.size(); j<parities.size(); ++j)
+				decoder.onParity(*parities[j], recovered);
+
+			THEN("the lost packets are rebuilt")
+			{
+				REQUIRE(recovered.size() == lost.size());
+
+				for (auto &packet: recovered)
+				{
+					auto i = size_t(packet->header.id - 1000);
+					REQUIRE(std::find(lost.begin(), lost.end(), i) != lost.end());
+					REQUIRE(same(*packet, *packets[i]));
+				}
+			}
+
+			THEN("a rebuilt unreliable packet which arrives late is discarded")
+			{
+				for (auto i: lost)
+				{
+					auto discard = decoder.onData(trailers[i], *packets[i], recovered);
+					REQUIRE(discard == (packets[i]->header.type == DATA_UNRELIABLE ? Discard : Keep));
+				}
+			}
+		}
+	}
+
+	GIVEN("a reed solomon group which loses more packets than it has parities")
+	{
+		FECParameters parameters { .mode = MRUDP_FEC_REED_SOLOMON, .dataPackets = 6, .parityPackets = 2 };
+
+		FECEncoder encoder;
+		encoder.open(parameters);
+
+		FECDecoder decoder;
+		decoder.open(parameters);
+
+		auto packets = makePackets(4);
+
+		Vector<FECTrailer> trailers;
+		for (auto &packet: packets)
+			trailers.push_back(encoder.add(*packet));
+
+		// the group closes before it has filled
+		Vector<PacketPtr> parities;
+		encoder.close(parities);
+
+		Vector<PacketPtr> recovered;
+		decoder.onData(trailers[0], *packets[0], recovered);
+
+		for (auto &parity: parities)
+			decoder.onParity(*parity, recovered);
+
+		THEN("nothing is rebuilt until enough have arrived")
+		{
+			REQUIRE(recovered.empty());
+
+			decoder.onData(trailers[2], *packets[2], recovered);
+
+			REQUIRE(recovered.size() == 2);
+			for (auto &packet: recovered)
+				REQUIRE(same(*packet, *packets[packet->header.id - 1000]));
+		}
+	}
+
+	GIVEN("parameters outside the limits")
+	{
+		THEN("they are clamped, and xor has a single parity")
+		{
+			auto xor_ = FECParameters { .mode = MRUDP_FEC_XOR, .dataPackets = 200, .parityPackets = 4 }.clamped();
+			REQUIRE(xor_.dataPackets == FECParameters::maximumDataPackets);
+			REQUIRE(xor_.parityPackets == 1);
+
+			auto rs = FECParameters { .mode = MRUDP_FEC_REED_SOLOMON, .dataPackets = 0, .parityPackets = 100 }.clamped();
+			REQUIRE(rs.dataPackets == 1);
+			REQUIRE(rs.parityPackets == FECParameters::maximumParityPackets);
+
+			auto none = FECParameters { .mode = 7, .dataPackets = 8, .parityPackets = 1 }.clamped();
+			REQUIRE(none.mode == MRUDP_FEC_NONE);
+		}
+	}
+}
+
+SCENARIO("forward error correction over a lossy link")
+{
+	auto numPacketsToSend = 1024;
+
+    GIVEN( "mrudp service, remote socket behind a relay which drops 2% of packets" )
+    {
+		Packet packet(1000);
+
+		auto options = mrudp_default_connection_options();
+		options.coalesce_unreliable.mode = MRUDP_COALESCE_NONE;
+		options.fec.mode = MRUDP_FEC_XOR;
+		options.fec.data_packets = 8;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service();
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				remote.packetsReceived++;
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept_ex(
+					connection,
+					&options,
+					&remoteConnectionDispatch,
+					connectionReceive,
+					connectionClose
+				);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		LossyRelay relay(remoteAddress, 50);
+		
+		mrudp_addr_t relayAddress = { 0 };
+		relayAddress.v4 = relay.address;
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto connection = mrudp_connect_ex(
+			local.sockets.back(), &relayAddress,
+			&options,
+			&localConnectionDispatch, connectionReceive, connectionClose
+		);
+		local.connections.insert(connection);
+
+		// unreliable packets are dropped until the connection has opened, a reliable
+		// packet arriving shows that it has
+		mrudp_send(connection, packet.data(), (int)packet.size(), 1);
+
+		wait_until(
+			std::chrono::seconds(10),
+			[&]() { return remote.packetsReceived == 1; }
+		);
+
+		WHEN(numPacketsToSend << " unreliable packets are sent")
+		{
+			for (auto i=0; i<numPacketsToSend; ++i)
+			{
+				packet[0] = i % 255;
+				mrudp_send(connection, packet.data(), (int)packet.size(), 0);
+				
+				// paced so that only the relay loses packets
+				if (i % 8 == 7)
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+
+			wait_until(
+				std::chrono::seconds(10),
+				[&]() { return remote.packetsReceived == numPacketsToSend + 1; }
+			);
+
+			THEN("the packets the relay dropped are rebuilt")
+			{
+				REQUIRE(relay.dropped > 0);
+				REQUIRE(remote.packetsReceived == numPacketsToSend + 1);
+
+				auto lock = lock_of(remote.connectionsMutex);
+				mrudp_connection_statistics_t statistics;
+				REQUIRE(mrudp_connection_statistics(*remote.connections.begin(), &statistics) == MRUDP_OK);
+				REQUIRE(statistics.packets_recovered > 0);
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
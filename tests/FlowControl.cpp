@@ -0,0 +1,139 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("flow control")
+{
+	auto numMessagesToSend = 1024;
+	auto receiveWindow = 64;
+
+    GIVEN( "mrudp service, remote and local sockets paired, the remote paused with a small receive window" )
+    {
+		Packet packet(1000);
+
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+		options.receive_window = receiveWindow;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service();
+
+		Mutex receivedMutex;
+		Vector<int> received;
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				auto lock = lock_of(receivedMutex);
+				received.push_back((u8)data[0] | ((u8)data[1] << 8));
+				remote.packetsReceived++;
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept_ex(
+					connection,
+					&options,
+					&remoteConnectionDispatch,
+					connectionReceive,
+					connectionClose
+				);
+
+				mrudp_connection_pause_receive(connection);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto connection = mrudp_connect_ex(
+			local.sockets.back(), &remoteAddress,
+			&options,
+			&localConnectionDispatch, connectionReceive, connectionClose
+		);
+		local.connections.insert(connection);
+
+		WHEN(numMessagesToSend << " reliable messages are sent to the paused remote")
+		{
+			for (auto i=0; i<numMessagesToSend; ++i)
+			{
+				packet[0] = i & 0xFF;
+				packet[1] = (i >> 8) & 0xFF;
+				REQUIRE(mrudp_send(connection, packet.data(), (int)packet.size(), 1) == MRUDP_OK);
+			}
+
+			std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+
+			THEN("nothing is delivered, and the sender waits once the window is full")
+			{
+				REQUIRE(remote.packetsReceived == 0);
+
+				mrudp_connection_statistics_t statistics;
+				REQUIRE(mrudp_connection_statistics(connection, &statistics) == MRUDP_OK);
+
+				// the window is full, less what the credit rounds off, and the packets
+				// sent before the first ack
+				REQUIRE(statistics.reliable.packets.sent > receiveWindow / 2);
+				REQUIRE(statistics.reliable.packets.sent < receiveWindow * 2);
+			}
+
+			THEN("once resumed everything is delivered in order")
+			{
+				{
+					auto l = lock_of(remote.connectionsMutex);
+					REQUIRE(mrudp_connection_resume_receive(*remote.connections.begin()) == MRUDP_OK);
+				}
+
+				wait_until(
+					std::chrono::seconds(30),
+					[&]() { return remote.packetsReceived == numMessagesToSend; }
+				);
+
+				auto lock = lock_of(receivedMutex);
+				REQUIRE(received.size() == numMessagesToSend);
+
+				for (auto i=0; i<numMessagesToSend; ++i)
+					REQUIRE(received[i] == i);
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,301 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+#include "LossyRelay.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+struct StreamReceiver
+{
+	Mutex mutex;
+	Vector<std::pair<int, Packet>> received;
+	std::atomic<int> count = 0;
+} ;
+
+inline
+int streamReceive(void *l_, int stream, char *data, int size, int isReliable)
+{
+	auto l = reinterpret_cast<StreamReceiver *>(l_);
+
+	auto lock = lock_of(l->mutex);
+	l->received.push_back({ stream, Packet(data, data+size) });
+	l->count++;
+
+	return 0;
+}
+
+SCENARIO("independent streams")
+{
+	auto numStreams = 3;
+	auto numMessagesToSend = 256;
+
+    GIVEN( "mrudp service, remote socket behind a relay which drops one packet in seven" )
+    {
+		Packet packet(256);
+		for (auto i=0; i<packet.size(); ++i)
+			packet[i] = i % 255;
+
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+		options.maximum_retry_attempts = 32;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service();
+
+		StreamReceiver receiver;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept(connection, &receiver, nullptr, nullptr);
+				mrudp_connection_receive_stream(connection, streamReceive);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		LossyRelay relay(remoteAddress, 7);
+
+		mrudp_addr_t relayAddress = { 0 };
+		relayAddress.v4 = relay.address;
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		local.connections.insert(
+			mrudp_connect_ex(
+				local.sockets.back(), &relayAddress,
+				&options,
+				&localConnectionDispatch, connectionReceive, connectionClose
+			)
+		);
+
+		auto connection = *local.connections.begin();
+
+		WHEN(numMessagesToSend << " reliable messages are sent on each of " << numStreams << " streams, interleaved")
+		{
+			for (auto i=0; i<numMessagesToSend; ++i)
+			{
+				for (auto stream=0; stream<numStreams; ++stream)
+				{
+					packet[0] = i % 255;
+					packet[1] = stream;
+					REQUIRE(mrudp_send_stream(connection, stream, packet.data(), (int)packet.size()) == MRUDP_OK);
+				}
+			}
+
+			wait_until(
+				std::chrono::seconds(30),
+				[&]() { return receiver.count == numMessagesToSend * numStreams; }
+			);
+
+			THEN("the messages of each stream arrive in order, with their stream")
+			{
+				auto lock = lock_of(receiver.mutex);
+				REQUIRE(receiver.received.size() == numMessagesToSend * numStreams);
+
+				Vector<int> next(numStreams, 0);
+				for (auto &[stream, received]: receiver.received)
+				{
+					REQUIRE(stream >= 0);
+					REQUIRE(stream < numStreams);
+
+					packet[0] = next[stream]++ % 255;
+					packet[1] = stream;
+					REQUIRE(received == packet);
+				}
+			}
+
+			THEN("a loss on one stream does not hold back the others")
+			{
+				REQUIRE(relay.dropped > 0);
+
+				// as one ordered stream the messages would arrive in the order sent
+				auto lock = lock_of(receiver.mutex);
+
+				auto reordered = false;
+				auto i = 0;
+				for (auto &[stream, received]: receiver.received)
+				{
+					if (stream != i % numStreams || received[0] != (i / numStreams) % 255)
+						reordered = true;
+
+					++i;
+				}
+
+				REQUIRE(reordered);
+			}
+		}
+
+		WHEN("a stream out of range is sent on")
+		{
+			THEN("it is refused")
+			{
+				REQUIRE(mrudp_send_stream(connection, MRUDP_MAX_STREAMS, packet.data(), (int)packet.size()) != MRUDP_OK);
+				REQUIRE(mrudp_send_stream(connection, -1, packet.data(), (int)packet.size()) != MRUDP_OK);
+				REQUIRE(mrudp_connection_stream_weight(connection, 0, 0) != MRUDP_OK);
+			}
+		}
+	}
+}
+
+SCENARIO("streams sharing a connection")
+{
+	auto numMessagesToSend = 256;
+
+    GIVEN( "mrudp service, remote and local sockets paired" )
+    {
+		Packet packet(256);
+		for (auto i=0; i<packet.size(); ++i)
+			packet[i] = i % 255;
+
+		// the messages wait to be coalesced, so that all are waiting when the
+		// streams are sent from
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_PACKET;
+		options.coalesce_reliable.delay_ms = 100;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service();
+
+		StreamReceiver receiver;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept(connection, &receiver, nullptr, nullptr);
+				mrudp_connection_receive_stream(connection, streamReceive);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		local.connections.insert(
+			mrudp_connect_ex(
+				local.sockets.back(), &remoteAddress,
+				&options,
+				&localConnectionDispatch, connectionReceive, connectionClose
+			)
+		);
+
+		auto connection = *local.connections.begin();
+
+		WHEN("a stream is given a greater weight, and both streams have many messages waiting")
+		{
+			REQUIRE(mrudp_connection_stream_weight(connection, 2, 4) == MRUDP_OK);
+
+			for (auto i=0; i<numMessagesToSend * 2; ++i)
+			{
+				for (auto stream=1; stream<=2; ++stream)
+				{
+					packet[1] = stream;
+					mrudp_send_stream(connection, stream, packet.data(), (int)packet.size());
+				}
+			}
+
+			wait_until(
+				std::chrono::seconds(30),
+				[&]() { return receiver.count == numMessagesToSend * 4; }
+			);
+
+			THEN("it is given the greater share of the window")
+			{
+				auto lock = lock_of(receiver.mutex);
+				REQUIRE(receiver.received.size() == numMessagesToSend * 4);
+
+				// were the streams shared evenly they would keep pace, with its weight
+				// the heavier is four times as far along
+				auto lighter = 0;
+				auto heavier = 0;
+				for (auto &[stream, received]: receiver.received)
+				{
+					if (stream == 1)
+						lighter++;
+					else
+					if (++heavier == numMessagesToSend)
+						break;
+				}
+
+				REQUIRE(lighter < numMessagesToSend / 2);
+			}
+		}
+
+		WHEN(numMessagesToSend << " reliable messages are sent on a stream, and the connection is closed at once")
+		{
+			for (auto i=0; i<numMessagesToSend; ++i)
+			{
+				packet[0] = i % 255;
+				mrudp_send_stream(connection, 1, packet.data(), (int)packet.size());
+			}
+
+			mrudp_close_connection(connection);
+			local.connections.erase(connection);
+
+			wait_until(
+				std::chrono::seconds(30),
+				[&]() { return receiver.count == numMessagesToSend; }
+			);
+
+			THEN("the remote receives all of the stream before closing")
+			{
+				REQUIRE(receiver.count == numMessagesToSend);
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "../mrudp/Base.h"
+
+#include <netinet/in.h>
+#include <unistd.h>
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+// --------------------------------------------------------------------------------
+// LossyRelay
+//
+// Forwards datagrams between one client and the remote, dropping every nth
+// datagram from the client.
+// --------------------------------------------------------------------------------
+
+struct LossyRelay
+{
+	int handle;
+	sockaddr_in address;
+	sockaddr_in remote;
+	Optional<sockaddr_in> client;
+	
+	int dropEvery;
+	int count = 0;
+	std::atomic<int> dropped = 0;
+	
+	std::atomic<bool> running = true;
+	std::thread thread;
+	
+	LossyRelay(const mrudp_addr_t &remote_, int dropEvery_) :
+		remote(remote_.v4),
+		dropEvery(dropEvery_)
+	{
+		handle = ::socket(AF_INET, SOCK_DGRAM, 0);
+		
+		address = sockaddr_in { .sin_family = AF_INET };
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		::bind(handle, (sockaddr *)&address, sizeof(address));
+		
+		socklen_t size = sizeof(address);
+		::getsockname(handle, (sockaddr *)&address, &size);
+		
+		timeval timeout { .tv_sec = 0, .tv_usec = 50000 };
+		::setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		
+		thread = std::thread([this]() { run(); });
+	}
+	
+	~LossyRelay()
+	{
+		running = false;
+		thread.join();
+		::close(handle);
+	}
+	
+	static bool equal(const sockaddr_in &lhs, const sockaddr_in &rhs)
+	{
+		return lhs.sin_port == rhs.sin_port && lhs.sin_addr.s_addr == rhs.sin_addr.s_addr;
+	}
+	
+	void run()
+	{
+		char buffer[2048];
+		
+		while (running)
+		{
+			sockaddr_in from;
+			socklen_t size = sizeof(from);
+			
+			auto received = ::recvfrom(handle, buffer, sizeof(buffer), 0, (sockaddr *)&from, &size);
+			if (received <= 0)
+				continue;
+				
+			if (equal(from, remote))
+			{
+				if (client)
+					::sendto(handle, buffer, received, 0, (sockaddr *)&*client, sizeof(*client));
+					
+				continue;
+			}
+			
+			client = from;
+			
+			if (++count % dropEvery == 0)
+			{
+				dropped++;
+				continue;
+			}
+			
+			::sendto(handle, buffer, received, 0, (sockaddr *)&remote, sizeof(remote));
+		}
+	}
+} ;
+
+} // namespace
+} // namespace
+} // namespace
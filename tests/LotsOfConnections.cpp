@@ -1,6 +1,7 @@
 
 #include "../mrudp/mrudp.h"
 
+#include <iostream>
 #include "Common.h"
 
 namespace timprepscius {
@@ -17,8 +18,14 @@ SCENARIO("lots_of_connections")
 		mrudp_addr_t anyAddress;
 		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
 		
+		// the remote receives on every core at once
+		mrudp_options_asio_t options;
+		mrudp_default_options(MRUDP_IMP_ASIO, &options);
+		options.thread_quantity = 0;
+		options.receive_depth = std::thread::hardware_concurrency();
+
 		State remote("remote");
-		remote.service = mrudp_service();
+		remote.service = mrudp_service_ex(MRUDP_IMP_ASIO, &options);
 		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
 		
 		mrudp_addr_t remoteAddress;
@@ -96,7 +103,7 @@ SCENARIO("lots_of_connections")
 					);
 				}
 			
-				wait_until(std::chrono::seconds(10), [&]() {
+				wait_until(std::chrono::seconds(60), [&]() {
 					return remote.connections.size() == numConnectionsToCreate;
 				});
 				
@@ -126,7 +133,7 @@ SCENARIO("lots_of_connections")
 					THEN("packets show up and are correct")
 					{
 						wait_until(
-							std::chrono::seconds(10),
+							std::chrono::seconds(60),
 							[&]() { return remote.packetsReceived == packetsSent; }
 						);
 
@@ -139,6 +146,8 @@ SCENARIO("lots_of_connections")
 						auto durationInS = durationInMS.count() / 1000.0;
 						auto packetsPerSecond = packetsSent / durationInS;
 						
+						std::cout << "local to remote, receive_depth " << options.receive_depth << ": " << packetsPerSecond << " packets per second" << std::endl;
+						
 						auto requiredPacketsPerSecond = 1.0;
 						REQUIRE(packetsPerSecond > requiredPacketsPerSecond);
 						
@@ -174,7 +183,7 @@ SCENARIO("lots_of_connections")
 					THEN("packets show up and are correct")
 					{
 						wait_until(
-							std::chrono::seconds(10),
+							std::chrono::seconds(60),
 							[&]() { return local.packetsReceived == packetsSent; }
 						);
 
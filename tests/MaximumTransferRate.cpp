@@ -3,6 +3,7 @@
 
 #include <iostream>
 #include "Common.h"
+#include "../mrudp/Base.h"
 
 
 namespace timprepscius {
@@ -318,6 +319,280 @@ SCENARIO("packet transmission rate")
 	
 }
 
+
+SCENARIO("packet transmission rate batched io")
+{
+	auto X = 64;
+	auto Y = 256;
+
+	mrudp_options_asio_t options;
+	mrudp_default_options(MRUDP_IMP_ASIO, &options);
+	options.connection.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+	options.connection.coalesce_unreliable.mode = MRUDP_COALESCE_NONE;
+	options.send_via_queue = 1;
+	
+	auto options_single = options;
+	options_single.batch_size = 0;
+	
+	auto options_batched = options;
+	options_batched.batch_size = 32;
+
+	auto options_threaded = options_single;
+	options_threaded.thread_quantity = 4;
+	options_threaded.receive_depth = 1;
+
+	auto options_threaded_deep = options_threaded;
+	options_threaded_deep.receive_depth = 4;
+
+	List<std::tuple<String, mrudp_options_asio_t>> availableOptions = {
+		{ "single datagram io", options_single },
+		{ "batched datagram io", options_batched },
+		{ "4 threads, receive depth 1", options_threaded },
+		{ "4 threads, receive depth 4", options_threaded_deep },
+	};
+	
+	for (auto &[name, options]: availableOptions)
+	{
+		WHEN(name)
+		{
+			mrudp_addr_t anyAddress;
+			mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+			
+			State remote("remote");
+			remote.service = mrudp_service_ex(MRUDP_IMP_ASIO, &options);
+			remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+			
+			mrudp_addr_t remoteAddress;
+			mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+			State local("local");
+			local.service = mrudp_service_ex(MRUDP_IMP_ASIO, &options);
+			
+			auto connectionDispatch = Connection {
+				[&](auto data, auto size, auto isReliable) {
+					return remote.packetsReceived++;
+				},
+				[&](auto event) { return 0; }
+			};
+			
+			auto listenerDispatch = Listener {
+				[&](auto connection) {
+					auto l = lock_of(remote.connectionsMutex);
+					remote.connections.insert(connection);
+					
+					mrudp_accept(
+						connection,
+						&connectionDispatch,
+						connectionReceive,
+						connectionClose
+					);
+					return 0;
+				},
+				[&](auto event) {
+					return 0;
+				}
+			} ;
+			
+			mrudp_listen(
+				remote.sockets.back(),
+				&listenerDispatch, nullptr, listenerAccept, listenerClose
+			);
+
+			local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+			
+			auto localConnectionDispatch = Connection {
+				[&](auto data, auto size, auto isReliable) {
+					return 0;
+				},
+				[&](auto event) {
+					return 0;
+				}
+			} ;
+			
+			for (auto i=0; i<X; ++i)
+			{
+				local.connections.insert(
+					mrudp_connect(
+						local.sockets.back(), &remoteAddress,
+						&localConnectionDispatch,
+						connectionReceive,
+						connectionClose
+					)
+				);
+			}
+			
+			char packet[] = { 'a', 'b', 'c', 'd', 'e' };
+			size_t packetsSent = 0;
+
+			THEN("send " << Y << " packets of data on each of " << X << " connections")
+			{
+				auto then = Clock::now();
+			
+				for (auto &connection: local.connections)
+				{
+					for (auto i=0; i<Y; ++i)
+					{
+						mrudp_send(connection, packet, sizeof(packet), 1);
+						packetsSent++;
+					}
+				}
+				
+				wait_until(std::chrono::seconds(10), [&]() { return remote.packetsReceived == packetsSent; });
+				
+				auto now = Clock::now();
+				auto duration = now - then;
+				
+				REQUIRE(remote.packetsReceived == packetsSent);
+				
+				auto durationInMS = std::chrono::duration_cast<std::chrono::milliseconds>(duration);
+				auto durationInS = std::max(durationInMS.count(), (decltype(durationInMS.count()))1) / 1000.0;
+				auto packetsPerSecond = packetsSent / durationInS;
+				
+				std::cout << name << ": " << packetsPerSecond << " packets per second" << std::endl;
+				
+				auto requiredPacketsPerSecond = 1.0;
+				REQUIRE(packetsPerSecond > requiredPacketsPerSecond);
+			}
+		}
+	}
+}
+
+SCENARIO("bulk transfer rate offload")
+{
+	const size_t chunkSize = 64 * 1024;
+	const size_t numChunks = 32;
+
+	mrudp_options_asio_t options;
+	mrudp_default_options(MRUDP_IMP_ASIO, &options);
+	options.connection.coalesce_reliable.mode = MRUDP_COALESCE_STREAM;
+	
+	auto options_single = options;
+	options_single.segmentation_offload = 0;
+	
+	auto options_segmented = options;
+	options_segmented.segmentation_offload = 1;
+
+	auto options_coalesced = options;
+	options_coalesced.receive_offload = 1;
+
+	auto options_segmented_coalesced = options_segmented;
+	options_segmented_coalesced.receive_offload = 1;
+
+	List<std::tuple<String, mrudp_options_asio_t>> availableOptions = {
+		{ "one datagram per packet", options_single },
+		{ "segmented datagrams", options_segmented },
+		{ "coalesced receive", options_coalesced },
+		{ "segmented datagrams, coalesced receive", options_segmented_coalesced },
+	};
+	
+	for (auto &[name, options]: availableOptions)
+	{
+		WHEN(name)
+		{
+			mrudp_addr_t anyAddress;
+			mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+			
+			State remote("remote");
+			remote.service = mrudp_service_ex(MRUDP_IMP_ASIO, &options);
+			remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+			
+			mrudp_addr_t remoteAddress;
+			mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+			State local("local");
+			local.service = mrudp_service_ex(MRUDP_IMP_ASIO, &options);
+			
+			u8 nextReceive = 0;
+			bool inOrder = true;
+			
+			auto connectionDispatch = Connection {
+				[&](auto data, auto size, auto isReliable) {
+					for (auto *ptr = (u8 *)data; ptr != (u8 *)data + size; ++ptr)
+						inOrder = inOrder && (*ptr == nextReceive++);
+						
+					remote.bytesReceived += size;
+					return remote.packetsReceived++;
+				},
+				[&](auto event) { return 0; }
+			};
+			
+			auto listenerDispatch = Listener {
+				[&](auto connection) {
+					auto l = lock_of(remote.connectionsMutex);
+					remote.connections.insert(connection);
+					
+					mrudp_accept(
+						connection,
+						&connectionDispatch,
+						connectionReceive,
+						connectionClose
+					);
+					return 0;
+				},
+				[&](auto event) {
+					return 0;
+				}
+			} ;
+			
+			mrudp_listen(
+				remote.sockets.back(),
+				&listenerDispatch, nullptr, listenerAccept, listenerClose
+			);
+
+			local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+			
+			auto localConnectionDispatch = Connection {
+				[&](auto data, auto size, auto isReliable) {
+					return 0;
+				},
+				[&](auto event) {
+					return 0;
+				}
+			} ;
+			
+			auto connection = mrudp_connect(
+				local.sockets.back(), &remoteAddress,
+				&localConnectionDispatch,
+				connectionReceive,
+				connectionClose
+			);
+			local.connections.insert(connection);
+			
+			THEN("send " << numChunks << " chunks of " << chunkSize << " bytes")
+			{
+				std::vector<u8> chunk(chunkSize);
+				u8 nextSend = 0;
+				size_t bytesSent = 0;
+				
+				auto then = Clock::now();
+			
+				for (auto i=0; i<numChunks; ++i)
+				{
+					for (auto &c: chunk)
+						c = nextSend++;
+						
+					mrudp_send(connection, (char *)chunk.data(), chunk.size(), 1);
+					bytesSent += chunk.size();
+				}
+				
+				wait_until(std::chrono::seconds(60), [&]() { return remote.bytesReceived == bytesSent; });
+				
+				auto now = Clock::now();
+				auto duration = now - then;
+				
+				REQUIRE(remote.bytesReceived == bytesSent);
+				REQUIRE(inOrder);
+				
+				auto durationInMS = std::chrono::duration_cast<std::chrono::milliseconds>(duration);
+				auto durationInS = std::max(durationInMS.count(), (decltype(durationInMS.count()))1) / 1000.0;
+				auto megabytesPerSecond = bytesSent / durationInS / (1024 * 1024);
+				
+				std::cout << name << ": " << megabytesPerSecond << " megabytes per second" << std::endl;
+			}
+		}
+	}
+}
+
 } // namespace
 } // namespace
 } // namespace
@@ -0,0 +1,139 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("packet numbers")
+{
+    GIVEN( "mrudp service, remote socket" )
+    {
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_PACKET;
+
+		auto options_16 = options;
+		options_16.packet_numbers = MRUDP_PACKET_NUMBERS_16;
+
+		auto options_32 = options;
+		options_32.packet_numbers = MRUDP_PACKET_NUMBERS_32;
+
+		List<std::tuple<String, mrudp_connection_options_t, mrudp_connection_options_t, s8>> availableOptions = {
+			{ "both ends use 32 bit numbers", options_32, options_32, MRUDP_PACKET_NUMBERS_32 },
+			{ "the accepting end uses 16 bit numbers", options_32, options_16, MRUDP_PACKET_NUMBERS_16 },
+			{ "the connecting end uses 16 bit numbers", options_16, options_32, MRUDP_PACKET_NUMBERS_16 },
+		};
+
+		for (auto &[name, localOptions, remoteOptions, agreed]: availableOptions)
+		{
+			WHEN(name)
+			{
+				mrudp_addr_t anyAddress;
+				mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+				State remote("remote");
+				remote.service = mrudp_service();
+				remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+				mrudp_addr_t remoteAddress;
+				mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+				State local("local");
+				local.service = mrudp_service();
+
+				auto remoteConnectionDispatch = Connection {
+					.receive = [&](auto data, auto size, auto isReliable) {
+						auto lock = lock_of(remote.packetsMutex);
+						remote.packets.emplace_back(data, data+size);
+						remote.packetsReceived++;
+						return 0;
+					},
+					.close = [&](auto event) {
+						return 0;
+					}
+				} ;
+
+				auto listen = Listener {
+					.accept = [&](auto connection) {
+						auto l = lock_of(remote.connectionsMutex);
+						remote.connections.insert(connection);
+
+						mrudp_accept_ex(
+							connection,
+							&remoteOptions,
+							&remoteConnectionDispatch,
+							connectionReceive,
+							connectionClose
+						);
+
+						return 0;
+					},
+					.close = [&](auto event) { return 0; }
+				} ;
+
+				mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+				local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+				auto localConnectionDispatch = Connection {
+					.receive = [&](auto data, auto size, auto isReliable) {
+						return 0;
+					},
+					.close = [&](auto event) {
+						return 0;
+					}
+				} ;
+
+				auto connection = mrudp_connect_ex(
+					local.sockets.back(), &remoteAddress,
+					&localOptions,
+					&localConnectionDispatch, connectionReceive, connectionClose
+				);
+				local.connections.insert(connection);
+
+				// with 32 bit numbers, more frames than the 16 bit frame ids can number
+				auto numMessagesToSend = agreed == MRUDP_PACKET_NUMBERS_32 ? 70000 : 4096;
+
+				WHEN(numMessagesToSend << " reliable messages are sent")
+				{
+					for (auto i=0; i<numMessagesToSend; ++i)
+					{
+						u32 message = i;
+						mrudp_send(connection, (char *)&message, sizeof(message), 1);
+					}
+
+					wait_until(
+						std::chrono::seconds(30),
+						[&]() { return remote.packetsReceived == numMessagesToSend; }
+					);
+
+					THEN("both ends use the narrower numbers")
+					{
+						mrudp_connection_options_t options;
+						REQUIRE(mrudp_connection_options(connection, &options) == MRUDP_OK);
+						REQUIRE(options.packet_numbers == agreed);
+					}
+
+					THEN("all messages arrive in order")
+					{
+						auto lock = lock_of(remote.packetsMutex);
+						REQUIRE(remote.packets.size() == numMessagesToSend);
+
+						u32 i = 0;
+						for (auto &received: remote.packets)
+						{
+							REQUIRE(received.size() == sizeof(i));
+							REQUIRE(*(u32 *)received.data() == i++);
+						}
+					}
+				}
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,124 @@
+#include "Common.h"
+#include "../mrudp/Packet.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("packet pool")
+{
+    GIVEN( "packets created and released on one thread" )
+    {
+		mrudp_packet_pool_statistics_t before;
+		mrudp_packet_pool_statistics(&before);
+
+		auto numPackets = 16;
+
+		{
+			Vector<PacketPtr> packets;
+			for (auto i=0; i<numPackets; ++i)
+			{
+				auto packet = newPacket();
+				packet->header.type = DATA_RELIABLE;
+				packet->header.id = i;
+				pushData(*packet, i);
+				packets.push_back(packet);
+			}
+
+			THEN("copies share the packet")
+			{
+				auto copy = packets.front();
+				REQUIRE(ptr_of(copy) == ptr_of(packets.front()));
+				REQUIRE(copy->header.id == 0);
+			}
+		}
+
+		mrudp_packet_pool_statistics_t released;
+		mrudp_packet_pool_statistics(&released);
+
+		THEN("the released packets are pooled")
+		{
+			REQUIRE(released.recycled - before.recycled == numPackets);
+			REQUIRE(released.pooled >= numPackets);
+		}
+
+		WHEN("packets are created again")
+		{
+			Vector<PacketPtr> packets;
+			for (auto i=0; i<numPackets; ++i)
+				packets.push_back(newPacket());
+
+			mrudp_packet_pool_statistics_t after;
+			mrudp_packet_pool_statistics(&after);
+
+			THEN("the pooled packets are reused, and reset")
+			{
+				REQUIRE(after.reused - released.reused == numPackets);
+				REQUIRE(after.allocated == released.allocated);
+
+				for (auto &packet: packets)
+				{
+					REQUIRE(packet->dataSize == 0);
+					REQUIRE(packet->header.type == NONE);
+					REQUIRE(packet->header.id == 0);
+				}
+			}
+		}
+	}
+	
+	GIVEN( "packets created on one thread and released on another" )
+	{
+		auto numPackets = 16;
+
+		Vector<PacketPtr> packets;
+		std::atomic<int> step = 0;
+		
+		mrudp_packet_pool_statistics_t released, after;
+		Vector<mrudp::Packet *> reusedPackets;
+		Vector<mrudp::Packet *> createdPackets;
+
+		std::thread creator([&]() {
+			for (auto i=0; i<numPackets; ++i)
+			{
+				packets.push_back(newPacket());
+				createdPackets.push_back(ptr_of(packets.back()));
+			}
+			
+			step = 1;
+			while (step != 2)
+				std::this_thread::yield();
+				
+			mrudp_packet_pool_statistics(&released);
+
+			Vector<PacketPtr> again;
+			for (auto i=0; i<numPackets; ++i)
+			{
+				again.push_back(newPacket());
+				reusedPackets.push_back(ptr_of(again.back()));
+			}
+			
+			mrudp_packet_pool_statistics(&after);
+		});
+		
+		while (step != 1)
+			std::this_thread::yield();
+			
+		packets.clear();
+		step = 2;
+		
+		creator.join();
+		
+		THEN("the packets return to the pool of the creating thread and are reused there")
+		{
+			REQUIRE(after.reused - released.reused >= numPackets);
+			
+			std::sort(createdPackets.begin(), createdPackets.end());
+			std::sort(reusedPackets.begin(), reusedPackets.end());
+			REQUIRE(createdPackets == reusedPackets);
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
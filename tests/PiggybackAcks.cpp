@@ -0,0 +1,132 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("piggybacked acks")
+{
+	auto numMessagesToSend = 256;
+
+    GIVEN( "mrudp service, remote socket which echoes each message" )
+    {
+		Packet packet(128);
+		for (auto i=0; i<packet.size(); ++i)
+			packet[i] = i % 255;
+
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service();
+
+		mrudp_connection_t remoteConnection = nullptr;
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				remote.packetsReceived++;
+				mrudp_send(remoteConnection, data, size, 1);
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+				remoteConnection = connection;
+
+				mrudp_accept_ex(
+					connection,
+					&options,
+					&remoteConnectionDispatch,
+					connectionReceive,
+					connectionClose
+				);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				auto lock = lock_of(local.packetsMutex);
+				local.packets.push_back(Packet(data, data+size));
+				local.packetsReceived++;
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto connection = mrudp_connect_ex(
+			local.sockets.back(), &remoteAddress,
+			&options,
+			&localConnectionDispatch, connectionReceive, connectionClose
+		);
+		local.connections.insert(connection);
+
+		WHEN(numMessagesToSend << " reliable messages are sent a millisecond apart")
+		{
+			for (auto i=0; i<numMessagesToSend; ++i)
+			{
+				packet[0] = i % 255;
+				mrudp_send(connection, packet.data(), (int)packet.size(), 1);
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+
+			wait_until(
+				std::chrono::seconds(10),
+				[&]() { return local.packetsReceived == numMessagesToSend; }
+			);
+
+			THEN("all echoes arrive in order")
+			{
+				auto lock = lock_of(local.packetsMutex);
+				REQUIRE(local.packets.size() == numMessagesToSend);
+
+				auto i = 0;
+				for (auto &received: local.packets)
+				{
+					packet[0] = i++ % 255;
+					REQUIRE(received == packet);
+				}
+			}
+
+			THEN("the remote acks mostly on its echoes, rather than in packets of their own")
+			{
+				auto lock = lock_of(remote.connectionsMutex);
+				mrudp_connection_statistics_t statistics;
+				REQUIRE(mrudp_connection_statistics(remoteConnection, &statistics) == MRUDP_OK);
+				
+				REQUIRE(statistics.acks_piggybacked > statistics.acks_sent);
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
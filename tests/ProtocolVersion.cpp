@@ -0,0 +1,105 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+#include "../mrudp/Packet.h"
+
+#include <netinet/in.h>
+#include <unistd.h>
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("protocol version")
+{
+    GIVEN( "mrudp service with a listening socket, and the first datagram a connection sends" )
+    {
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept(connection, nullptr, nullptr, nullptr);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		// a plain socket stands in for the remote of a connection, so that the
+		// datagram it is sent can be replayed to the listening socket
+		auto handle = ::socket(AF_INET, SOCK_DGRAM, 0);
+		
+		auto address = sockaddr_in { .sin_family = AF_INET };
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		::bind(handle, (sockaddr *)&address, sizeof(address));
+		
+		socklen_t size = sizeof(address);
+		::getsockname(handle, (sockaddr *)&address, &size);
+		
+		timeval timeout { .tv_sec = 0, .tv_usec = 500000 };
+		::setsockopt(handle, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+		State local("local");
+		local.service = mrudp_service();
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+		
+		mrudp_addr_t plainAddress = { 0 };
+		plainAddress.v4 = address;
+		
+		local.connections.insert(
+			mrudp_connect(local.sockets.back(), &plainAddress, nullptr, nullptr, nullptr)
+		);
+		
+		char datagram[2048];
+		auto received = ::recvfrom(handle, datagram, sizeof(datagram), 0, nullptr, nullptr);
+		REQUIRE(received >= (int)sizeof(Header));
+		
+		auto replay = [&]() {
+			::sendto(handle, datagram, received, 0, (sockaddr *)&remoteAddress.v4, sizeof(remoteAddress.v4));
+			
+			char reply[2048];
+			return ::recvfrom(handle, reply, sizeof(reply), 0, nullptr, nullptr) > 0;
+		} ;
+
+		WHEN("it is replayed with another version")
+		{
+			datagram[offsetof(Header, version)] = MRUDP_VERSION - 1;
+			
+			THEN("it is not answered, nor is a connection accepted")
+			{
+				REQUIRE(!replay());
+				
+				auto l = lock_of(remote.connectionsMutex);
+				REQUIRE(remote.connections.empty());
+			}
+		}
+
+		WHEN("it is replayed as it was sent")
+		{
+			THEN("it is answered")
+			{
+				REQUIRE(replay());
+			}
+		}
+		
+		::close(handle);
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
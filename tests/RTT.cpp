@@ -0,0 +1,66 @@
+#include "Common.h"
+#include "../mrudp/sender/RTT.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("rtt estimator")
+{
+	GIVEN("an rtt estimator without samples")
+	{
+		RTT rtt;
+		
+		THEN("the retry timeout is the initial one, and there is no lowest rtt")
+		{
+			REQUIRE(rtt.timeout() == RTT::initialTimeout);
+			REQUIRE(rtt.lowest == 0);
+		}
+		
+		WHEN("it is given steady samples")
+		{
+			for (auto i=0; i<64; ++i)
+				rtt.onSample(0.05f);
+				
+			THEN("the smoothed rtt settles, and the variation vanishes")
+			{
+				REQUIRE(std::abs(rtt.duration - 0.05f) < 0.001f);
+				REQUIRE(rtt.variance < 0.001f);
+				REQUIRE(rtt.lowest == 0.05f);
+				REQUIRE(std::abs(rtt.timeout() - (0.05f + RTT::granularity + RTT::maximumAckDelay)) < 0.001f);
+			}
+			
+			WHEN("it is then given jittery samples")
+			{
+				auto steady = rtt.timeout();
+				
+				for (auto i=0; i<16; ++i)
+					rtt.onSample(i % 2 ? 0.02f : 0.2f);
+					
+				THEN("the retry timeout grows with the variation")
+				{
+					REQUIRE(rtt.variance > 0.01f);
+					REQUIRE(rtt.timeout() > steady + 2 * rtt.variance);
+					REQUIRE(rtt.lowest == 0.02f);
+				}
+			}
+			
+			THEN("each attempt doubles the retry timeout, up to the maximum")
+			{
+				REQUIRE(rtt.timeout(1) == 2 * rtt.timeout());
+				REQUIRE(rtt.timeout(2) == 4 * rtt.timeout());
+				REQUIRE(rtt.timeout(32) == RTT::maximumTimeout);
+			}
+			
+			THEN("the probe timeout comes before the retry timeout")
+			{
+				REQUIRE(std::abs(rtt.probeTimeout() - RTT::probeFactor * 0.05f) < 0.001f);
+				REQUIRE(rtt.probeTimeout() < rtt.timeout());
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,406 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+#include "../mrudp/receiver/DuplicateFilter.h"
+#include "LossyRelay.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("duplicate filter")
+{
+	GIVEN("a duplicate filter")
+	{
+		DuplicateFilter filter;
+
+		THEN("an id is new only the first time it is inserted")
+		{
+			REQUIRE(filter.insert(10));
+			REQUIRE(!filter.insert(10));
+			REQUIRE(filter.insert(12));
+			REQUIRE(filter.insert(11));
+			REQUIRE(!filter.insert(11));
+			REQUIRE(!filter.insert(12));
+		}
+
+		THEN("ids passed over are new, and the filter slides across the wrap")
+		{
+			PacketID start = 65500;
+			REQUIRE(filter.insert(start));
+
+			for (PacketID id = start + 2; id != PacketID(start + 200); id += 2)
+				REQUIRE(filter.insert(id));
+
+			for (PacketID id = start + 1; id != PacketID(start + 199); id += 2)
+				REQUIRE(filter.insert(id));
+
+			for (PacketID id = start; id != PacketID(start + 199); ++id)
+				REQUIRE(!filter.insert(id));
+		}
+
+		THEN("an id whose bit last held the id a span before it is new")
+		{
+			PacketID first = 5;
+			REQUIRE(filter.insert(first));
+			REQUIRE(filter.insert(PacketID(first + DuplicateFilter::span - 1)));
+			REQUIRE(!filter.insert(first));
+
+			REQUIRE(filter.insert(PacketID(first + DuplicateFilter::span + 3)));
+			REQUIRE(filter.insert(PacketID(first + DuplicateFilter::span)));
+			REQUIRE(!filter.insert(PacketID(first + DuplicateFilter::span)));
+		}
+
+		THEN("an id a span or more behind the newest is outside of the span")
+		{
+			PacketID first = 5;
+			REQUIRE(filter.insert(PacketID(first + DuplicateFilter::span)));
+			
+			REQUIRE(filter.inSpan(PacketID(first + 1)));
+			REQUIRE(filter.inSpan(PacketID(first + DuplicateFilter::span + 1)));
+			REQUIRE(!filter.inSpan(first));
+			REQUIRE(!filter.insert(first));
+		}
+
+		THEN("an id inserted again after the ids advanced past have wrapped is new")
+		{
+			PacketID first = 10;
+			REQUIRE(filter.insert(first));
+			
+			for (PacketID id = first + 1; id != first; ++id)
+				filter.advance(id);
+				
+			REQUIRE(filter.insert(first));
+			REQUIRE(!filter.insert(first));
+		}
+	}
+}
+
+SCENARIO("reliable unordered")
+{
+	auto numMessagesToSend = 512;
+
+    GIVEN( "mrudp service, remote socket behind a relay which drops one packet in seven" )
+    {
+		Packet packet(256);
+		for (auto i=0; i<packet.size(); ++i)
+			packet[i] = i % 255;
+
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+		options.maximum_retry_attempts = 32;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service();
+
+		Mutex receivedMutex;
+		Vector<std::pair<int, int>> received;
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				auto lock = lock_of(receivedMutex);
+				received.push_back({ (u8)data[0] | ((u8)data[1] << 8), isReliable });
+				remote.packetsReceived++;
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept(connection, &remoteConnectionDispatch, connectionReceive, connectionClose);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		LossyRelay relay(remoteAddress, 7);
+
+		mrudp_addr_t relayAddress = { 0 };
+		relayAddress.v4 = relay.address;
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto connection = mrudp_connect_ex(
+			local.sockets.back(), &relayAddress,
+			&options,
+			&localConnectionDispatch, connectionReceive, connectionClose
+		);
+		local.connections.insert(connection);
+
+		auto sendNumbered = [&](int i, int reliable) {
+			packet[0] = i & 0xFF;
+			packet[1] = (i >> 8) & 0xFF;
+			return mrudp_send(connection, packet.data(), (int)packet.size(), reliable);
+		} ;
+
+		WHEN(numMessagesToSend << " reliable unordered messages are sent")
+		{
+			for (auto i=0; i<numMessagesToSend; ++i)
+				REQUIRE(sendNumbered(i, MRUDP_RELIABLE_UNORDERED) == MRUDP_OK);
+
+			wait_until(
+				std::chrono::seconds(30),
+				[&]() { return remote.packetsReceived == numMessagesToSend; }
+			);
+
+			// resent packets which were not lost would arrive after this
+			std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+			THEN("each arrives once, as it arrived rather than in order")
+			{
+				REQUIRE(relay.dropped > 0);
+
+				auto lock = lock_of(receivedMutex);
+				REQUIRE(received.size() == numMessagesToSend);
+
+				Vector<int> counts(numMessagesToSend, 0);
+				auto reordered = false;
+				for (size_t i=0; i<received.size(); ++i)
+				{
+					auto &[number, reliability] = received[i];
+					REQUIRE(reliability == MRUDP_RELIABLE_UNORDERED);
+					REQUIRE(number < numMessagesToSend);
+
+					counts[number]++;
+					if (number != (int)i)
+						reordered = true;
+				}
+
+				for (auto count: counts)
+					REQUIRE(count == 1);
+
+				REQUIRE(reordered);
+			}
+		}
+
+		WHEN("a reliable unordered message is larger than a packet")
+		{
+			Packet large(MRUDP_MAX_PACKET_SIZE * 2);
+
+			THEN("it is refused")
+			{
+				REQUIRE(mrudp_send(connection, large.data(), (int)large.size(), MRUDP_RELIABLE_UNORDERED) == MRUDP_ERROR_PACKET_SIZE_TOO_LARGE);
+			}
+		}
+	}
+
+    GIVEN( "mrudp service, remote and local sockets paired" )
+    {
+		Packet packet(256);
+
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_PACKET;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service();
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				remote.packetsReceived++;
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept(connection, &remoteConnectionDispatch, connectionReceive, connectionClose);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto connection = mrudp_connect_ex(
+			local.sockets.back(), &remoteAddress,
+			&options,
+			&localConnectionDispatch, connectionReceive, connectionClose
+		);
+
+		WHEN(numMessagesToSend << " reliable unordered messages are sent, and the connection is closed at once")
+		{
+			for (auto i=0; i<numMessagesToSend; ++i)
+				mrudp_send(connection, packet.data(), (int)packet.size(), MRUDP_RELIABLE_UNORDERED);
+
+			mrudp_close_connection(connection);
+
+			wait_until(
+				std::chrono::seconds(30),
+				[&]() { return remote.packetsReceived == numMessagesToSend; }
+			);
+
+			THEN("the remote receives them all before closing")
+			{
+				REQUIRE(remote.packetsReceived == numMessagesToSend);
+			}
+		}
+	}
+}
+
+SCENARIO("reliable unordered across a packet id wrap")
+{
+	// the ordered messages move the ids three quarters of the way around, so the
+	// second run of unordered messages begins behind the newest unordered id, and
+	// comes round to the ids of the first burst
+	auto numFirstToSend = 64;
+	auto numOrderedToSend = 3 << 14;
+	auto numSecondToSend = 1 << 15;
+
+    GIVEN( "mrudp service, remote and local sockets paired" )
+    {
+		Packet packet(16);
+
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service();
+
+		std::atomic<int> orderedReceived = 0;
+		std::atomic<int> unorderedReceived = 0;
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				if (isReliable == MRUDP_RELIABLE_UNORDERED)
+					unorderedReceived++;
+				else
+					orderedReceived++;
+					
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept_ex(connection, &options, &remoteConnectionDispatch, connectionReceive, connectionClose);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto connection = mrudp_connect_ex(
+			local.sockets.back(), &remoteAddress,
+			&options,
+			&localConnectionDispatch, connectionReceive, connectionClose
+		);
+		local.connections.insert(connection);
+
+		WHEN("a burst of unordered messages is sent, then ordered messages, then unordered messages until the ids have wrapped")
+		{
+			auto refused = 0;
+			auto send = [&](int count, int reliable) {
+				for (auto i=0; i<count; ++i)
+					if (mrudp_send(connection, packet.data(), (int)packet.size(), reliable) != MRUDP_OK)
+						refused++;
+			} ;
+			
+			// each waits for the last, so the ids of one are not shared with the next
+			send(numFirstToSend, MRUDP_RELIABLE_UNORDERED);
+			wait_until(std::chrono::seconds(10), [&]() { return unorderedReceived == numFirstToSend; });
+			
+			send(numOrderedToSend, MRUDP_RELIABLE);
+			wait_until(std::chrono::seconds(30), [&]() { return orderedReceived == numOrderedToSend; });
+			
+			send(numSecondToSend, MRUDP_RELIABLE_UNORDERED);
+			wait_until(std::chrono::seconds(30), [&]() { return unorderedReceived == numFirstToSend + numSecondToSend; });
+
+			THEN("every message arrives, none of the second run taken for the first")
+			{
+				REQUIRE(refused == 0);
+				REQUIRE(orderedReceived == numOrderedToSend);
+				REQUIRE(unorderedReceived == numFirstToSend + numSecondToSend);
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,96 @@
+#include "Common.h"
+#include "../mrudp/sender/RetryWindow.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("retry window")
+{
+	GIVEN("a retry window starting just before the ids wrap")
+	{
+		RetryWindow window;
+		PacketID start = std::numeric_limits<PacketID>::max() - 16;
+		
+		auto count = RetryWindow::initialCapacity * 4;
+		for (size_t i=0; i<count; ++i)
+		{
+			Retry retry;
+			retry.attempts = i;
+			window.insert(PacketID(start + i), std::move(retry));
+		}
+		
+		THEN("it grows to hold every packet, and finds each by id")
+		{
+			REQUIRE(window.size() == count);
+			REQUIRE(window.span() == count);
+			REQUIRE(window.slots.size() >= count);
+			
+			for (size_t i=0; i<count; ++i)
+			{
+				auto retry = window.find(PacketID(start + i));
+				REQUIRE(retry != nullptr);
+				REQUIRE(retry->attempts == i);
+			}
+			
+			REQUIRE(window.find(PacketID(start - 1)) == nullptr);
+			REQUIRE(window.find(PacketID(start + count)) == nullptr);
+		}
+		
+		THEN("an id already in the window, or one past the maximum span, is refused")
+		{
+			REQUIRE(window.insert(start, Retry()) == nullptr);
+			REQUIRE(window.insert(PacketID(start + RetryWindow::maximumCapacity), Retry()) == nullptr);
+			
+			REQUIRE(window.size() == count);
+			REQUIRE(window.span() == count);
+			REQUIRE(window.find(start)->attempts == 0);
+		}
+		
+		THEN("the span may grow to the maximum")
+		{
+			REQUIRE(window.insert(PacketID(start + RetryWindow::maximumCapacity - 1), Retry()) != nullptr);
+			REQUIRE(window.span() == RetryWindow::maximumCapacity);
+			REQUIRE(window.slots.size() == RetryWindow::maximumCapacity);
+			REQUIRE(window.find(PacketID(start + 1))->attempts == 1);
+		}
+		
+		WHEN("packets are acked out of order")
+		{
+			window.erase(PacketID(start + 1));
+			window.erase(PacketID(start + 2));
+			
+			THEN("the window still starts at the oldest unacked packet")
+			{
+				REQUIRE(window.first == start);
+				REQUIRE(window.find(PacketID(start + 1)) == nullptr);
+				REQUIRE(window.size() == count - 2);
+			}
+			
+			window.erase(start);
+			
+			THEN("acking the oldest moves the start past the acked ones")
+			{
+				REQUIRE(window.first == PacketID(start + 3));
+				REQUIRE(window.span() == count - 3);
+			}
+		}
+		
+		WHEN("every packet is acked")
+		{
+			for (size_t i=0; i<count; ++i)
+				window.erase(PacketID(start + i));
+				
+			THEN("the window is empty, and finds nothing")
+			{
+				REQUIRE(window.empty());
+				REQUIRE(window.span() == 0);
+				REQUIRE(window.find(start) == nullptr);
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,134 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("selective acks")
+{
+	auto numPacketsToSend = 1024;
+
+    GIVEN( "mrudp service, remote socket which delays its acks" )
+    {
+		Packet packet(1024);
+		for (auto i=0; i<packet.size(); ++i)
+			packet[i] = i % 255;
+
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service();
+
+		mrudp_connection_t remoteConnection = nullptr;
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				auto lock = lock_of(remote.packetsMutex);
+				remote.packets.push_back(Packet(data, data+size));
+				remote.packetsReceived++;
+				remote.bytesReceived += size;
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+				remoteConnection = connection;
+
+				mrudp_accept(
+					connection,
+					&remoteConnectionDispatch,
+					connectionReceive,
+					connectionClose
+				);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		local.connections.insert(
+			mrudp_connect_ex(
+				local.sockets.back(), &remoteAddress,
+				&options,
+				&localConnectionDispatch, connectionReceive, connectionClose
+			)
+		);
+
+		WHEN(numPacketsToSend << " reliable packets are sent")
+		{
+			auto connection = *local.connections.begin();
+			for (auto i=0; i<numPacketsToSend; ++i)
+			{
+				packet[0] = i % 255;
+				mrudp_send(connection, packet.data(), (int)packet.size(), 1);
+			}
+
+			wait_until(
+				std::chrono::seconds(30),
+				[&]() { return remote.packetsReceived == numPacketsToSend; }
+			);
+
+			THEN("all packets arrive in order")
+			{
+				auto lock = lock_of(remote.packetsMutex);
+				REQUIRE(remote.packets.size() == numPacketsToSend);
+
+				auto i = 0;
+				for (auto &received: remote.packets)
+				{
+					packet[0] = i++ % 255;
+					REQUIRE(received == packet);
+				}
+			}
+
+			THEN("the acks of many packets are sent together")
+			{
+				auto l = lock_of(remote.connectionsMutex);
+				REQUIRE(remoteConnection != nullptr);
+				
+				mrudp_connection_statistics_t statistics;
+				REQUIRE(mrudp_connection_statistics(remoteConnection, &statistics) == MRUDP_OK);
+				
+				REQUIRE(statistics.reliable.packets.received >= numPacketsToSend);
+				REQUIRE(statistics.packets_sent < statistics.reliable.packets.received / 2);
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,216 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+struct Writer : Connection
+{
+	std::atomic<int> writables = 0;
+} ;
+
+inline
+int connectionWritable(void *l_)
+{
+	auto l = reinterpret_cast<Writer *>(l_);
+	l->writables++;
+	
+	return 0;
+}
+
+SCENARIO("send buffer")
+{
+	auto sendBuffer = 64 * 1024;
+	auto receiveWindow = 16;
+	auto maximumMessagesToSend = 100000;
+
+    GIVEN( "mrudp service, remote and local sockets paired, the remote paused, the local service or connection with a small send buffer" )
+    {
+		Packet packet(1000);
+
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+		options.receive_window = receiveWindow;
+		options.send_buffer = 0;
+
+		mrudp_options_asio_t serviceOptions;
+		REQUIRE(mrudp_default_options(MRUDP_IMP_ASIO, &serviceOptions) == MRUDP_OK);
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		Mutex receivedMutex;
+		Vector<int> received;
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				auto lock = lock_of(receivedMutex);
+				received.push_back((u8)data[0] | ((u8)data[1] << 8) | ((u8)data[2] << 16));
+				remote.packetsReceived++;
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept_ex(
+					connection,
+					&options,
+					&remoteConnectionDispatch,
+					connectionReceive,
+					connectionClose
+				);
+
+				mrudp_connection_pause_receive(connection);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		State local("local");
+		
+		auto sendNumbered = [&](mrudp_connection_t connection, int i) {
+			packet[0] = i & 0xFF;
+			packet[1] = (i >> 8) & 0xFF;
+			packet[2] = (i >> 16) & 0xFF;
+			return mrudp_send(connection, packet.data(), (int)packet.size(), 1);
+		} ;
+		
+		auto connect = [&](Writer &writer) {
+			writer.receive = [&](auto data, auto size, auto isReliable) { return 0; };
+			writer.close = [&](auto event) { return 0; };
+			
+			auto connection = mrudp_connect_ex(
+				local.sockets.back(), &remoteAddress,
+				&options,
+				&writer, connectionReceive, connectionClose
+			);
+			local.connections.insert(connection);
+			
+			REQUIRE(mrudp_connection_writable(connection, connectionWritable) == MRUDP_OK);
+			
+			return connection;
+		} ;
+		
+		// the remote pauses a connection as it accepts it, so it is resumed after
+		auto resume = [&](size_t connections) {
+			wait_until(
+				std::chrono::seconds(10),
+				[&]() {
+					auto l = lock_of(remote.connectionsMutex);
+					return remote.connections.size() == connections;
+				}
+			);
+			
+			auto l = lock_of(remote.connectionsMutex);
+			for (auto connection: remote.connections)
+				REQUIRE(mrudp_connection_resume_receive(connection) == MRUDP_OK);
+		} ;
+
+		WHEN("reliable messages are sent on a connection with a small send buffer until one is refused")
+		{
+			options.send_buffer = sendBuffer;
+			
+			local.service = mrudp_service();
+			local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+			
+			Writer writer;
+			auto connection = connect(writer);
+			
+			auto sent = 0;
+			auto result = MRUDP_OK;
+			while (sent < maximumMessagesToSend && (result = sendNumbered(connection, sent)) == MRUDP_OK)
+				++sent;
+				
+			auto refused = sendNumbered(connection, sent);
+				
+			std::this_thread::sleep_for(std::chrono::milliseconds(500));
+
+			THEN("the messages accepted are at most the send buffer and the window, and it is not writable while the remote is paused")
+			{
+				REQUIRE(result == MRUDP_ERROR_WOULD_BLOCK);
+				REQUIRE(refused == MRUDP_ERROR_WOULD_BLOCK);
+				REQUIRE(sent * (int)packet.size() <= sendBuffer + receiveWindow * 2 * (int)packet.size());
+				REQUIRE(writer.writables == 0);
+			}
+
+			THEN("once the remote resumes, the connection is writable once and the messages accepted arrive")
+			{
+				resume(1);
+
+				wait_until(
+					std::chrono::seconds(30),
+					[&]() { return writer.writables > 0 && remote.packetsReceived == sent; }
+				);
+				
+				REQUIRE(writer.writables == 1);
+				
+				{
+					auto lock = lock_of(receivedMutex);
+					REQUIRE(received.size() == sent);
+					
+					for (auto i=0; i<sent; ++i)
+						REQUIRE(received[i] == i);
+				}
+				
+				REQUIRE(sendNumbered(connection, sent) == MRUDP_OK);
+			}
+		}
+
+		WHEN("reliable messages are sent on a service with a small send buffer until one is refused")
+		{
+			serviceOptions.send_buffer = sendBuffer;
+			
+			local.service = mrudp_service_ex(MRUDP_IMP_ASIO, &serviceOptions);
+			local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+			
+			Writer writer, other;
+			auto connection = connect(writer);
+			auto otherConnection = connect(other);
+			
+			auto sent = 0;
+			while (sent < maximumMessagesToSend && sendNumbered(connection, sent) == MRUDP_OK)
+				++sent;
+				
+			THEN("the other connections of the service are refused too, and are writable once it has drained")
+			{
+				REQUIRE(sent < maximumMessagesToSend);
+				REQUIRE(sendNumbered(otherConnection, 0) == MRUDP_ERROR_WOULD_BLOCK);
+				
+				resume(2);
+				
+				wait_until(
+					std::chrono::seconds(30),
+					[&]() { return writer.writables > 0 && other.writables > 0; }
+				);
+				
+				REQUIRE(writer.writables == 1);
+				REQUIRE(other.writables == 1);
+				REQUIRE(sendNumbered(otherConnection, 0) == MRUDP_OK);
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
@@ -0,0 +1,148 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("sendv")
+{
+	auto numMessagesToSend = 256;
+
+    GIVEN( "mrudp service, remote socket" )
+    {
+		auto options = mrudp_default_connection_options();
+
+		auto options_no_coalesce = options;
+		options_no_coalesce.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+
+		auto options_coalesce_packet = options;
+		options_coalesce_packet.coalesce_reliable.mode = MRUDP_COALESCE_PACKET;
+
+		auto options_coalesce_stream = options;
+		options_coalesce_stream.coalesce_reliable.mode = MRUDP_COALESCE_STREAM;
+
+		auto options_coalesce_stream_compressed = options;
+		options_coalesce_stream_compressed.coalesce_reliable.mode = MRUDP_COALESCE_STREAM_COMPRESSED;
+		options_coalesce_stream_compressed.coalesce_reliable.compression_level = 9;
+
+		List<std::tuple<String, mrudp_connection_options_t>> availableOptions = {
+			{ "no coalesce", options_no_coalesce },
+			{ "coalesce packet", options_coalesce_packet },
+			{ "coalesce stream", options_coalesce_stream },
+			{ "coalesce stream compressed", options_coalesce_stream_compressed },
+		};
+
+		for (auto &[name, connectionOptions]: availableOptions)
+		{
+			WHEN(name)
+			{
+				mrudp_addr_t anyAddress;
+				mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+				State remote("remote");
+				remote.service = mrudp_service();
+				remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+				mrudp_addr_t remoteAddress;
+				mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+				State local("local");
+				local.service = mrudp_service();
+
+				Packet received;
+
+				auto remoteConnectionDispatch = Connection {
+					.receive = [&](auto data, auto size, auto isReliable) {
+						auto lock = lock_of(remote.packetsMutex);
+						received.insert(received.end(), data, data+size);
+						remote.bytesReceived += size;
+						return 0;
+					},
+					.close = [&](auto event) {
+						return 0;
+					}
+				} ;
+
+				auto listen = Listener {
+					.accept = [&](auto connection) {
+						auto l = lock_of(remote.connectionsMutex);
+						remote.connections.insert(connection);
+
+						mrudp_accept(
+							connection,
+							&remoteConnectionDispatch,
+							connectionReceive,
+							connectionClose
+						);
+
+						return 0;
+					},
+					.close = [&](auto event) { return 0; }
+				} ;
+
+				mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+				local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+				auto localConnectionDispatch = Connection {
+					.receive = [&](auto data, auto size, auto isReliable) {
+						return 0;
+					},
+					.close = [&](auto event) {
+						return 0;
+					}
+				} ;
+
+				auto connection = mrudp_connect_ex(
+					local.sockets.back(), &remoteAddress,
+					&connectionOptions,
+					&localConnectionDispatch, connectionReceive, connectionClose
+				);
+				local.connections.insert(connection);
+
+				WHEN(numMessagesToSend << " messages of a header and two bodies are sent")
+				{
+					Packet sent;
+
+					for (auto i=0; i<numMessagesToSend; ++i)
+					{
+						char header[] = { 'h', (char)(i % 255) };
+
+						Packet body0(i % 64, 'a' + i % 26);
+						Packet body1(128, 'A' + i % 26);
+
+						mrudp_iovec_t segments[] = {
+							{ header, sizeof(header) },
+							{ body0.data(), body0.size() },
+							{ body1.data(), body1.size() },
+						};
+
+						REQUIRE(mrudp_sendv(connection, segments, 3, 1) == MRUDP_OK);
+
+						sent.insert(sent.end(), header, header + sizeof(header));
+						sent.insert(sent.end(), body0.begin(), body0.end());
+						sent.insert(sent.end(), body1.begin(), body1.end());
+					}
+
+					wait_until(
+						std::chrono::seconds(10),
+						[&]() { return remote.bytesReceived == sent.size(); }
+					);
+
+					THEN("the joined segments arrive")
+					{
+						auto lock = lock_of(remote.packetsMutex);
+						REQUIRE(received == sent);
+					}
+				}
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
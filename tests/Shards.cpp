@@ -0,0 +1,158 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("shards")
+{
+	auto numShards = 4;
+	auto numConnectionsToCreate = 16;
+	auto numPacketsToSendOnEachConnection = 32;
+
+    GIVEN( "a sharded listener" )
+    {
+		Packet packet(1024);
+		for (auto i=0; i<packet.size(); ++i)
+			packet[i] = i % 255;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		auto shards = mrudp_shards(&anyAddress, numShards);
+		REQUIRE(shards != nullptr);
+		REQUIRE(mrudp_shards_quantity(shards) == numShards);
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(mrudp_shards_socket(shards, 0), &remoteAddress);
+
+		THEN("the shards share one address")
+		{
+			for (auto i=1; i<numShards; ++i)
+			{
+				mrudp_addr_t shardAddress;
+				mrudp_socket_addr(mrudp_shards_socket(shards, i), &shardAddress);
+				REQUIRE(shardAddress.v4.sin_port == remoteAddress.v4.sin_port);
+			}
+		}
+
+		Mutex remoteMutex;
+		std::set<mrudp_connection_t> remoteConnections;
+		std::map<mrudp_connection_t, std::set<std::thread::id>> remoteThreads;
+		std::atomic<size_t> bytesReceived = 0;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto lock = lock_of(remoteMutex);
+				remoteConnections.insert(connection);
+				remoteThreads[connection].insert(std::this_thread::get_id());
+
+				auto remoteConnectionDispatch = new Connection {
+					.receive = [&, connection](auto data, auto size, auto isReliable) {
+						auto lock = lock_of(remoteMutex);
+						remoteThreads[connection].insert(std::this_thread::get_id());
+						bytesReceived += size;
+						return 0;
+					},
+					.close = [&](auto event) {
+						return 0;
+					},
+					.shouldDelete = true
+				} ;
+
+				mrudp_accept(
+					connection,
+					remoteConnectionDispatch,
+					connectionReceive,
+					connectionClose
+				);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		REQUIRE(mrudp_shards_listen(shards, &listen, nullptr, listenerAccept, listenerClose) == MRUDP_OK);
+
+		WHEN(numConnectionsToCreate << " connections are made from different sockets")
+		{
+			State local("local");
+			local.service = mrudp_service();
+
+			auto localConnectionDispatch = Connection {
+				.receive = [&](auto data, auto size, auto isReliable) {
+					return 0;
+				},
+				.close = [&](auto event) {
+					return 0;
+				}
+			} ;
+
+			for (auto i=0; i<numConnectionsToCreate; ++i)
+			{
+				local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+				local.connections.insert(
+					mrudp_connect(
+						local.sockets.back(), &remoteAddress,
+						&localConnectionDispatch, connectionReceive, connectionClose
+					)
+				);
+			}
+
+			size_t bytesSent = 0;
+			for (auto i=0; i<numPacketsToSendOnEachConnection; ++i)
+			{
+				for (auto &connection: local.connections)
+				{
+					mrudp_send(connection, packet.data(), (int)packet.size(), 1);
+					bytesSent += packet.size();
+				}
+			}
+
+			wait_until(
+				std::chrono::seconds(30),
+				[&]() { return bytesReceived == bytesSent; }
+			);
+
+			THEN("every connection is accepted once, and all data arrives")
+			{
+				auto lock = lock_of(remoteMutex);
+				REQUIRE(remoteConnections.size() == numConnectionsToCreate);
+				REQUIRE(bytesReceived == bytesSent);
+			}
+
+			THEN("each connection stays on one shard, and the connections are spread over the shards")
+			{
+				auto lock = lock_of(remoteMutex);
+				
+				std::set<std::thread::id> threads;
+				for (auto &[connection, connectionThreads]: remoteThreads)
+				{
+					REQUIRE(connectionThreads.size() == 1);
+					threads.insert(*connectionThreads.begin());
+				}
+
+				REQUIRE(threads.size() > 1);
+				REQUIRE(threads.size() <= numShards);
+			}
+
+			std::set<mrudp_connection_t> connections;
+			{
+				auto lock = lock_of(remoteMutex);
+				std::swap(connections, remoteConnections);
+			}
+			
+			for (auto connection: connections)
+				mrudp_close_connection(connection);
+		}
+
+		mrudp_close_shards(shards, true);
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
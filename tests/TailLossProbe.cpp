@@ -0,0 +1,137 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+#include "LossyRelay.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("tail loss probe")
+{
+	auto numMessagesToSend = 64;
+
+    GIVEN( "mrudp service, remote socket behind a relay which drops one packet in seven" )
+    {
+		Packet packet(256);
+		for (auto i=0; i<packet.size(); ++i)
+			packet[i] = i % 255;
+
+		auto options = mrudp_default_connection_options();
+		options.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+		options.maximum_retry_attempts = 32;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service();
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service();
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				auto lock = lock_of(remote.packetsMutex);
+				remote.packets.push_back(Packet(data, data+size));
+				remote.packetsReceived++;
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept(
+					connection,
+					&remoteConnectionDispatch,
+					connectionReceive,
+					connectionClose
+				);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		LossyRelay relay(remoteAddress, 7);
+		
+		mrudp_addr_t relayAddress = { 0 };
+		relayAddress.v4 = relay.address;
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		local.connections.insert(
+			mrudp_connect_ex(
+				local.sockets.back(), &relayAddress,
+				&options,
+				&localConnectionDispatch, connectionReceive, connectionClose
+			)
+		);
+
+		// each message is the last packet sent, so when it is lost there are no
+		// later packets to be acked and show the loss
+		WHEN(numMessagesToSend << " reliable messages are sent, each once the last has arrived")
+		{
+			auto connection = *local.connections.begin();
+			
+			for (auto i=0; i<numMessagesToSend; ++i)
+			{
+				packet[0] = i % 255;
+				mrudp_send(connection, packet.data(), (int)packet.size(), 1);
+
+				wait_until(
+					std::chrono::seconds(10),
+					[&]() { return remote.packetsReceived == i + 1; }
+				);
+			}
+
+			THEN("all packets arrive in order")
+			{
+				auto lock = lock_of(remote.packetsMutex);
+				REQUIRE(remote.packets.size() == numMessagesToSend);
+
+				auto i = 0;
+				for (auto &received: remote.packets)
+				{
+					packet[0] = i++ % 255;
+					REQUIRE(received == packet);
+				}
+			}
+
+			THEN("the lost messages are resent by probing")
+			{
+				mrudp_connection_statistics_t statistics;
+				REQUIRE(mrudp_connection_statistics(connection, &statistics) == MRUDP_OK);
+				
+				REQUIRE(relay.dropped > 0);
+				REQUIRE(statistics.packets_probed > 0);
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace
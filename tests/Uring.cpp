@@ -0,0 +1,133 @@
+#include "../mrudp/mrudp.h"
+
+#include "Common.h"
+#include "../mrudp/Base.h"
+
+namespace timprepscius {
+namespace mrudp {
+namespace tests {
+
+SCENARIO("uring")
+{
+	auto numPacketsToSend = 1024;
+
+    GIVEN( "mrudp uring service, remote socket, few receive buffers" )
+    {
+		Packet packet(1024);
+		for (auto i=0; i<packet.size(); ++i)
+			packet[i] = i % 255;
+
+		mrudp_options_uring_t options;
+		REQUIRE(mrudp_default_options(MRUDP_IMP_URING, &options) == MRUDP_OK);
+		options.connection.coalesce_reliable.mode = MRUDP_COALESCE_NONE;
+		options.connection.coalesce_unreliable.mode = MRUDP_COALESCE_NONE;
+
+		// the multishot receive runs out of buffers often, and must be rearmed
+		options.receive_buffers = 8;
+
+		mrudp_addr_t anyAddress;
+		mrudp_str_to_addr("127.0.0.1:0", &anyAddress);
+
+		State remote("remote");
+		remote.service = mrudp_service_ex(MRUDP_IMP_URING, &options);
+		remote.sockets.push_back(mrudp_socket(remote.service, &anyAddress));
+
+		mrudp_addr_t remoteAddress;
+		mrudp_socket_addr(remote.sockets.back(), &remoteAddress);
+
+		State local("local");
+		local.service = mrudp_service_ex(MRUDP_IMP_URING, &options);
+
+		auto remoteConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				auto lock = lock_of(remote.packetsMutex);
+				remote.packets.push_back(Packet(data, data+size));
+				remote.packetsReceived++;
+				remote.bytesReceived += size;
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		auto listen = Listener {
+			.accept = [&](auto connection) {
+				auto l = lock_of(remote.connectionsMutex);
+				remote.connections.insert(connection);
+
+				mrudp_accept(
+					connection,
+					&remoteConnectionDispatch,
+					connectionReceive,
+					connectionClose
+				);
+
+				return 0;
+			},
+			.close = [&](auto event) { return 0; }
+		} ;
+
+		mrudp_listen(remote.sockets.back(), &listen, nullptr, listenerAccept, listenerClose);
+
+		local.sockets.push_back(mrudp_socket(local.service, &anyAddress));
+
+		auto localConnectionDispatch = Connection {
+			.receive = [&](auto data, auto size, auto isReliable) {
+				return 0;
+			},
+			.close = [&](auto event) {
+				return 0;
+			}
+		} ;
+
+		local.connections.insert(
+			mrudp_connect_ex(
+				local.sockets.back(), &remoteAddress,
+				&options.connection,
+				&localConnectionDispatch, connectionReceive, connectionClose
+			)
+		);
+
+		WHEN(numPacketsToSend << " reliable packets are sent")
+		{
+			auto connection = *local.connections.begin();
+			for (auto i=0; i<numPacketsToSend; ++i)
+			{
+				packet[0] = i % 255;
+				mrudp_send(connection, packet.data(), (int)packet.size(), 1);
+			}
+
+			wait_until(
+				std::chrono::seconds(30),
+				[&]() { return remote.packetsReceived == numPacketsToSend; }
+			);
+
+			THEN("all packets arrive in order")
+			{
+				auto lock = lock_of(remote.packetsMutex);
+				REQUIRE(remote.packets.size() == numPacketsToSend);
+
+				auto i = 0;
+				for (auto &received: remote.packets)
+				{
+					packet[0] = i++ % 255;
+					REQUIRE(received == packet);
+				}
+			}
+
+			THEN("the socket reports its local address")
+			{
+				mrudp_addr_t localAddress;
+				mrudp_socket_addr(local.sockets.back(), &localAddress);
+
+				REQUIRE(localAddress.ip.sa_family == AF_INET);
+				REQUIRE(localAddress.v4.sin_port != 0);
+			}
+		}
+	}
+}
+
+} // namespace
+} // namespace
+} // namespace